@@ -4,7 +4,9 @@
 #include "SPTracer/Exception.h"
 #include "SPTracer/Log.h"
 #include "SPTracer/StringUtil.h"
+#include "SPTracer/Light/EnvironmentLight.h"
 #include "SPTracer/Scene/MDLAModel.h"
+#include "SPTracer/Scene/Mesh.h"
 #include "SPTracer/Scene/OBJModel.h"
 #include "SPTracer/Scene/Scene.h"
 #include "SPTracer/Tracer/Tracer.h"
@@ -37,7 +39,7 @@ App::App(std::string configFile)
 		else if (config.modelType == Config::ModelType::OBJ)
 		{
 			// load OBJ model
-			scene = SPTracer::OBJModel::Load(config.modelFile, config.spectrum);
+			scene = SPTracer::OBJModel::Load(config.modelFile, config.spectrum, config.quantizePositions);
 			
 			// camera data must be present in config file
 			if (!config.cameraLoaded)
@@ -46,16 +48,42 @@ App::App(std::string configFile)
 			}
 		}
 
+		// add instances, every mesh file is loaded only once
+		std::unordered_map<std::string, std::shared_ptr<SPTracer::Mesh>> meshes;
+		for (const auto& instance : config.instances)
+		{
+			auto& mesh = meshes[instance.meshFile];
+			if (!mesh)
+			{
+				mesh = SPTracer::OBJModel::LoadMesh(instance.meshFile, config.spectrum, config.quantizePositions);
+			}
+
+			scene->AddInstance(mesh, instance.transform);
+		}
+
+		// light arriving along rays leaving the scene
+		if (!config.environmentFile.empty())
+		{
+			scene->SetEnvironment(SPTracer::EnvironmentLight::Load(config.environmentFile, config.environmentScale, config.spectrum));
+		}
+
 		// camera in configuration file has higher priority
 		if (config.cameraLoaded)
 		{
 			camera = std::move(config.camera);
 		}
+		else
+		{
+			// projection model can be set without camera data
+			camera.type = config.camera.type;
+			camera.lensRadius = config.camera.lensRadius;
+			camera.focusDistance = config.camera.focusDistance;
+		}
 
 		// create tracer
 		tracer_ = std::make_unique<SPTracer::Tracer>(std::move(scene), std::move(camera),
 			config.width, config.height, config.numThreads,
-			config.spectrum);
+			config.spectrum, config.settings);
 
 		// assign image updater
 		tracer_->SetImageUpdater(window_->imageUpdater());
@@ -110,6 +138,9 @@ Config App::ReadConfig(std::string configFile) const
 	// prepare config
 	Config config{};
 
+	// mesh file for instances
+	std::string instanceMesh;
+
 	// open config file
 	std::ifstream file(configFile);
 	if (!file.is_open())
@@ -193,6 +224,21 @@ Config App::ReadConfig(std::string configFile) const
 				// model file
 				config.modelFile = value;
 			}
+			else if (parameter == "quantizepositions")
+			{
+				// store OBJ vertex coordinates with 16 bits relative to object bounds
+				config.quantizePositions = SPTracer::StringUtil::GetInt(value) != 0;
+			}
+			else if (parameter == "environmentfile")
+			{
+				// environment map
+				config.environmentFile = value;
+			}
+			else if (parameter == "environmentscale")
+			{
+				// multiplier of environment radiance
+				config.environmentScale = SPTracer::StringUtil::GetFloat(value);
+			}
 			else if (parameter == "cameraname")
 			{
 				// model file
@@ -258,6 +304,76 @@ Config App::ReadConfig(std::string configFile) const
 				config.camera.icx = values[0];
 				config.camera.icy = values[1];
 			}
+			else if (parameter == "cameratype")
+			{
+				// camera projection model
+				// convert value to lower
+				SPTracer::StringUtil::ToLower(value);
+				if (value == "pinhole")
+				{
+					// perspective projection through a point
+					config.camera.type = SPTracer::CameraType::Pinhole;
+				}
+				else if (value == "thinlens")
+				{
+					// perspective projection with depth of field
+					config.camera.type = SPTracer::CameraType::ThinLens;
+				}
+				else if (value == "orthographic")
+				{
+					// parallel projection
+					config.camera.type = SPTracer::CameraType::Orthographic;
+				}
+				else
+				{
+					// unknown camera type
+					throw std::runtime_error(("Error in configuration file: Unknown camera type: " + originalLine).c_str());
+				}
+			}
+			else if (parameter == "cameralensradius")
+			{
+				// thin lens aperture radius
+				config.camera.lensRadius = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "camerafocusdistance")
+			{
+				// thin lens distance to plane in focus
+				config.camera.focusDistance = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "instancemesh")
+			{
+				// mesh file for the following instances
+				instanceMesh = value;
+			}
+			else if (parameter == "instance")
+			{
+				// instance of mesh with translation (3 values)
+				// or 3x4 row-major transform matrix (12 values)
+				if (instanceMesh.length() == 0)
+				{
+					throw std::runtime_error(("Error in configuration file: Instance mesh is not set: " + originalLine).c_str());
+				}
+
+				std::vector<float> values = SPTracer::StringUtil::GetFloatArray(value, 3, 12, ';');
+				Config::Instance instance;
+				instance.meshFile = instanceMesh;
+				if (values.size() == 3)
+				{
+					instance.transform = SPTracer::Transform::Translation(SPTracer::Vec3(values[0], values[1], values[2]));
+				}
+				else if (values.size() == 12)
+				{
+					std::array<float, 12> m;
+					std::copy(values.begin(), values.end(), m.begin());
+					instance.transform = SPTracer::Transform(m);
+				}
+				else
+				{
+					throw std::runtime_error(("Error in configuration file: Instance expects 3 or 12 values: " + originalLine).c_str());
+				}
+
+				config.instances.push_back(std::move(instance));
+			}
 			else if (parameter == "width")
 			{
 				// width
@@ -273,6 +389,227 @@ Config App::ReadConfig(std::string configFile) const
 				// number of threads
 				config.numThreads = (unsigned int)SPTracer::StringUtil::GetInt(value);
 			}
+			else if (parameter == "integrator")
+			{
+				// light transport algorithm
+				// convert value to lower
+				SPTracer::StringUtil::ToLower(value);
+				if (value == "path")
+				{
+					// unidirectional path tracing
+					config.settings.integrator = SPTracer::Integrator::PathTracing;
+				}
+				else if (value == "bidirectional")
+				{
+					// bidirectional path tracing
+					config.settings.integrator = SPTracer::Integrator::Bidirectional;
+				}
+				else if (value == "photonmapping")
+				{
+					// stochastic progressive photon mapping
+					config.settings.integrator = SPTracer::Integrator::PhotonMapping;
+				}
+				else if (value == "metropolis")
+				{
+					// primary sample space Metropolis light transport
+					config.settings.integrator = SPTracer::Integrator::Metropolis;
+				}
+				else if (value == "radiosity")
+				{
+					// precomputed patch radiosity of planar meshes
+					config.settings.integrator = SPTracer::Integrator::Radiosity;
+				}
+				else if (value == "instantradiosity")
+				{
+					// virtual point lights shaded through lightcuts
+					config.settings.integrator = SPTracer::Integrator::InstantRadiosity;
+				}
+				else if (value == "restir")
+				{
+					// direct light by spatiotemporal reservoir resampling
+					config.settings.integrator = SPTracer::Integrator::ReservoirResampling;
+				}
+				else
+				{
+					// unknown integrator
+					throw std::runtime_error(("Error in configuration file: Unknown integrator: " + originalLine).c_str());
+				}
+			}
+			else if (parameter == "nexteventestimation")
+			{
+				// direct light sampling
+				config.settings.nextEventEstimation = SPTracer::StringUtil::GetInt(value) != 0;
+			}
+			else if (parameter == "multipleimportancesampling")
+			{
+				// combination of light and BSDF sampling
+				config.settings.multipleImportanceSampling = SPTracer::StringUtil::GetInt(value) != 0;
+			}
+			else if (parameter == "herowavelengths")
+			{
+				// wave lengths per path, 0 for full spectrum
+				config.settings.heroWavelengths = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "wavelengthimportancesampling")
+			{
+				// hero wave lengths proportional to the observer response
+				config.settings.wavelengthImportanceSampling = SPTracer::StringUtil::GetInt(value) != 0;
+			}
+			else if (parameter == "mindepth")
+			{
+				// minimum number of bounces of contributing paths
+				config.settings.minDepth = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "maxdepth")
+			{
+				// maximum number of bounces
+				config.settings.maxDepth = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "russianroulette")
+			{
+				// path termination by throughput
+				config.settings.russianRoulette = SPTracer::StringUtil::GetInt(value) != 0;
+			}
+			else if (parameter == "roulettedepth")
+			{
+				// number of bounces before Russian roulette
+				config.settings.rouletteDepth = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "primarysplits")
+			{
+				// paths continuing from primary hit, 0 for automatic
+				config.settings.primarySplits = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "pathguiding")
+			{
+				// learned distribution of directions at diffuse vertices
+				config.settings.pathGuiding = SPTracer::StringUtil::GetInt(value) != 0;
+			}
+			else if (parameter == "guidingiterations")
+			{
+				// training iterations of path guiding
+				config.settings.guidingIterations = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "guidingbsdffraction")
+			{
+				// probability to sample BSDF at guided vertex
+				config.settings.guidingBsdfFraction = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "radiancecache")
+			{
+				// path termination by cached radiance
+				config.settings.radianceCache = SPTracer::StringUtil::GetInt(value) != 0;
+			}
+			else if (parameter == "radiancecachedepth")
+			{
+				// bounces before paths are terminated by the cache
+				config.settings.radianceCacheDepth = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "radiancecacheupdaterate")
+			{
+				// fraction of paths updating the cache
+				config.settings.radianceCacheUpdateRate = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "radiancecacheminsamples")
+			{
+				// records in cache cell before it is used
+				config.settings.radianceCacheMinSamples = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "radiancecachecellsize")
+			{
+				// size of cache cell
+				config.settings.radianceCacheCellSize = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "photonsperiteration")
+			{
+				// photons traced per photon mapping iteration
+				config.settings.photonsPerIteration = (unsigned long)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "photonradius")
+			{
+				// initial photon gathering radius
+				config.settings.photonRadius = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "metropolisbootstrapsamples")
+			{
+				// bootstrap paths of Metropolis chain
+				config.settings.metropolisBootstrapSamples = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "metropolislargestepprobability")
+			{
+				// probability of independent mutation
+				config.settings.metropolisLargeStepProbability = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "metropolissigma")
+			{
+				// size of small mutations
+				config.settings.metropolisSigma = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "radiositypatchsize")
+			{
+				// largest edge of radiosity patch
+				config.settings.radiosityPatchSize = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "radiosityrays")
+			{
+				// form factor rays per patch
+				config.settings.radiosityRays = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "radiosityiterations")
+			{
+				// iterations of radiosity solution
+				config.settings.radiosityIterations = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "radiosityfinalgather")
+			{
+				// one diffuse bounce gathering radiosity
+				config.settings.radiosityFinalGather = SPTracer::StringUtil::GetInt(value) != 0;
+			}
+			else if (parameter == "vplpathsperpass")
+			{
+				// light subpaths per instant radiosity pass
+				config.settings.vplPathsPerPass = (unsigned long)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "vplclampdistance")
+			{
+				// clamping of virtual point lights
+				config.settings.vplClampDistance = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "lightcutserror")
+			{
+				// relative error bound of lightcut
+				config.settings.lightcutsError = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "lightcutsmaxsize")
+			{
+				// clusters in lightcut
+				config.settings.lightcutsMaxSize = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "restircandidates")
+			{
+				// light sample candidates per pixel
+				config.settings.restirCandidates = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "restirtemporalreuse")
+			{
+				// reuse of reservoirs from the previous pass
+				config.settings.restirTemporalReuse = SPTracer::StringUtil::GetInt(value) != 0;
+			}
+			else if (parameter == "restirspatialneighbors")
+			{
+				// neighbouring reservoirs merged per pixel
+				config.settings.restirSpatialNeighbors = (unsigned int)SPTracer::StringUtil::GetInt(value);
+			}
+			else if (parameter == "restirspatialradius")
+			{
+				// radius of neighbourhood in pixels
+				config.settings.restirSpatialRadius = SPTracer::StringUtil::GetFloat(value);
+			}
+			else if (parameter == "restirunbiased")
+			{
+				// unbiased merging of reservoirs
+				config.settings.restirUnbiased = SPTracer::StringUtil::GetInt(value) != 0;
+			}
 			else if (parameter == "wavelengthmin")
 			{
 				// wave length minimum
@@ -2,7 +2,9 @@
 #define CONFIG_H
 
 #include "SPTracer/Color/Spectrum.h"
-#include "SPTracer/Scene/Camera.h"
+#include "SPTracer/Camera/Camera.h"
+#include "SPTracer/Transform.h"
+#include "SPTracer/Tracer/RenderSettings.h"
 
 struct Config
 {
@@ -12,14 +14,25 @@ struct Config
 		OBJ
 	};
 
+	struct Instance
+	{
+		std::string meshFile;
+		SPTracer::Transform transform;
+	};
+
 	ModelType modelType;
 	std::string modelFile;
+	bool quantizePositions;
 	SPTracer::Camera camera;
 	bool cameraLoaded;
 	unsigned int width;
 	unsigned int height;
 	unsigned int numThreads;
 	SPTracer::Spectrum spectrum;
+	SPTracer::RenderSettings settings;
+	std::vector<Instance> instances;
+	std::string environmentFile;	// latitude-longitude PFM image, no environment if empty
+	float environmentScale = 1.0f;
 };
 
 #endif
@@ -0,0 +1,92 @@
+#include "stdafx.h"
+#include "Exception.h"
+#include "Log.h"
+#include "AliasTable.h"
+
+namespace SPTracer
+{
+
+	AliasTable::AliasTable()
+	{
+	}
+
+	AliasTable::AliasTable(const std::vector<float>& weights)
+	{
+		size_t n = weights.size();
+		double sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+		if ((n == 0) || !(sum > 0.0))
+		{
+			std::string s = "AliasTable: Weights must have positive sum";
+			Log::Error(s);
+			throw Exception(s);
+		}
+
+		probability_.resize(n);
+		alias_.resize(n);
+		pdf_.resize(n);
+
+		// scaled probabilities, average is 1
+		std::vector<double> scaled(n);
+		std::vector<size_t> small;
+		std::vector<size_t> large;
+		for (size_t i = 0; i < n; i++)
+		{
+			pdf_[i] = static_cast<float>(weights[i] / sum);
+			scaled[i] = weights[i] / sum * n;
+			(scaled[i] < 1.0 ? small : large).push_back(i);
+		}
+
+		// pair every small entry with a large one (Vose's algorithm)
+		while (!small.empty() && !large.empty())
+		{
+			size_t s = small.back();
+			small.pop_back();
+			size_t l = large.back();
+
+			probability_[s] = static_cast<float>(scaled[s]);
+			alias_[s] = l;
+
+			scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+			if (scaled[l] < 1.0)
+			{
+				large.pop_back();
+				small.push_back(l);
+			}
+		}
+
+		// remaining entries are kept with probability 1 (up to rounding)
+		for (size_t i : large)
+		{
+			probability_[i] = 1.0f;
+			alias_[i] = i;
+		}
+
+		for (size_t i : small)
+		{
+			probability_[i] = 1.0f;
+			alias_[i] = i;
+		}
+	}
+
+	size_t AliasTable::size() const
+	{
+		return pdf_.size();
+	}
+
+	size_t AliasTable::Sample(float u) const
+	{
+		// column is selected with the integer part,
+		// fraction decides between the column and its alias
+		float scaled = u * probability_.size();
+		size_t index = std::min(static_cast<size_t>(scaled), probability_.size() - 1);
+		float fraction = scaled - index;
+
+		return fraction < probability_[index] ? index : alias_[index];
+	}
+
+	float AliasTable::GetPdf(size_t index) const
+	{
+		return pdf_[index];
+	}
+
+}
@@ -0,0 +1,33 @@
+#ifndef SPT_ALIAS_TABLE_H
+#define SPT_ALIAS_TABLE_H
+
+#include "stdafx.h"
+
+namespace SPTracer
+{
+
+	// Discrete distribution sampled in constant time (Walker's alias method).
+	class AliasTable
+	{
+	public:
+		AliasTable();
+		explicit AliasTable(const std::vector<float>& weights);
+
+		// number of entries
+		size_t size() const;
+
+		// samples entry index with uniform value in [0, 1)
+		size_t Sample(float u) const;
+
+		// probability of entry
+		float GetPdf(size_t index) const;
+
+	private:
+		std::vector<float> probability_;	// probability to keep the entry
+		std::vector<size_t> alias_;			// entry to use otherwise
+		std::vector<float> pdf_;
+	};
+
+}
+
+#endif
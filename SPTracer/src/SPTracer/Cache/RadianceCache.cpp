@@ -0,0 +1,96 @@
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "../Color/SpectralPacket.h"
+#include "../Tracer/Ray.h"
+#include "RadianceCache.h"
+
+namespace SPTracer
+{
+
+	RadianceCache::RadianceCache(size_t spectrumCount, float cellSize, unsigned int minSamples)
+		: spectrumCount_(spectrumCount), invCellSize_(1.0f / cellSize), minSamples_(static_cast<float>(std::max(minSamples, 1u))),
+		  keys_(CellCount), radiance_(CellCount * spectrumCount), samples_(CellCount * spectrumCount)
+	{
+		for (std::atomic<std::uint32_t>& key : keys_)
+		{
+			key.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	bool RadianceCache::Lookup(const Vec3& point, const Vec3& normal, const Ray& ray, SpectralPacket& radiance) const
+	{
+		std::uint64_t hash = GetHash(point, normal);
+		size_t slot = static_cast<size_t>(hash & (CellCount - 1));
+		std::uint32_t key = static_cast<std::uint32_t>(hash >> 32) | 1u;
+		if (keys_[slot].load(std::memory_order_relaxed) != key)
+		{
+			return false;
+		}
+
+		bool found = true;
+		const AtomicFloat* sums = &radiance_[slot * spectrumCount_];
+		const AtomicFloat* counts = &samples_[slot * spectrumCount_];
+		ray.ForEachWave(spectrumCount_, [&](size_t t)
+		{
+			float count = counts[t].load();
+			found = found && (count >= minSamples_);
+			radiance[t] = count > 0.0f ? sums[t].load() / count : 0.0f;
+		});
+
+		return found;
+	}
+
+	void RadianceCache::Record(const Vec3& point, const Vec3& normal, const Ray& ray, const SpectralPacket& radiance)
+	{
+		std::uint64_t hash = GetHash(point, normal);
+		size_t slot = static_cast<size_t>(hash & (CellCount - 1));
+		std::uint32_t key = static_cast<std::uint32_t>(hash >> 32) | 1u;
+
+		// the first cell recorded in slot owns it
+		std::uint32_t stored = keys_[slot].load(std::memory_order_relaxed);
+		if ((stored == 0) && keys_[slot].compare_exchange_strong(stored, key, std::memory_order_relaxed))
+		{
+			stored = key;
+		}
+
+		if (stored != key)
+		{
+			return;
+		}
+
+		AtomicFloat* sums = &radiance_[slot * spectrumCount_];
+		AtomicFloat* counts = &samples_[slot * spectrumCount_];
+		ray.ForEachWave(spectrumCount_, [&](size_t t)
+		{
+			sums[t].Add(radiance[t]);
+			counts[t].Add(1.0f);
+		});
+	}
+
+	std::uint64_t RadianceCache::GetHash(const Vec3& point, const Vec3& normal) const
+	{
+		// dominant axis of normal and its sign
+		size_t axis = 0;
+		for (size_t i = 1; i < 3; i++)
+		{
+			if (std::abs(normal[i]) > std::abs(normal[axis]))
+			{
+				axis = i;
+			}
+		}
+
+		std::uint64_t side = 2 * axis + (normal[axis] < 0.0f ? 1 : 0);
+
+		// mixing of voxel coordinates, so that neighbouring cells are spread over the table
+		std::uint64_t hash = side;
+		for (size_t i = 0; i < 3; i++)
+		{
+			std::int64_t cell = static_cast<std::int64_t>(std::floor(point[i] * invCellSize_));
+			hash = (hash ^ static_cast<std::uint64_t>(cell)) * 0x9E3779B97F4A7C15ull;
+			hash ^= hash >> 29;
+		}
+
+		return hash;
+	}
+
+}
@@ -0,0 +1,48 @@
+#ifndef SPT_RADIANCE_CACHE_H
+#define SPT_RADIANCE_CACHE_H
+
+#include "../stdafx.h"
+#include "../Guiding/AtomicFloat.h"
+
+namespace SPTracer
+{
+	struct Ray;
+	class SpectralPacket;
+	class Vec3;
+
+	// World space cache of radiance reflected by diffuse surfaces. Space is
+	// divided into voxels, surfaces in a voxel are told apart by the dominant
+	// axis of their normal, and every such cell is hashed into a table of fixed
+	// size. Cell keeps sum and number of recorded values for every wave length,
+	// they are added atomically while paths are traced. Cells lost in hash
+	// collisions are not cached.
+	class RadianceCache
+	{
+	public:
+		RadianceCache(size_t spectrumCount, float cellSize, unsigned int minSamples);
+
+		// mean radiance recorded at point for wave lengths of the ray,
+		// returns false if any of them has fewer than minimum samples
+		bool Lookup(const Vec3& point, const Vec3& normal, const Ray& ray, SpectralPacket& radiance) const;
+
+		// adds radiance of wave lengths of the ray reflected at point
+		void Record(const Vec3& point, const Vec3& normal, const Ray& ray, const SpectralPacket& radiance);
+
+	private:
+		// number of cells in hash table, power of two
+		static const size_t CellCount = 1 << 16;
+
+		const size_t spectrumCount_;
+		const float invCellSize_;
+		const float minSamples_;
+		std::vector<std::atomic<std::uint32_t>> keys_;	// nonzero key of the cell stored in slot
+		std::vector<AtomicFloat> radiance_;				// sums for all wave lengths of every slot
+		std::vector<AtomicFloat> samples_;				// counts for all wave lengths of every slot
+
+		// hash of the cell containing point on surface with normal
+		std::uint64_t GetHash(const Vec3& point, const Vec3& normal) const;
+	};
+
+}
+
+#endif
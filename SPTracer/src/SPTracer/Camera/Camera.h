@@ -3,6 +3,7 @@
 
 #include "../stdafx.h"
 #include "../Vec3.h"
+#include "CameraType.h"
 
 namespace SPTracer
 {
@@ -19,6 +20,9 @@ namespace SPTracer
 		float icx;			// image center x
 		float icy;			// image center y
 		float t;			// time of exposure
+		CameraType type;	// projection model
+		float lensRadius;	// lens aperture radius (thin lens)
+		float focusDistance;// distance to plane in focus (thin lens)
 	};
 
 }
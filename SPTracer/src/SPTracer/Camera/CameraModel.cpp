@@ -0,0 +1,108 @@
+#include "../stdafx.h"
+#include "../Exception.h"
+#include "../Log.h"
+#include "../Tracer/Ray.h"
+#include "Camera.h"
+#include "CameraModel.h"
+#include "CameraSample.h"
+#include "OrthographicCamera.h"
+#include "PinholeCamera.h"
+#include "ThinLensCamera.h"
+
+namespace SPTracer
+{
+
+	CameraModel::CameraModel(const Camera& camera, unsigned int width, unsigned int height)
+		: origin_(camera.p), f_(camera.f)
+	{
+		// orthonormal camera basis, up direction is made orthogonal to view direction
+		forward_ = camera.n.Normalize();
+		right_ = forward_.Cross(camera.up).Normalize();
+		up_ = right_.Cross(forward_);
+
+		// image plane
+		pixelWidth_ = camera.iw / width;
+		pixelHeight_ = camera.ih / height;
+		left_ = camera.icx - camera.iw / 2.0f;
+		top_ = camera.icy + camera.ih / 2.0f;
+	}
+
+	CameraModel::~CameraModel()
+	{
+	}
+
+	std::unique_ptr<CameraModel> CameraModel::Create(const Camera& camera, unsigned int width, unsigned int height)
+	{
+		switch (camera.type)
+		{
+		case CameraType::Pinhole:
+			return std::make_unique<PinholeCamera>(camera, width, height);
+		case CameraType::ThinLens:
+			return std::make_unique<ThinLensCamera>(camera, width, height);
+		case CameraType::Orthographic:
+			return std::make_unique<OrthographicCamera>(camera, width, height);
+		}
+
+		std::string s = "CameraModel: Unknown camera type";
+		Log::Error(s);
+		throw Exception(s);
+	}
+
+	void CameraModel::GenerateRays(const CameraSample* samples, size_t count, Ray* rays) const
+	{
+		float x[BatchSize];
+		float y[BatchSize];
+
+		for (size_t start = 0; start < count; start += BatchSize)
+		{
+			size_t n = std::min(BatchSize, count - start);
+			const CameraSample* s = samples + start;
+
+			// image plane coordinates
+			for (size_t i = 0; i < n; i++)
+			{
+				x[i] = left_ + s[i].x * pixelWidth_;
+				y[i] = top_ - s[i].y * pixelHeight_;
+			}
+
+			GenerateBatch(s, x, y, n, rays + start);
+		}
+	}
+
+	bool CameraModel::Project(const Vec3&, float&, float&) const
+	{
+		// lens and parallel projections are reached only by camera rays
+		return false;
+	}
+
+	float CameraModel::GetDirectionPdf(const Vec3&) const
+	{
+		// only pinhole camera is connected to light subpaths
+		return 0.0f;
+	}
+
+	void CameraModel::ToWorldDirections(const float* x, const float* y, const float* z, size_t count, Ray* rays) const
+	{
+		float dx[BatchSize];
+		float dy[BatchSize];
+		float dz[BatchSize];
+
+		// change of basis and normalization in SoA layout
+		for (size_t i = 0; i < count; i++)
+		{
+			float wx = x[i] * right_[0] + y[i] * up_[0] + z[i] * forward_[0];
+			float wy = x[i] * right_[1] + y[i] * up_[1] + z[i] * forward_[1];
+			float wz = x[i] * right_[2] + y[i] * up_[2] + z[i] * forward_[2];
+			float invLength = 1.0f / std::sqrt(wx * wx + wy * wy + wz * wz);
+			dx[i] = wx * invLength;
+			dy[i] = wy * invLength;
+			dz[i] = wz * invLength;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			rays[i].direction = Vec3(dx[i], dy[i], dz[i]);
+		}
+	}
+
+}
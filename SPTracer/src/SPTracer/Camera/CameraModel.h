@@ -0,0 +1,59 @@
+#ifndef SPT_CAMERA_MODEL_H
+#define SPT_CAMERA_MODEL_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+
+namespace SPTracer
+{
+	struct Camera;
+	struct CameraSample;
+	struct Ray;
+
+	// Generates primary rays. Camera to world basis is computed once,
+	// rays are generated in batches with vectorizable loops.
+	class CameraModel
+	{
+	public:
+		// number of rays processed together
+		static const size_t BatchSize = 16;
+
+		CameraModel(const Camera& camera, unsigned int width, unsigned int height);
+		virtual ~CameraModel();
+
+		// creates camera model of the camera type
+		static std::unique_ptr<CameraModel> Create(const Camera& camera, unsigned int width, unsigned int height);
+
+		// generates primary rays for film samples
+		void GenerateRays(const CameraSample* samples, size_t count, Ray* rays) const;
+
+		// projects point to film coordinates in pixels, returns false if the point
+		// is outside of the image or the camera can not be connected to
+		virtual bool Project(const Vec3& point, float& x, float& y) const;
+
+		// solid angle density of generating primary ray direction, which is also
+		// the importance emitted by the camera, zero if it can not be connected to
+		virtual float GetDirectionPdf(const Vec3& direction) const;
+
+	protected:
+		Vec3 origin_;		// center of projection
+		Vec3 right_;		// camera x-axis
+		Vec3 up_;			// camera y-axis
+		Vec3 forward_;		// camera z-axis (view direction)
+		float f_;			// distance to image plane
+		float left_;		// image plane left edge
+		float top_;			// image plane top edge
+		float pixelWidth_;
+		float pixelHeight_;
+
+		// generates rays for one batch (count <= BatchSize),
+		// x and y are camera space image plane coordinates
+		virtual void GenerateBatch(const CameraSample* samples, const float* x, const float* y, size_t count, Ray* rays) const = 0;
+
+		// transforms camera space vectors to normalized world space directions
+		void ToWorldDirections(const float* x, const float* y, const float* z, size_t count, Ray* rays) const;
+	};
+
+}
+
+#endif
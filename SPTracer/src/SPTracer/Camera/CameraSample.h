@@ -0,0 +1,17 @@
+#ifndef SPT_CAMERA_SAMPLE_H
+#define SPT_CAMERA_SAMPLE_H
+
+namespace SPTracer
+{
+
+	struct CameraSample
+	{
+		float x;		// film position in pixels (column + offset)
+		float y;		// film position in pixels (row + offset)
+		float lensU;	// lens sample in [0, 1)
+		float lensV;	// lens sample in [0, 1)
+	};
+
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SPT_CAMERA_TYPE_H
+#define SPT_CAMERA_TYPE_H
+
+namespace SPTracer
+{
+
+	enum class CameraType
+	{
+		Pinhole,
+		ThinLens,
+		Orthographic
+	};
+
+}
+
+#endif
@@ -0,0 +1,25 @@
+#include "../stdafx.h"
+#include "../Tracer/Ray.h"
+#include "Camera.h"
+#include "CameraSample.h"
+#include "OrthographicCamera.h"
+
+namespace SPTracer
+{
+
+	OrthographicCamera::OrthographicCamera(const Camera& camera, unsigned int width, unsigned int height)
+		: CameraModel(camera, width, height)
+	{
+	}
+
+	void OrthographicCamera::GenerateBatch(const CameraSample* samples, const float* x, const float* y, size_t count, Ray* rays) const
+	{
+		// image plane is the film, all rays are parallel to view direction
+		for (size_t i = 0; i < count; i++)
+		{
+			rays[i].origin = origin_ + x[i] * right_ + y[i] * up_;
+			rays[i].direction = forward_;
+		}
+	}
+
+}
@@ -0,0 +1,21 @@
+#ifndef SPT_ORTHOGRAPHIC_CAMERA_H
+#define SPT_ORTHOGRAPHIC_CAMERA_H
+
+#include "../stdafx.h"
+#include "CameraModel.h"
+
+namespace SPTracer
+{
+
+	class OrthographicCamera : public CameraModel
+	{
+	public:
+		OrthographicCamera(const Camera& camera, unsigned int width, unsigned int height);
+
+	protected:
+		virtual void GenerateBatch(const CameraSample* samples, const float* x, const float* y, size_t count, Ray* rays) const override;
+	};
+
+}
+
+#endif
@@ -0,0 +1,61 @@
+#include "../stdafx.h"
+#include "../Tracer/Ray.h"
+#include "Camera.h"
+#include "CameraSample.h"
+#include "PinholeCamera.h"
+
+namespace SPTracer
+{
+
+	PinholeCamera::PinholeCamera(const Camera& camera, unsigned int width, unsigned int height)
+		: CameraModel(camera, width, height),
+		  width_(static_cast<float>(width)), height_(static_cast<float>(height)),
+		  imageArea_(camera.iw * camera.ih)
+	{
+	}
+
+	bool PinholeCamera::Project(const Vec3& point, float& x, float& y) const
+	{
+		// point in camera space, it must be in front of the camera
+		Vec3 v = point - origin_;
+		float z = v.Dot(forward_);
+		if (z <= 0.0f)
+		{
+			return false;
+		}
+
+		// intersection with image plane, in pixels
+		float scale = f_ / z;
+		x = (v.Dot(right_) * scale - left_) / pixelWidth_;
+		y = (top_ - v.Dot(up_) * scale) / pixelHeight_;
+
+		return (x >= 0.0f) && (x < width_) && (y >= 0.0f) && (y < height_);
+	}
+
+	float PinholeCamera::GetDirectionPdf(const Vec3& direction) const
+	{
+		// uniform density on image plane, converted to solid angle:
+		// dA = f^2 / cos^3 dw
+		float cosTheta = direction.Dot(forward_);
+		if (cosTheta <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		return f_ * f_ / (imageArea_ * cosTheta * cosTheta * cosTheta);
+	}
+
+	void PinholeCamera::GenerateBatch(const CameraSample* samples, const float* x, const float* y, size_t count, Ray* rays) const
+	{
+		// all rays start in the center of projection
+		float z[BatchSize];
+		for (size_t i = 0; i < count; i++)
+		{
+			z[i] = f_;
+			rays[i].origin = origin_;
+		}
+
+		ToWorldDirections(x, y, z, count, rays);
+	}
+
+}
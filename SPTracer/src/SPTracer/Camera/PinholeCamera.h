@@ -0,0 +1,29 @@
+#ifndef SPT_PINHOLE_CAMERA_H
+#define SPT_PINHOLE_CAMERA_H
+
+#include "../stdafx.h"
+#include "CameraModel.h"
+
+namespace SPTracer
+{
+
+	class PinholeCamera : public CameraModel
+	{
+	public:
+		PinholeCamera(const Camera& camera, unsigned int width, unsigned int height);
+
+		virtual bool Project(const Vec3& point, float& x, float& y) const override;
+		virtual float GetDirectionPdf(const Vec3& direction) const override;
+
+	protected:
+		virtual void GenerateBatch(const CameraSample* samples, const float* x, const float* y, size_t count, Ray* rays) const override;
+
+	private:
+		float width_;		// image width in pixels
+		float height_;		// image height in pixels
+		float imageArea_;	// area of image plane
+	};
+
+}
+
+#endif
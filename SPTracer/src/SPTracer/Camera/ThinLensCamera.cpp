@@ -0,0 +1,65 @@
+#include "../stdafx.h"
+#include "../Util.h"
+#include "../Tracer/Ray.h"
+#include "Camera.h"
+#include "CameraSample.h"
+#include "ThinLensCamera.h"
+
+namespace SPTracer
+{
+
+	ThinLensCamera::ThinLensCamera(const Camera& camera, unsigned int width, unsigned int height)
+		: CameraModel(camera, width, height), lensRadius_(camera.lensRadius)
+	{
+		// image plane is in focus if focus distance is not set
+		focusScale_ = camera.focusDistance > 0.0f ? camera.focusDistance / camera.f : 1.0f;
+	}
+
+	void ThinLensCamera::GenerateBatch(const CameraSample* samples, const float* x, const float* y, size_t count, Ray* rays) const
+	{
+		float lensX[BatchSize];
+		float lensY[BatchSize];
+		float dx[BatchSize];
+		float dy[BatchSize];
+		float dz[BatchSize];
+
+		for (size_t i = 0; i < count; i++)
+		{
+			// concentric mapping of lens sample to disk
+			float a = 2.0f * samples[i].lensU - 1.0f;
+			float b = 2.0f * samples[i].lensV - 1.0f;
+			float r, phi;
+			if (a * a > b * b)
+			{
+				r = a;
+				phi = (Util::Pi / 4.0f) * (b / a);
+			}
+			else if (b != 0.0f)
+			{
+				r = b;
+				phi = (Util::Pi / 2.0f) - (Util::Pi / 4.0f) * (a / b);
+			}
+			else
+			{
+				r = 0.0f;
+				phi = 0.0f;
+			}
+
+			lensX[i] = lensRadius_ * r * std::cos(phi);
+			lensY[i] = lensRadius_ * r * std::sin(phi);
+
+			// direction from lens point to point on the plane in focus
+			dx[i] = x[i] * focusScale_ - lensX[i];
+			dy[i] = y[i] * focusScale_ - lensY[i];
+			dz[i] = f_ * focusScale_;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			rays[i].origin = origin_ + lensX[i] * right_ + lensY[i] * up_;
+		}
+
+		ToWorldDirections(dx, dy, dz, count, rays);
+	}
+
+}
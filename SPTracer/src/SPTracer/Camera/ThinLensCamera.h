@@ -0,0 +1,25 @@
+#ifndef SPT_THIN_LENS_CAMERA_H
+#define SPT_THIN_LENS_CAMERA_H
+
+#include "../stdafx.h"
+#include "CameraModel.h"
+
+namespace SPTracer
+{
+
+	class ThinLensCamera : public CameraModel
+	{
+	public:
+		ThinLensCamera(const Camera& camera, unsigned int width, unsigned int height);
+
+	protected:
+		virtual void GenerateBatch(const CameraSample* samples, const float* x, const float* y, size_t count, Ray* rays) const override;
+
+	private:
+		float lensRadius_;
+		float focusScale_;	// ratio of focus distance to image plane distance
+	};
+
+}
+
+#endif
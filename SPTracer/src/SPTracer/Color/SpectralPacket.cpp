@@ -0,0 +1,147 @@
+#include "../stdafx.h"
+#include "SpectralPacket.h"
+
+namespace SPTracer
+{
+
+	const size_t SpectralPacket::Width;
+	const size_t SpectralPacket::Alignment;
+
+	SpectralPacket::SpectralPacket()
+		: size_(0), paddedSize_(0), data_(nullptr)
+	{
+	}
+
+	SpectralPacket::SpectralPacket(size_t size, float value)
+		: size_(size), paddedSize_((size + Width - 1) / Width * Width), data_(nullptr)
+	{
+		if (paddedSize_ != 0)
+		{
+			data_ = static_cast<float*>(_mm_malloc(paddedSize_ * sizeof(float), Alignment));
+			if (data_ == nullptr)
+			{
+				throw std::bad_alloc();
+			}
+
+			std::fill(data_, data_ + size_, value);
+			std::fill(data_ + size_, data_ + paddedSize_, 0.0f);
+		}
+	}
+
+	SpectralPacket::SpectralPacket(const SpectralPacket& other)
+		: SpectralPacket(other.size_)
+	{
+		std::copy(other.data_, other.data_ + paddedSize_, data_);
+	}
+
+	SpectralPacket::SpectralPacket(SpectralPacket&& other)
+		: size_(other.size_), paddedSize_(other.paddedSize_), data_(other.data_)
+	{
+		other.size_ = 0;
+		other.paddedSize_ = 0;
+		other.data_ = nullptr;
+	}
+
+	SpectralPacket::~SpectralPacket()
+	{
+		if (data_ != nullptr)
+		{
+			_mm_free(data_);
+		}
+	}
+
+	SpectralPacket& SpectralPacket::operator=(SpectralPacket other)
+	{
+		std::swap(size_, other.size_);
+		std::swap(paddedSize_, other.paddedSize_);
+		std::swap(data_, other.data_);
+		return *this;
+	}
+
+	void SpectralPacket::Fill(float value)
+	{
+		std::fill(data_, data_ + size_, value);
+	}
+
+	void SpectralPacket::Scale(const SpectralPacket& a, float s)
+	{
+		__m128 vs = _mm_set1_ps(s);
+		for (size_t i = 0; i < paddedSize_; i += Width)
+		{
+			_mm_store_ps(data_ + i, _mm_mul_ps(_mm_load_ps(a.data_ + i), vs));
+		}
+	}
+
+	void SpectralPacket::Multiply(const SpectralPacket& a)
+	{
+		for (size_t i = 0; i < paddedSize_; i += Width)
+		{
+			_mm_store_ps(data_ + i, _mm_mul_ps(_mm_load_ps(data_ + i), _mm_load_ps(a.data_ + i)));
+		}
+	}
+
+	void SpectralPacket::MultiplyScaled(const SpectralPacket& a, float s)
+	{
+		__m128 vs = _mm_set1_ps(s);
+		for (size_t i = 0; i < paddedSize_; i += Width)
+		{
+			__m128 v = _mm_mul_ps(_mm_load_ps(a.data_ + i), vs);
+			_mm_store_ps(data_ + i, _mm_mul_ps(_mm_load_ps(data_ + i), v));
+		}
+	}
+
+	void SpectralPacket::Divide(float s)
+	{
+		__m128 vs = _mm_set1_ps(s);
+		for (size_t i = 0; i < paddedSize_; i += Width)
+		{
+			_mm_store_ps(data_ + i, _mm_div_ps(_mm_load_ps(data_ + i), vs));
+		}
+	}
+
+	void SpectralPacket::Combine(const SpectralPacket& a, float sa, const SpectralPacket& b, float sb)
+	{
+		__m128 vsa = _mm_set1_ps(sa);
+		__m128 vsb = _mm_set1_ps(sb);
+		for (size_t i = 0; i < paddedSize_; i += Width)
+		{
+			__m128 va = _mm_mul_ps(_mm_load_ps(a.data_ + i), vsa);
+			__m128 vb = _mm_mul_ps(_mm_load_ps(b.data_ + i), vsb);
+			_mm_store_ps(data_ + i, _mm_add_ps(va, vb));
+		}
+	}
+
+	float SpectralPacket::Max() const
+	{
+		if (size_ == 0)
+		{
+			return 0.0f;
+		}
+
+		// whole registers without padding
+		size_t vectorSize = size_ / Width * Width;
+		float result = data_[0];
+
+		if (vectorSize != 0)
+		{
+			__m128 vmax = _mm_load_ps(data_);
+			for (size_t i = Width; i < vectorSize; i += Width)
+			{
+				vmax = _mm_max_ps(vmax, _mm_load_ps(data_ + i));
+			}
+
+			alignas(16) float lanes[Width];
+			_mm_store_ps(lanes, vmax);
+			result = *std::max_element(lanes, lanes + Width);
+		}
+
+		// remaining values
+		for (size_t i = vectorSize; i < size_; i++)
+		{
+			result = std::max(result, data_[i]);
+		}
+
+		return result;
+	}
+
+}
@@ -0,0 +1,65 @@
+#ifndef SPT_SPECTRAL_PACKET_H
+#define SPT_SPECTRAL_PACKET_H
+
+#include "../stdafx.h"
+
+namespace SPTracer
+{
+
+	// Spectral values stored in aligned memory padded to whole SIMD
+	// registers, so that full spectrum operations are vector code.
+	// Padding values are kept zero.
+	class SpectralPacket
+	{
+	public:
+		static const size_t Width = 4;		// floats in SIMD register
+		static const size_t Alignment = 16;
+
+		SpectralPacket();
+		explicit SpectralPacket(size_t size, float value = 0.0f);
+		SpectralPacket(const SpectralPacket& other);
+		SpectralPacket(SpectralPacket&& other);
+		~SpectralPacket();
+
+		SpectralPacket& operator=(SpectralPacket other);
+
+		size_t size() const { return size_; }
+		float* data() { return data_; }
+		const float* data() const { return data_; }
+		float* begin() { return data_; }
+		float* end() { return data_ + size_; }
+		const float* begin() const { return data_; }
+		const float* end() const { return data_ + size_; }
+
+		float& operator[](size_t i) { return data_[i]; }
+		const float& operator[](size_t i) const { return data_[i]; }
+
+		void Fill(float value);
+
+		// this = a * s
+		void Scale(const SpectralPacket& a, float s);
+
+		// this = this * a
+		void Multiply(const SpectralPacket& a);
+
+		// this = this * a * s
+		void MultiplyScaled(const SpectralPacket& a, float s);
+
+		// this = this / s
+		void Divide(float s);
+
+		// this = a * sa + b * sb
+		void Combine(const SpectralPacket& a, float sa, const SpectralPacket& b, float sb);
+
+		// largest value
+		float Max() const;
+
+	private:
+		size_t size_;
+		size_t paddedSize_;
+		float* data_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#include "../stdafx.h"
+#include "../Log.h"
+#include "../Vec3.h"
+#include "../Tracer/Ray.h"
+#include "Spectrum.h"
+#include "XYZConverter.h"
+#include "WavelengthSampler.h"
+
+namespace SPTracer
+{
+
+	WavelengthSampler::WavelengthSampler(const Spectrum& spectrum, const XYZConverter& xyzConverter, unsigned int waveCount, bool importanceSampling)
+		: spectrumWeight_(1.0f / static_cast<float>(spectrum.count))
+	{
+		std::vector<float> weights(spectrum.count, 1.0f);
+		if (importanceSampling)
+		{
+			for (size_t t = 0; t < spectrum.count; t++)
+			{
+				Vec3 xyz = xyzConverter.GetXYZ(spectrum.values[t]);
+				weights[t] = xyz[0] + xyz[1] + xyz[2];
+			}
+
+			if (std::accumulate(weights.begin(), weights.end(), 0.0f) <= 0.0f)
+			{
+				Log::Warning("WavelengthSampler: Spectrum is not visible, wave lengths are sampled uniformly");
+				std::fill(weights.begin(), weights.end(), 1.0f);
+			}
+		}
+
+		distribution_ = AliasTable(weights);
+
+		// cumulative distribution, ended by the last wave length which can be
+		// sampled, so that rounding never selects wave lengths after it
+		cdf_.resize(spectrum.count);
+		float sum = 0.0f;
+		for (size_t t = 0; t < spectrum.count; t++)
+		{
+			sum += distribution_.GetPdf(t);
+			cdf_[t] = sum;
+		}
+
+		size_t last = spectrum.count - 1;
+		while ((last > 0) && (distribution_.GetPdf(last) == 0.0f))
+		{
+			last--;
+		}
+
+		std::fill(cdf_.begin() + last, cdf_.end(), 1.0f);
+
+		// probability that the packet of every hero wave length contains the wave length
+		std::vector<float> inclusion(spectrum.count, 0.0f);
+		Ray packet;
+		packet.waveIndex = -1;
+		packet.waveCount = static_cast<int>(std::max(waveCount, 1u));
+		for (size_t hero = 0; hero < spectrum.count; hero++)
+		{
+			packet.heroIndex = static_cast<int>(hero);
+			packet.ForEachWave(spectrum.count, [&](size_t t) { inclusion[t] += distribution_.GetPdf(hero); });
+		}
+
+		// wave lengths which are never traced do not need weight
+		waveWeights_.resize(spectrum.count);
+		packetWeights_.resize(spectrum.count);
+		for (size_t t = 0; t < spectrum.count; t++)
+		{
+			float pdf = distribution_.GetPdf(t);
+			waveWeights_[t] = pdf > 0.0f ? spectrumWeight_ / pdf : 0.0f;
+			packetWeights_[t] = inclusion[t] > 0.0f ? spectrumWeight_ / inclusion[t] : 0.0f;
+		}
+	}
+
+	int WavelengthSampler::Sample(float u) const
+	{
+		return static_cast<int>(distribution_.Sample(u));
+	}
+
+	int WavelengthSampler::SampleMonotonic(float u) const
+	{
+		// the first wave length whose cumulative probability exceeds u
+		size_t index = std::upper_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+		return static_cast<int>(std::min(index, cdf_.size() - 1));
+	}
+
+	float WavelengthSampler::GetWeight(const Ray& ray, size_t index) const
+	{
+		if (ray.waveIndex != -1)
+		{
+			return waveWeights_[index];
+		}
+
+		return ray.waveCount == 0 ? spectrumWeight_ : packetWeights_[index];
+	}
+
+}
@@ -0,0 +1,44 @@
+#ifndef SPT_WAVELENGTH_SAMPLER_H
+#define SPT_WAVELENGTH_SAMPLER_H
+
+#include "../stdafx.h"
+#include "../AliasTable.h"
+
+namespace SPTracer
+{
+	struct Ray;
+	struct Spectrum;
+	class XYZConverter;
+
+	// Distribution of the first (hero) wave length of paths. With importance
+	// sampling wave lengths are chosen proportionally to the response of the
+	// observer (sum of the color matching functions), so that wave lengths
+	// hardly visible in the image are rarely or never traced. Radiance of every
+	// wave length of a packet is divided by the probability that the packet
+	// contains it, so that the mean over packets is the mean over the spectrum.
+	class WavelengthSampler
+	{
+	public:
+		WavelengthSampler(const Spectrum& spectrum, const XYZConverter& xyzConverter, unsigned int waveCount, bool importanceSampling);
+
+		// hero wave index for uniform value in [0, 1)
+		int Sample(float u) const;
+
+		// hero wave index for uniform value in [0, 1) by inverting the cumulative distribution,
+		// close values give close wave lengths, so that small mutations of the value are small
+		int SampleMonotonic(float u) const;
+
+		// scale of radiance of wave index carried by the ray, 1 / spectrum count for full spectrum
+		float GetWeight(const Ray& ray, size_t index) const;
+
+	private:
+		AliasTable distribution_;
+		std::vector<float> cdf_;			// cumulative distribution for monotonic sampling
+		std::vector<float> waveWeights_;	// single wave length rays
+		std::vector<float> packetWeights_;	// hero packets
+		float spectrumWeight_;				// full spectrum rays
+	};
+
+}
+
+#endif
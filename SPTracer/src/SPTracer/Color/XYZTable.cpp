@@ -0,0 +1,67 @@
+#include "../stdafx.h"
+#include "Spectrum.h"
+#include "XYZConverter.h"
+#include "XYZTable.h"
+
+namespace SPTracer
+{
+
+	namespace
+	{
+		// sum of register lanes
+		float HorizontalSum(__m128 v)
+		{
+			alignas(16) float lanes[SpectralPacket::Width];
+			_mm_store_ps(lanes, v);
+			return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+		}
+	}
+
+	XYZTable::XYZTable(const Spectrum& spectrum, const XYZConverter& xyzConverter)
+		: x_(spectrum.count), y_(spectrum.count), z_(spectrum.count)
+	{
+		float spectrumWeight = 1.0f / static_cast<float>(spectrum.count);
+		for (size_t t = 0; t < spectrum.count; t++)
+		{
+			Vec3 xyz = xyzConverter.GetXYZ(spectrum.values[t]);
+			xyz_.push_back(xyz);
+			x_[t] = xyz[0] * spectrumWeight;
+			y_[t] = xyz[1] * spectrumWeight;
+			z_[t] = xyz[2] * spectrumWeight;
+		}
+	}
+
+	Vec3 XYZTable::Reduce(const SpectralPacket& radiance, float scale) const
+	{
+		// padding of packets is zero, so whole registers are summed
+		__m128 vx = _mm_setzero_ps();
+		__m128 vy = _mm_setzero_ps();
+		__m128 vz = _mm_setzero_ps();
+		for (size_t i = 0; i < x_.size(); i += SpectralPacket::Width)
+		{
+			__m128 v = _mm_load_ps(radiance.data() + i);
+			vx = _mm_add_ps(vx, _mm_mul_ps(v, _mm_load_ps(x_.data() + i)));
+			vy = _mm_add_ps(vy, _mm_mul_ps(v, _mm_load_ps(y_.data() + i)));
+			vz = _mm_add_ps(vz, _mm_mul_ps(v, _mm_load_ps(z_.data() + i)));
+		}
+
+		return Vec3(HorizontalSum(vx) * scale, HorizontalSum(vy) * scale, HorizontalSum(vz) * scale);
+	}
+
+	Vec3 XYZTable::Reduce(const SpectralPacket& radiance, const SpectralPacket& weight, float scale) const
+	{
+		__m128 vx = _mm_setzero_ps();
+		__m128 vy = _mm_setzero_ps();
+		__m128 vz = _mm_setzero_ps();
+		for (size_t i = 0; i < x_.size(); i += SpectralPacket::Width)
+		{
+			__m128 v = _mm_mul_ps(_mm_load_ps(radiance.data() + i), _mm_load_ps(weight.data() + i));
+			vx = _mm_add_ps(vx, _mm_mul_ps(v, _mm_load_ps(x_.data() + i)));
+			vy = _mm_add_ps(vy, _mm_mul_ps(v, _mm_load_ps(y_.data() + i)));
+			vz = _mm_add_ps(vz, _mm_mul_ps(v, _mm_load_ps(z_.data() + i)));
+		}
+
+		return Vec3(HorizontalSum(vx) * scale, HorizontalSum(vy) * scale, HorizontalSum(vz) * scale);
+	}
+
+}
@@ -0,0 +1,44 @@
+#ifndef SPT_XYZ_TABLE_H
+#define SPT_XYZ_TABLE_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "SpectralPacket.h"
+
+namespace SPTracer
+{
+	struct Spectrum;
+	class XYZConverter;
+
+	// Color matching functions sampled once on the wave lengths of the spectrum.
+	// Every function is stored as spectral packet (structure of arrays) weighted
+	// by 1 / spectrum count, so that full spectrum radiance is reduced to the
+	// mean XYZ color with vector code. Single wave lengths are looked up by
+	// index, without virtual call of the converter.
+	class XYZTable
+	{
+	public:
+		XYZTable(const Spectrum& spectrum, const XYZConverter& xyzConverter);
+
+		// color matching functions at wave index, not weighted
+		const Vec3& GetXYZ(size_t index) const
+		{
+			return xyz_[index];
+		}
+
+		// mean XYZ color of radiance over the spectrum, times scale
+		Vec3 Reduce(const SpectralPacket& radiance, float scale) const;
+
+		// mean XYZ color of radiance times weight over the spectrum, times scale
+		Vec3 Reduce(const SpectralPacket& radiance, const SpectralPacket& weight, float scale) const;
+
+	private:
+		std::vector<Vec3> xyz_;
+		SpectralPacket x_;
+		SpectralPacket y_;
+		SpectralPacket z_;
+	};
+
+}
+
+#endif
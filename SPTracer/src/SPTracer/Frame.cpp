@@ -0,0 +1,49 @@
+#include "stdafx.h"
+#include "Frame.h"
+
+namespace SPTracer
+{
+
+	Frame::Frame()
+		: s_(1.0f, 0.0f, 0.0f), t_(0.0f, 1.0f, 0.0f), n_(0.0f, 0.0f, 1.0f)
+	{
+	}
+
+	Frame::Frame(const Vec3& normal)
+		: n_(normal)
+	{
+		// branchless construction of orthonormal basis
+		// (Duff et al., Building an Orthonormal Basis, Revisited)
+		float sign = std::copysign(1.0f, n_[2]);
+		float a = -1.0f / (sign + n_[2]);
+		float b = n_[0] * n_[1] * a;
+		s_ = Vec3(1.0f + sign * n_[0] * n_[0] * a, sign * b, -sign * n_[0]);
+		t_ = Vec3(b, sign + n_[1] * n_[1] * a, -n_[1]);
+	}
+
+	const Vec3& Frame::s() const
+	{
+		return s_;
+	}
+
+	const Vec3& Frame::t() const
+	{
+		return t_;
+	}
+
+	const Vec3& Frame::n() const
+	{
+		return n_;
+	}
+
+	Vec3 Frame::ToLocal(const Vec3& v) const
+	{
+		return Vec3(v.Dot(s_), v.Dot(t_), v.Dot(n_));
+	}
+
+	Vec3 Frame::ToWorld(const Vec3& v) const
+	{
+		return v[0] * s_ + v[1] * t_ + v[2] * n_;
+	}
+
+}
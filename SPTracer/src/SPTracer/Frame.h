@@ -0,0 +1,34 @@
+#ifndef SPT_FRAME_H
+#define SPT_FRAME_H
+
+#include "stdafx.h"
+#include "Vec3.h"
+
+namespace SPTracer
+{
+
+	// Orthonormal basis with z-axis along the given normal.
+	// Local coordinates are used for sampling and evaluation of materials.
+	class Frame
+	{
+	public:
+		Frame();
+		explicit Frame(const Vec3& normal);
+
+		const Vec3& s() const;
+		const Vec3& t() const;
+		const Vec3& n() const;
+
+		// change of basis
+		Vec3 ToLocal(const Vec3& v) const;
+		Vec3 ToWorld(const Vec3& v) const;
+
+	private:
+		Vec3 s_;	// tangent
+		Vec3 t_;	// bitangent
+		Vec3 n_;	// normal
+	};
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef SPT_ATOMIC_FLOAT_H
+#define SPT_ATOMIC_FLOAT_H
+
+#include "../stdafx.h"
+
+namespace SPTracer
+{
+
+	// Float with atomic addition. It is copyable, so that it can be stored
+	// in vectors, but copies are not atomic and are made only while
+	// no thread is adding values.
+	class AtomicFloat
+	{
+	public:
+		AtomicFloat(float value = 0.0f) : value_(value) { }
+		AtomicFloat(const AtomicFloat& other) : value_(other.load()) { }
+
+		AtomicFloat& operator=(const AtomicFloat& other)
+		{
+			value_.store(other.load(), std::memory_order_relaxed);
+			return *this;
+		}
+
+		float load() const
+		{
+			return value_.load(std::memory_order_relaxed);
+		}
+
+		void Add(float value)
+		{
+			float current = value_.load(std::memory_order_relaxed);
+			while (!value_.compare_exchange_weak(current, current + value, std::memory_order_relaxed))
+			{
+			}
+		}
+
+	private:
+		std::atomic<float> value_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,218 @@
+#include "../stdafx.h"
+#include "../Util.h"
+#include "../Vec3.h"
+#include "../Sampler/Sampler.h"
+#include "DTree.h"
+
+namespace SPTracer
+{
+
+	DTree::DTree()
+		: nodes_(1)
+	{
+	}
+
+	float DTree::total() const
+	{
+		const Node& root = nodes_[0];
+		return root.sums[0].load() + root.sums[1].load() + root.sums[2].load() + root.sums[3].load();
+	}
+
+	size_t DTree::nodeCount() const
+	{
+		return nodes_.size();
+	}
+
+	void DTree::Record(const Vec3& direction, float value)
+	{
+		if (value <= 0.0f)
+		{
+			return;
+		}
+
+		float x, y;
+		DirectionToSquare(direction, x, y);
+
+		// energy of node is the sum of its quadrants,
+		// so value is added on every level
+		size_t node = 0;
+		while (true)
+		{
+			size_t quadrant = GetQuadrant(x, y);
+			nodes_[node].sums[quadrant].Add(value);
+
+			if (nodes_[node].children[quadrant] == 0)
+			{
+				break;
+			}
+			node = nodes_[node].children[quadrant];
+		}
+	}
+
+	Vec3 DTree::Sample(Sampler& sampler) const
+	{
+		// lower corner and size of the sampled square
+		float x = 0.0f;
+		float y = 0.0f;
+		float size = 1.0f;
+
+		size_t node = 0;
+		while (true)
+		{
+			const Node& n = nodes_[node];
+			std::array<float, 4> sums = { n.sums[0].load(), n.sums[1].load(), n.sums[2].load(), n.sums[3].load() };
+			float total = sums[0] + sums[1] + sums[2] + sums[3];
+			if (total <= 0.0f)
+			{
+				break;
+			}
+
+			// choose quadrant proportionally to its energy
+			float u = sampler.Get1D() * total;
+			size_t quadrant = 0;
+			while ((quadrant < 3) && ((u >= sums[quadrant]) || (sums[quadrant] <= 0.0f)))
+			{
+				u -= sums[quadrant];
+				quadrant++;
+			}
+
+			// rounding can move past the last non-empty quadrant
+			while (sums[quadrant] <= 0.0f)
+			{
+				quadrant--;
+			}
+
+			size *= 0.5f;
+			x += static_cast<float>(quadrant & 1) * size;
+			y += static_cast<float>(quadrant >> 1) * size;
+
+			if (n.children[quadrant] == 0)
+			{
+				break;
+			}
+			node = n.children[quadrant];
+		}
+
+		// uniform point in the square
+		float u, v;
+		sampler.Get2D(u, v);
+		return SquareToDirection(x + u * size, y + v * size);
+	}
+
+	float DTree::GetPdf(const Vec3& direction) const
+	{
+		float x, y;
+		DirectionToSquare(direction, x, y);
+
+		// density in the unit square
+		float pdf = 1.0f;
+		size_t node = 0;
+		while (true)
+		{
+			const Node& n = nodes_[node];
+			float total = n.sums[0].load() + n.sums[1].load() + n.sums[2].load() + n.sums[3].load();
+			if (total <= 0.0f)
+			{
+				break;
+			}
+
+			size_t quadrant = GetQuadrant(x, y);
+			pdf *= 4.0f * n.sums[quadrant].load() / total;
+
+			if ((pdf <= 0.0f) || (n.children[quadrant] == 0))
+			{
+				break;
+			}
+			node = n.children[quadrant];
+		}
+
+		// the mapping preserves area, unit square maps to the whole sphere
+		return pdf / (4.0f * Util::Pi);
+	}
+
+	DTree DTree::Refine(const DTree& source, float threshold, size_t maxDepth)
+	{
+		DTree tree;
+
+		float total = source.total();
+		if (total <= 0.0f)
+		{
+			return tree;
+		}
+
+		// node of the new tree with corresponding source node, or energy
+		// of the source quadrant which is split uniformly when source has no node
+		struct Item
+		{
+			std::uint32_t node;
+			std::uint32_t sourceNode;
+			bool hasSourceNode;
+			float energy;
+			size_t depth;
+		};
+
+		std::vector<Item> stack;
+		stack.push_back({ 0, 0, true, total, 1 });
+
+		while (!stack.empty())
+		{
+			Item item = stack.back();
+			stack.pop_back();
+
+			for (size_t i = 0; i < 4; i++)
+			{
+				float energy = item.energy * 0.25f;
+				bool hasSourceNode = false;
+				std::uint32_t sourceNode = 0;
+				if (item.hasSourceNode)
+				{
+					const Node& s = source.nodes_[item.sourceNode];
+					energy = s.sums[i].load();
+					hasSourceNode = s.children[i] != 0;
+					sourceNode = s.children[i];
+				}
+
+				if ((item.depth < maxDepth) && (energy / total > threshold))
+				{
+					std::uint32_t child = static_cast<std::uint32_t>(tree.nodes_.size());
+					tree.nodes_.emplace_back();
+					tree.nodes_[item.node].children[i] = child;
+					stack.push_back({ child, sourceNode, hasSourceNode, energy, item.depth + 1 });
+				}
+			}
+		}
+
+		return tree;
+	}
+
+	size_t DTree::GetQuadrant(float& x, float& y)
+	{
+		size_t qx = x < 0.5f ? 0 : 1;
+		size_t qy = y < 0.5f ? 0 : 1;
+		x = 2.0f * x - static_cast<float>(qx);
+		y = 2.0f * y - static_cast<float>(qy);
+		return qx + 2 * qy;
+	}
+
+	Vec3 DTree::SquareToDirection(float x, float y)
+	{
+		float cosTheta = 2.0f * x - 1.0f;
+		float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+		float phi = 2.0f * Util::Pi * y;
+		return Vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+	}
+
+	void DTree::DirectionToSquare(const Vec3& direction, float& x, float& y)
+	{
+		float cosTheta = std::max(-1.0f, std::min(direction[2], 1.0f));
+		float phi = std::atan2(direction[1], direction[0]);
+		if (phi < 0.0f)
+		{
+			phi += 2.0f * Util::Pi;
+		}
+
+		x = std::min(0.5f * (cosTheta + 1.0f), std::nextafter(1.0f, 0.0f));
+		y = std::min(phi / (2.0f * Util::Pi), std::nextafter(1.0f, 0.0f));
+	}
+
+}
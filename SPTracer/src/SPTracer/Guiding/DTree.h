@@ -0,0 +1,58 @@
+#ifndef SPT_D_TREE_H
+#define SPT_D_TREE_H
+
+#include "../stdafx.h"
+#include "AtomicFloat.h"
+
+namespace SPTracer
+{
+	class Sampler;
+	class Vec3;
+
+	// Directional quadtree over the sphere of directions. Directions are
+	// mapped to the unit square with the area preserving cylindrical
+	// mapping (cos(theta), phi), and every node stores the energy recorded
+	// in its four quadrants. Quadrants with large energy are subdivided,
+	// so that the tree adapts to incident radiance.
+	class DTree
+	{
+	public:
+		DTree();
+
+		// recorded energy
+		float total() const;
+		size_t nodeCount() const;
+
+		// adds energy to all nodes containing the direction (thread safe)
+		void Record(const Vec3& direction, float value);
+
+		// samples direction proportionally to recorded energy, total must not be zero
+		Vec3 Sample(Sampler& sampler) const;
+
+		// solid angle density of sampling direction
+		float GetPdf(const Vec3& direction) const;
+
+		// empty tree with structure adapted to the energy of source:
+		// quadrants holding more than threshold fraction of energy are subdivided
+		static DTree Refine(const DTree& source, float threshold, size_t maxDepth);
+
+	private:
+		struct Node
+		{
+			std::array<AtomicFloat, 4> sums;
+			std::array<std::uint32_t, 4> children = { { 0, 0, 0, 0 } };	// 0 for quadrant without child node
+		};
+
+		std::vector<Node> nodes_;
+
+		// quadrant containing point, point is transformed into quadrant coordinates
+		static size_t GetQuadrant(float& x, float& y);
+
+		// mapping between unit square and directions
+		static Vec3 SquareToDirection(float x, float y);
+		static void DirectionToSquare(const Vec3& direction, float& x, float& y);
+	};
+
+}
+
+#endif
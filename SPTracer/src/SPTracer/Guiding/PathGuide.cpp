@@ -0,0 +1,78 @@
+#include "../stdafx.h"
+#include "../Log.h"
+#include "../Vec3.h"
+#include "DTree.h"
+#include "PathGuide.h"
+
+namespace SPTracer
+{
+
+	const float PathGuide::SpatialThreshold = 12000.0f;
+	const float PathGuide::DirectionalThreshold = 0.01f;
+	const size_t PathGuide::MaxDirectionalDepth = 20;
+
+	PathGuide::PathGuide(const Box& box, unsigned int trainingIterations, float bsdfSamplingFraction)
+		: sdTree_(box), trainingIterations_(trainingIterations),
+		  bsdfSamplingFraction_(std::max(0.0f, std::min(bsdfSamplingFraction, 1.0f))),
+		  training_(trainingIterations > 0)
+	{
+	}
+
+	float PathGuide::bsdfSamplingFraction() const
+	{
+		return bsdfSamplingFraction_;
+	}
+
+	bool PathGuide::training() const
+	{
+		return training_.load(std::memory_order_relaxed);
+	}
+
+	std::shared_lock<std::shared_timed_mutex> PathGuide::Lock() const
+	{
+		return std::shared_lock<std::shared_timed_mutex>(mutex_);
+	}
+
+	const DTree* PathGuide::GetSamplingTree(const Vec3& point) const
+	{
+		const DTree& tree = sdTree_.GetSamplingTree(point);
+		return tree.total() > 0.0f ? &tree : nullptr;
+	}
+
+	void PathGuide::Record(const Vec3& point, const Vec3& direction, float value)
+	{
+		sdTree_.Record(point, direction, value);
+	}
+
+	void PathGuide::CompletePass()
+	{
+		if (!training())
+		{
+			return;
+		}
+
+		// iteration has twice as many passes as the previous one
+		iterationPasses_++;
+		if (iterationPasses_ < (1ul << iteration_))
+		{
+			return;
+		}
+
+		// wait for passes using the current distributions
+		std::unique_lock<std::shared_timed_mutex> lock(mutex_);
+
+		float spatialThreshold = SpatialThreshold * std::sqrt(static_cast<float>(1ul << iteration_));
+		sdTree_.Refine(spatialThreshold, DirectionalThreshold, MaxDirectionalDepth);
+
+		iteration_++;
+		iterationPasses_ = 0;
+		if (iteration_ >= trainingIterations_)
+		{
+			training_ = false;
+		}
+
+		Log::Info("PathGuide: Training iteration " + std::to_string(iteration_) + " of " +
+			std::to_string(trainingIterations_) + " completed, spatial leaves " + std::to_string(sdTree_.leafCount()));
+	}
+
+}
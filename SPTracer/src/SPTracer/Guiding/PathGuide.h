@@ -0,0 +1,60 @@
+#ifndef SPT_PATH_GUIDE_H
+#define SPT_PATH_GUIDE_H
+
+#include "../stdafx.h"
+#include "SDTree.h"
+
+namespace SPTracer
+{
+	class Box;
+	class DTree;
+	class Vec3;
+
+	// Online learning of incident radiance for guiding path directions.
+	// Training runs in iterations with doubling number of passes. Radiance
+	// is recorded while passes are traced, and at the end of iteration the
+	// SD-tree is refined, while passes are blocked by exclusive lock.
+	class PathGuide
+	{
+	public:
+		PathGuide(const Box& box, unsigned int trainingIterations, float bsdfSamplingFraction);
+
+		// probability to sample BSDF instead of guiding distribution
+		float bsdfSamplingFraction() const;
+
+		// radiance is recorded only during training
+		bool training() const;
+
+		// shared lock held while pass is traced
+		std::shared_lock<std::shared_timed_mutex> Lock() const;
+
+		// guiding distribution at point, nullptr if nothing is learned yet
+		const DTree* GetSamplingTree(const Vec3& point) const;
+
+		// adds radiance arriving at point from direction, divided by density of direction
+		void Record(const Vec3& point, const Vec3& direction, float value);
+
+		// called after every completed pass, refines SD-tree at the end of iteration
+		void CompletePass();
+
+	private:
+		// samples recorded in a leaf of the first iteration, before it is split,
+		// grows with square root of the number of passes
+		static const float SpatialThreshold;
+
+		// fraction of energy in directional quadrant, before it is subdivided
+		static const float DirectionalThreshold;
+		static const size_t MaxDirectionalDepth;
+
+		SDTree sdTree_;
+		mutable std::shared_timed_mutex mutex_;
+		const unsigned int trainingIterations_;
+		const float bsdfSamplingFraction_;
+		unsigned int iteration_ = 0;
+		unsigned long iterationPasses_ = 0;
+		std::atomic<bool> training_;
+	};
+
+}
+
+#endif
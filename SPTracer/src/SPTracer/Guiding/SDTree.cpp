@@ -0,0 +1,98 @@
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "SDTree.h"
+
+namespace SPTracer
+{
+
+	SDTree::SDTree(const Box& box)
+		: box_(box), nodes_(1)
+	{
+	}
+
+	size_t SDTree::leafCount() const
+	{
+		return leafCount_;
+	}
+
+	const DTree& SDTree::GetSamplingTree(const Vec3& point) const
+	{
+		return nodes_[FindLeaf(point)].sampling;
+	}
+
+	void SDTree::Record(const Vec3& point, const Vec3& direction, float value)
+	{
+		Node& node = nodes_[FindLeaf(point)];
+		node.samples.Add(1.0f);
+		node.building.Record(direction, value);
+	}
+
+	void SDTree::Refine(float spatialThreshold, float directionalThreshold, size_t maxDepth)
+	{
+		// split leaves, children share samples of the parent equally,
+		// so that they are split further while they have enough of them
+		for (size_t i = 0; i < nodes_.size(); i++)
+		{
+			if ((nodes_[i].children[0] != 0) || (nodes_[i].samples.load() <= spatialThreshold))
+			{
+				continue;
+			}
+
+			unsigned char childAxis = static_cast<unsigned char>((nodes_[i].axis + 1) % 3);
+			float childSamples = 0.5f * nodes_[i].samples.load();
+			for (size_t c = 0; c < 2; c++)
+			{
+				Node child;
+				child.axis = childAxis;
+				child.building = nodes_[i].building;
+				child.sampling = nodes_[i].sampling;
+				child.samples = childSamples;
+
+				nodes_[i].children[c] = static_cast<std::uint32_t>(nodes_.size());
+				nodes_.push_back(std::move(child));
+			}
+
+			// inner nodes do not keep directional trees
+			nodes_[i].building = DTree();
+			nodes_[i].sampling = DTree();
+			leafCount_++;
+		}
+
+		// collected radiance is used for sampling in the next iteration
+		for (Node& node : nodes_)
+		{
+			if (node.children[0] == 0)
+			{
+				node.sampling = node.building;
+				node.building = DTree::Refine(node.sampling, directionalThreshold, maxDepth);
+				node.samples = 0.0f;
+			}
+		}
+	}
+
+	size_t SDTree::FindLeaf(const Vec3& point) const
+	{
+		Vec3 min = box_.min();
+		Vec3 max = box_.max();
+
+		size_t node = 0;
+		while (nodes_[node].children[0] != 0)
+		{
+			const Node& n = nodes_[node];
+			float middle = 0.5f * (min[n.axis] + max[n.axis]);
+			if (point[n.axis] < middle)
+			{
+				max[n.axis] = middle;
+				node = n.children[0];
+			}
+			else
+			{
+				min[n.axis] = middle;
+				node = n.children[1];
+			}
+		}
+
+		return node;
+	}
+
+}
@@ -0,0 +1,54 @@
+#ifndef SPT_SD_TREE_H
+#define SPT_SD_TREE_H
+
+#include "../stdafx.h"
+#include "../Primitive/Box.h"
+#include "DTree.h"
+
+namespace SPTracer
+{
+	class Vec3;
+
+	// Spatial binary tree over the scene box with a pair of directional
+	// trees in every leaf: one used for sampling, the other collecting
+	// radiance during the current training iteration. Leaves are split
+	// in the middle along cycling axes when they collect enough samples.
+	class SDTree
+	{
+	public:
+		explicit SDTree(const Box& box);
+
+		size_t leafCount() const;
+
+		// directional distribution for sampling at point
+		const DTree& GetSamplingTree(const Vec3& point) const;
+
+		// adds radiance arriving at point from direction, divided by
+		// density of the direction (thread safe)
+		void Record(const Vec3& point, const Vec3& direction, float value);
+
+		// ends training iteration: splits leaves with more than spatialThreshold
+		// samples, turns collected radiance into sampling distributions and
+		// prepares refined directional trees for the next iteration
+		void Refine(float spatialThreshold, float directionalThreshold, size_t maxDepth);
+
+	private:
+		struct Node
+		{
+			std::array<std::uint32_t, 2> children = { { 0, 0 } };	// 0 for leaf
+			unsigned char axis = 0;
+			AtomicFloat samples;	// recorded during the iteration
+			DTree sampling;
+			DTree building;
+		};
+
+		Box box_;
+		std::vector<Node> nodes_;
+		size_t leafCount_ = 1;
+
+		size_t FindLeaf(const Vec3& point) const;
+	};
+
+}
+
+#endif
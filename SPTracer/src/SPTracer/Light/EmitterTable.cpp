@@ -0,0 +1,159 @@
+#include "../stdafx.h"
+#include "../Log.h"
+#include "../Util.h"
+#include "../Material/MaterialTable.h"
+#include "../Primitive/Box.h"
+#include "../Primitive/Instance.h"
+#include "../Primitive/Primitive.h"
+#include "../Sampler/Sampler.h"
+#include "EmitterTable.h"
+#include "LightSample.h"
+
+namespace SPTracer
+{
+
+	EmitterTable::EmitterTable(const std::vector<std::shared_ptr<Primitive>>& primitives, const std::vector<std::shared_ptr<Instance>>& instances,
+		const MaterialTable& materials)
+		: totalPower_(0.0f)
+	{
+		// collect emissive primitives with their bounds, instances do not
+		// have own material, emissive primitives of their meshes are placed
+		// in world space by every instance
+		std::vector<LightBounds> bounds;
+		std::vector<float> powers;
+		for (const auto& p : primitives)
+		{
+			Add(p.get(), materials, bounds, powers);
+		}
+
+		for (const auto& instance : instances)
+		{
+			for (const auto& p : instance->emitters())
+			{
+				Add(p.get(), materials, bounds, powers);
+			}
+		}
+
+		if (emitters_.empty())
+		{
+			Log::Warning("EmitterTable: Scene has no emissive primitives for light sampling");
+			return;
+		}
+
+		lightTree_ = LightTree(bounds);
+		powerTable_ = AliasTable(powers);
+	}
+
+	bool EmitterTable::empty() const
+	{
+		return emitters_.empty();
+	}
+
+	size_t EmitterTable::size() const
+	{
+		return emitters_.size();
+	}
+
+	float EmitterTable::totalPower() const
+	{
+		return totalPower_;
+	}
+
+	bool EmitterTable::Contains(const Primitive* primitive) const
+	{
+		return indices_.find(primitive) != indices_.end();
+	}
+
+	bool EmitterTable::Sample(const Vec3& point, const Vec3& normal, Sampler& sampler, LightSample& sample) const
+	{
+		// select emitter by its importance for the point
+		size_t emitter;
+		float selectionPdf;
+		if (!lightTree_.Sample(point, normal, sampler.Get1D(), emitter, selectionPdf))
+		{
+			return false;
+		}
+
+		// uniform point on emitter
+		float u, v;
+		sampler.Get2D(u, v);
+		emitters_[emitter]->SamplePoint(u, v, sample.point, sample.normal);
+
+		sample.primitive = emitters_[emitter];
+		sample.pdf = selectionPdf / areas_[emitter];
+		return true;
+	}
+
+	float EmitterTable::GetPdf(const Primitive* primitive, const Vec3& point, const Vec3& normal) const
+	{
+		auto it = indices_.find(primitive);
+		if (it == indices_.end())
+		{
+			return 0.0f;
+		}
+
+		return lightTree_.GetPdf(point, normal, it->second) / areas_[it->second];
+	}
+
+	void EmitterTable::SampleEmission(Sampler& sampler, LightSample& sample) const
+	{
+		size_t emitter = powerTable_.Sample(sampler.Get1D());
+
+		// uniform point on emitter
+		float u, v;
+		sampler.Get2D(u, v);
+		emitters_[emitter]->SamplePoint(u, v, sample.point, sample.normal);
+
+		sample.primitive = emitters_[emitter];
+		sample.pdf = powerTable_.GetPdf(emitter) / areas_[emitter];
+	}
+
+	float EmitterTable::GetEmissionPdf(const Primitive* primitive) const
+	{
+		auto it = indices_.find(primitive);
+		if (it == indices_.end())
+		{
+			return 0.0f;
+		}
+
+		return powerTable_.GetPdf(it->second) / areas_[it->second];
+	}
+
+	void EmitterTable::Add(const Primitive* primitive, const MaterialTable& materials, std::vector<LightBounds>& bounds, std::vector<float>& powers)
+	{
+		if (!primitive->hasMaterial() || !materials.IsEmissive(primitive->materialId()))
+		{
+			return;
+		}
+
+		float area = primitive->GetArea();
+		if (area <= 0.0f)
+		{
+			return;
+		}
+
+		// emitted power: area times integral of radiance
+		// L * cos^n(theta) times cos(theta) over hemisphere
+		const MaterialRecord& m = materials.record(primitive->materialId());
+		float radiance = std::accumulate(m.radiance.begin(), m.radiance.end(), 0.0f) / static_cast<float>(m.radiance.size());
+		float power = area * radiance * 2.0f * Util::Pi / (m.emissionExponent + 2.0f);
+		if (power <= 0.0f)
+		{
+			return;
+		}
+
+		// light is emitted into hemisphere around normal
+		Vec3 axis;
+		float cosThetaO;
+		primitive->GetNormalBounds(axis, cosThetaO);
+		Box box = primitive->GetBox();
+
+		indices_[primitive] = emitters_.size();
+		emitters_.push_back(primitive);
+		areas_.push_back(area);
+		bounds.emplace_back(box.min(), box.max(), axis, cosThetaO, 0.0f, power);
+		powers.push_back(power);
+		totalPower_ += power;
+	}
+
+}
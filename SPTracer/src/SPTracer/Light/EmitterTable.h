@@ -0,0 +1,61 @@
+#ifndef SPT_EMITTER_TABLE_H
+#define SPT_EMITTER_TABLE_H
+
+#include "../stdafx.h"
+#include "../AliasTable.h"
+#include "LightTree.h"
+
+namespace SPTracer
+{
+	struct LightSample;
+	class Instance;
+	class MaterialTable;
+	class Primitive;
+	class Sampler;
+	class Vec3;
+
+	// Emissive primitives of the scene. Emitter is selected through the
+	// light tree, proportionally to its estimated contribution to the
+	// shading point, and the point is distributed uniformly over its area.
+	// Light paths start from emitters selected proportionally to their power.
+	class EmitterTable
+	{
+	public:
+		EmitterTable(const std::vector<std::shared_ptr<Primitive>>& primitives, const std::vector<std::shared_ptr<Instance>>& instances,
+			const MaterialTable& materials);
+
+		bool empty() const;
+		size_t size() const;
+		float totalPower() const;
+
+		// checks if primitive is sampled as light
+		bool Contains(const Primitive* primitive) const;
+
+		// samples point on lights for shading point with normal,
+		// returns false if no light can illuminate the point
+		bool Sample(const Vec3& point, const Vec3& normal, Sampler& sampler, LightSample& sample) const;
+
+		// probability density (area measure) of sampling point on primitive for shading point with normal
+		float GetPdf(const Primitive* primitive, const Vec3& point, const Vec3& normal) const;
+
+		// samples point on lights proportionally to emitted power, independently of shading point
+		void SampleEmission(Sampler& sampler, LightSample& sample) const;
+
+		// probability density (area measure) of sampling point on primitive proportionally to power
+		float GetEmissionPdf(const Primitive* primitive) const;
+
+	private:
+		std::vector<const Primitive*> emitters_;
+		std::vector<float> areas_;
+		std::unordered_map<const Primitive*, size_t> indices_;
+		LightTree lightTree_;
+		AliasTable powerTable_;
+		float totalPower_;
+
+		// adds primitive if it is emissive, with its bounds and power
+		void Add(const Primitive* primitive, const MaterialTable& materials, std::vector<LightBounds>& bounds, std::vector<float>& powers);
+	};
+
+}
+
+#endif
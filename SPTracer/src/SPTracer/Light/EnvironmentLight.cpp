@@ -0,0 +1,273 @@
+#include "../stdafx.h"
+#include "../Exception.h"
+#include "../Log.h"
+#include "../Util.h"
+#include "../Color/RGBColor.h"
+#include "../Color/SpectralPacket.h"
+#include "../Color/Spectrum.h"
+#include "../Sampler/Sampler.h"
+#include "../Tracer/Ray.h"
+#include "EnvironmentLight.h"
+
+namespace SPTracer
+{
+
+	const size_t EnvironmentLight::MaxDistributionWidth = 512;
+
+	std::unique_ptr<EnvironmentLight> EnvironmentLight::Load(const std::string& fileName, float scale, const Spectrum& spectrum)
+	{
+		try
+		{
+			std::ifstream file(fileName, std::ios::binary);
+			if (!file)
+			{
+				throw Exception("Cannot open file: " + fileName);
+			}
+
+			// header: "PF" for color or "Pf" for grayscale, size, and byte order
+			// as the sign of the scale (negative for little-endian)
+			std::string format;
+			size_t width = 0;
+			size_t height = 0;
+			float byteOrder = 0.0f;
+			file >> format >> width >> height >> byteOrder;
+			if (!file || ((format != "PF") && (format != "Pf")) || (width == 0) || (height == 0) || (byteOrder == 0.0f))
+			{
+				throw Exception("Invalid PFM header: " + fileName);
+			}
+
+			// single white space character separates header from data
+			file.get();
+
+			size_t channels = format == "PF" ? 3 : 1;
+			std::vector<float> data(width * height * channels);
+			file.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(float));
+			if (!file)
+			{
+				throw Exception("Unexpected end of file: " + fileName);
+			}
+
+			// swap bytes if file was written on machine with other byte order
+			const unsigned short probe = 1;
+			bool littleEndian = *reinterpret_cast<const unsigned char*>(&probe) == 1;
+			if ((byteOrder < 0.0f) != littleEndian)
+			{
+				for (float& value : data)
+				{
+					unsigned char* bytes = reinterpret_cast<unsigned char*>(&value);
+					std::swap(bytes[0], bytes[3]);
+					std::swap(bytes[1], bytes[2]);
+				}
+			}
+
+			// rows are stored from bottom to top, negative and invalid values are black
+			std::vector<Vec3> texels(width * height);
+			for (size_t y = 0; y < height; y++)
+			{
+				const float* row = &data[(height - 1 - y) * width * channels];
+				for (size_t x = 0; x < width; x++)
+				{
+					Vec3& texel = texels[y * width + x];
+					for (size_t c = 0; c < 3; c++)
+					{
+						texel[c] = std::max(0.0f, row[x * channels + (channels == 3 ? c : 0)]);
+					}
+				}
+			}
+
+			return std::unique_ptr<EnvironmentLight>(new EnvironmentLight(width, height, std::move(texels), scale, spectrum));
+		}
+		catch (Exception e)
+		{
+			std::string msg = "EnvironmentLight: " + std::string(e.what());
+			Log::Error(msg);
+			throw Exception(msg);
+		}
+	}
+
+	EnvironmentLight::EnvironmentLight(size_t width, size_t height, std::vector<Vec3> texels, float scale, const Spectrum& spectrum)
+		: image_{ width, height, std::move(texels) }, distributionWidth_(width), distributionHeight_(height)
+	{
+		// RGB channels are converted to spectrum in the same way as RGB colors of materials
+		RGBColor red(1.0f, 0.0f, 0.0f);
+		RGBColor green(0.0f, 1.0f, 0.0f);
+		RGBColor blue(0.0f, 0.0f, 1.0f);
+		Vec3 importance(0.0f, 0.0f, 0.0f);
+		for (float waveLength : spectrum.values)
+		{
+			Vec3 weights(red.GetAmplitude(waveLength), green.GetAmplitude(waveLength), blue.GetAmplitude(waveLength));
+			channelWeights_.push_back(weights * scale);
+			importance += weights;
+		}
+
+		// directions are sampled proportionally to the mean radiance of the wave lengths, in the image
+		// halved (odd sizes rounded up) until it is narrow enough; texels are weighted by overlapping
+		// area, so that every direction with non-zero radiance has non-zero density
+		while (distributionWidth_ > MaxDistributionWidth)
+		{
+			distributionWidth_ = (distributionWidth_ + 1) / 2;
+			distributionHeight_ = (distributionHeight_ + 1) / 2;
+		}
+
+		Level reduced;
+		if (distributionWidth_ != width)
+		{
+			reduced = Reduce(image_, distributionWidth_, distributionHeight_);
+		}
+
+		const Level& level = distributionWidth_ != width ? reduced : image_;
+		std::vector<float> weights(level.width * level.height);
+		float total = 0.0f;
+		for (size_t y = 0; y < level.height; y++)
+		{
+			// solid angle of texels shrinks towards the poles
+			float sinTheta = std::sin(Util::Pi * (y + 0.5f) / level.height);
+			for (size_t x = 0; x < level.width; x++)
+			{
+				float weight = importance.Dot(level.texels[y * level.width + x]) * sinTheta;
+				weights[y * level.width + x] = weight;
+				total += weight;
+			}
+		}
+
+		if (total <= 0.0f)
+		{
+			Log::Warning("EnvironmentLight: Environment is black and is not sampled");
+			return;
+		}
+
+		distribution_ = AliasTable(weights);
+
+		Log::Info("EnvironmentLight: " + std::to_string(width) + "x" + std::to_string(height) + " image, sampled at " +
+			std::to_string(level.width) + "x" + std::to_string(level.height));
+	}
+
+	EnvironmentLight::Level EnvironmentLight::Reduce(const Level& level, size_t width, size_t height)
+	{
+		// fine texel overlapping coarse texel along one axis, weighted by the relative overlapping length
+		struct Overlap
+		{
+			size_t index;
+			float weight;
+		};
+
+		auto getOverlaps = [](size_t fineCount, size_t coarseCount)
+		{
+			std::vector<std::vector<Overlap>> overlaps(coarseCount);
+			double ratio = static_cast<double>(fineCount) / static_cast<double>(coarseCount);
+			for (size_t i = 0; i < coarseCount; i++)
+			{
+				double start = static_cast<double>(i) * ratio;
+				double end = static_cast<double>(i + 1) * ratio;
+				for (size_t j = static_cast<size_t>(start); (j < fineCount) && (static_cast<double>(j) < end); j++)
+				{
+					double length = std::min(end, static_cast<double>(j + 1)) - std::max(start, static_cast<double>(j));
+					overlaps[i].push_back({ j, static_cast<float>(length / ratio) });
+				}
+			}
+
+			return overlaps;
+		};
+
+		std::vector<std::vector<Overlap>> columns = getOverlaps(level.width, width);
+		std::vector<std::vector<Overlap>> rows = getOverlaps(level.height, height);
+
+		Level reduced = { width, height, std::vector<Vec3>(width * height, Vec3(0.0f, 0.0f, 0.0f)) };
+		for (size_t y = 0; y < height; y++)
+		{
+			for (const Overlap& row : rows[y])
+			{
+				const Vec3* fine = &level.texels[row.index * level.width];
+				for (size_t x = 0; x < width; x++)
+				{
+					Vec3& texel = reduced.texels[y * width + x];
+					for (const Overlap& column : columns[x])
+					{
+						texel += fine[column.index] * (row.weight * column.weight);
+					}
+				}
+			}
+		}
+
+		return reduced;
+	}
+
+	bool EnvironmentLight::empty() const
+	{
+		return distribution_.size() == 0;
+	}
+
+	void EnvironmentLight::GetCoordinates(const Vec3& direction, float& u, float& v)
+	{
+		float phi = std::atan2(direction[0], -direction[2]);
+		u = 0.5f + phi / (2.0f * Util::Pi);
+		v = std::acos(std::max(-1.0f, std::min(direction[1], 1.0f))) / Util::Pi;
+	}
+
+	size_t EnvironmentLight::GetTexel(size_t width, size_t height, float u, float v)
+	{
+		size_t x = std::min(static_cast<size_t>(u * width), width - 1);
+		size_t y = std::min(static_cast<size_t>(v * height), height - 1);
+		return y * width + x;
+	}
+
+	void EnvironmentLight::GetRadiance(const Ray& ray, SpectralPacket& radiance) const
+	{
+		float u, v;
+		GetCoordinates(ray.direction, u, v);
+
+		const Vec3& texel = image_.texels[GetTexel(image_.width, image_.height, u, v)];
+		ray.ForEachWave(channelWeights_.size(), [&](size_t t) { radiance[t] = texel.Dot(channelWeights_[t]); });
+	}
+
+	bool EnvironmentLight::Sample(Sampler& sampler, Vec3& direction, float& pdf) const
+	{
+		if (empty())
+		{
+			return false;
+		}
+
+		// texel is chosen from the table, point is uniform inside the texel
+		size_t index = distribution_.Sample(sampler.Get1D());
+
+		float du, dv;
+		sampler.Get2D(du, dv);
+		float u = (static_cast<float>(index % distributionWidth_) + du) / distributionWidth_;
+		float v = (static_cast<float>(index / distributionWidth_) + dv) / distributionHeight_;
+
+		float theta = v * Util::Pi;
+		float phi = (u - 0.5f) * 2.0f * Util::Pi;
+		float sinTheta = std::sin(theta);
+		if (sinTheta <= 0.0f)
+		{
+			return false;
+		}
+
+		direction = Vec3(sinTheta * std::sin(phi), std::cos(theta), -sinTheta * std::cos(phi));
+
+		// image area density converted to solid angle, d(omega) = 2 pi^2 sin(theta) du dv
+		pdf = distribution_.GetPdf(index) * static_cast<float>(distributionWidth_ * distributionHeight_) / (2.0f * Util::Pi * Util::Pi * sinTheta);
+		return true;
+	}
+
+	float EnvironmentLight::GetPdf(const Vec3& direction) const
+	{
+		if (empty())
+		{
+			return 0.0f;
+		}
+
+		float sinTheta = std::sqrt(std::max(0.0f, 1.0f - direction[1] * direction[1]));
+		if (sinTheta <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		float u, v;
+		GetCoordinates(direction, u, v);
+
+		return distribution_.GetPdf(GetTexel(distributionWidth_, distributionHeight_, u, v)) *
+			static_cast<float>(distributionWidth_ * distributionHeight_) / (2.0f * Util::Pi * Util::Pi * sinTheta);
+	}
+
+}
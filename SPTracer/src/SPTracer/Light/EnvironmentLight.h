@@ -0,0 +1,70 @@
+#ifndef SPT_ENVIRONMENT_LIGHT_H
+#define SPT_ENVIRONMENT_LIGHT_H
+
+#include "../stdafx.h"
+#include "../AliasTable.h"
+#include "../Vec3.h"
+
+namespace SPTracer
+{
+	struct Ray;
+	struct Spectrum;
+	class Sampler;
+	class SpectralPacket;
+
+	// Light arriving from infinity, stored in latitude-longitude RGB image
+	// (y axis points to the top row). Directions are sampled with an alias
+	// table built over the image halved until it is not wider than
+	// MaxDistributionWidth, each texel weighted by its solid angle. Radiance
+	// is looked up in the full resolution image.
+	class EnvironmentLight
+	{
+	public:
+		// loads portable float map (PFM), radiance is multiplied by scale
+		static std::unique_ptr<EnvironmentLight> Load(const std::string& fileName, float scale, const Spectrum& spectrum);
+
+		// black environment has no directions to sample
+		bool empty() const;
+
+		// radiance arriving along the ray, which left the scene
+		void GetRadiance(const Ray& ray, SpectralPacket& radiance) const;
+
+		// samples direction towards the environment with its solid angle density,
+		// returns false if the environment is black
+		bool Sample(Sampler& sampler, Vec3& direction, float& pdf) const;
+
+		// solid angle density of sampling direction
+		float GetPdf(const Vec3& direction) const;
+
+	private:
+		// largest width of the reduced image the alias table is built over, wider images are halved until they fit
+		static const size_t MaxDistributionWidth;
+
+		struct Level
+		{
+			size_t width;
+			size_t height;
+			std::vector<Vec3> texels;	// RGB, rows from top to bottom
+		};
+
+		EnvironmentLight(size_t width, size_t height, std::vector<Vec3> texels, float scale, const Spectrum& spectrum);
+
+		// image coordinates in [0, 1) of direction
+		static void GetCoordinates(const Vec3& direction, float& u, float& v);
+
+		// image of the given size, every texel is the mean of the texels of level it overlaps, weighted by overlapping area
+		static Level Reduce(const Level& level, size_t width, size_t height);
+
+		// texel of image of the given size containing image coordinates
+		static size_t GetTexel(size_t width, size_t height, float u, float v);
+
+		Level image_;
+		std::vector<Vec3> channelWeights_;	// contribution of RGB channels to every wave length, scaled
+		size_t distributionWidth_;
+		size_t distributionHeight_;
+		AliasTable distribution_;
+	};
+
+}
+
+#endif
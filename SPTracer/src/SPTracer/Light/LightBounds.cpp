@@ -0,0 +1,208 @@
+#include "../stdafx.h"
+#include "../Util.h"
+#include "LightBounds.h"
+
+namespace SPTracer
+{
+
+	LightBounds::LightBounds()
+		: axis_(0.0f, 0.0f, 1.0f), cosThetaO_(1.0f), cosThetaE_(1.0f), power_(0.0f)
+	{
+	}
+
+	LightBounds::LightBounds(const Vec3& min, const Vec3& max, const Vec3& axis, float cosThetaO, float cosThetaE, float power)
+		: min_(min), max_(max), axis_(axis), cosThetaO_(cosThetaO), cosThetaE_(cosThetaE), power_(power)
+	{
+	}
+
+	const Vec3& LightBounds::min() const
+	{
+		return min_;
+	}
+
+	const Vec3& LightBounds::max() const
+	{
+		return max_;
+	}
+
+	Vec3 LightBounds::centroid() const
+	{
+		return 0.5f * (min_ + max_);
+	}
+
+	float LightBounds::power() const
+	{
+		return power_;
+	}
+
+	LightBounds LightBounds::Union(const LightBounds& a, const LightBounds& b)
+	{
+		// bounds without power do not emit light
+		if (a.power_ == 0.0f)
+		{
+			return b;
+		}
+		if (b.power_ == 0.0f)
+		{
+			return a;
+		}
+
+		Vec3 min(std::min(a.min_[0], b.min_[0]), std::min(a.min_[1], b.min_[1]), std::min(a.min_[2], b.min_[2]));
+		Vec3 max(std::max(a.max_[0], b.max_[0]), std::max(a.max_[1], b.max_[1]), std::max(a.max_[2], b.max_[2]));
+
+		// cone containing both cones
+		Vec3 axis = a.axis_;
+		float cosThetaO = -1.0f;
+
+		float thetaA = SafeAcos(a.cosThetaO_);
+		float thetaB = SafeAcos(b.cosThetaO_);
+		float thetaD = SafeAcos(a.axis_.Dot(b.axis_));
+
+		if (std::min(thetaD + thetaB, Util::Pi) <= thetaA)
+		{
+			// b is inside a
+			cosThetaO = a.cosThetaO_;
+		}
+		else if (std::min(thetaD + thetaA, Util::Pi) <= thetaB)
+		{
+			// a is inside b
+			axis = b.axis_;
+			cosThetaO = b.cosThetaO_;
+		}
+		else
+		{
+			float thetaO = 0.5f * (thetaA + thetaD + thetaB);
+			Vec3 rotationAxis = a.axis_.Cross(b.axis_);
+			float length = rotationAxis.Length();
+
+			if ((thetaO < Util::Pi) && (length > 0.0f))
+			{
+				// rotate axis of a towards axis of b
+				float thetaR = thetaO - thetaA;
+				Vec3 k = rotationAxis / length;
+				axis = (a.axis_ * std::cos(thetaR) + k.Cross(a.axis_) * std::sin(thetaR)).Normalize();
+				cosThetaO = std::cos(thetaO);
+			}
+		}
+
+		return LightBounds(min, max, axis, cosThetaO, std::min(a.cosThetaE_, b.cosThetaE_), a.power_ + b.power_);
+	}
+
+	float LightBounds::GetImportance(const Vec3& point, const Vec3& normal) const
+	{
+		if (power_ == 0.0f)
+		{
+			return 0.0f;
+		}
+
+		// distance to center, clamped for points inside the bounds
+		Vec3 toPoint = point - centroid();
+		float distanceSquared = std::max(toPoint.Dot(toPoint), 0.5f * (max_ - min_).Length());
+
+		Vec3 wi;
+		float cosThetaB;
+		GetSubtendedCone(point, wi, cosThetaB);
+		float sinThetaB = std::sqrt(std::max(0.0f, 1.0f - cosThetaB * cosThetaB));
+
+		float cosThetaP = GetCosThetaP(wi, cosThetaB);
+		if (cosThetaP <= cosThetaE_)
+		{
+			return 0.0f;
+		}
+
+		float importance = power_ * cosThetaP / distanceSquared;
+
+		// smallest angle between normal and direction to emitters,
+		// surfaces are lit from the side of the normal only
+		float cosThetaI = -wi.Dot(normal);
+		float sinThetaI = std::sqrt(std::max(0.0f, 1.0f - cosThetaI * cosThetaI));
+		float cosThetaIP = CosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+
+		return importance * std::max(cosThetaIP, 0.0f);
+	}
+
+	float LightBounds::GetMaxCosine(const Vec3& point) const
+	{
+		if (power_ == 0.0f)
+		{
+			return 0.0f;
+		}
+
+		Vec3 wi;
+		float cosThetaB;
+		GetSubtendedCone(point, wi, cosThetaB);
+
+		float cosThetaP = GetCosThetaP(wi, cosThetaB);
+		return cosThetaP > cosThetaE_ ? std::max(cosThetaP, 0.0f) : 0.0f;
+	}
+
+	void LightBounds::GetSubtendedCone(const Vec3& point, Vec3& wi, float& cosThetaB) const
+	{
+		// direction from center to point
+		Vec3 toPoint = point - centroid();
+		float distance = std::sqrt(toPoint.Dot(toPoint));
+		wi = distance > 0.0f ? toPoint / distance : axis_;
+
+		// directions subtended by bounding sphere of the box
+		float radius = 0.5f * (max_ - min_).Length();
+		cosThetaB = -1.0f;
+		if (distance > radius)
+		{
+			float sinSquared = radius * radius / (distance * distance);
+			cosThetaB = std::sqrt(std::max(0.0f, 1.0f - sinSquared));
+		}
+	}
+
+	float LightBounds::GetCosThetaP(const Vec3& wi, float cosThetaB) const
+	{
+		float cosThetaW = axis_.Dot(wi);
+		float sinThetaW = std::sqrt(std::max(0.0f, 1.0f - cosThetaW * cosThetaW));
+		float sinThetaB = std::sqrt(std::max(0.0f, 1.0f - cosThetaB * cosThetaB));
+
+		// smallest angle between emission cone and point
+		float sinThetaO = std::sqrt(std::max(0.0f, 1.0f - cosThetaO_ * cosThetaO_));
+		float cosThetaX = CosSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO_);
+		float sinThetaX = SinSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO_);
+		return CosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+	}
+
+	float LightBounds::GetCost() const
+	{
+		// orientation measure, integral of cosine over directions around the cone
+		float thetaO = SafeAcos(cosThetaO_);
+		float thetaE = SafeAcos(cosThetaE_);
+		float thetaW = std::min(thetaO + thetaE, Util::Pi);
+		float sinThetaO = std::sqrt(std::max(0.0f, 1.0f - cosThetaO_ * cosThetaO_));
+		float orientation = 2.0f * Util::Pi * (1.0f - cosThetaO_) +
+			0.5f * Util::Pi * (2.0f * thetaW * sinThetaO - std::cos(thetaO - 2.0f * thetaW) - 2.0f * thetaO * sinThetaO + cosThetaO_);
+
+		Vec3 d = max_ - min_;
+		float area = 2.0f * (d[0] * d[1] + d[0] * d[2] + d[1] * d[2]);
+
+		return power_ * orientation * area;
+	}
+
+	float LightBounds::SafeAcos(float x)
+	{
+		return std::acos(std::max(-1.0f, std::min(x, 1.0f)));
+	}
+
+	float LightBounds::CosSubClamped(float sinA, float cosA, float sinB, float cosB)
+	{
+		if (cosA > cosB)
+		{
+			return 1.0f;
+		}
+		return cosA * cosB + sinA * sinB;
+	}
+
+	float LightBounds::SinSubClamped(float sinA, float cosA, float sinB, float cosB)
+	{
+		if (cosA > cosB)
+		{
+			return 0.0f;
+		}
+		return sinA * cosB - cosA * sinB;
+	}
+
+}
@@ -0,0 +1,64 @@
+#ifndef SPT_LIGHT_BOUNDS_H
+#define SPT_LIGHT_BOUNDS_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+
+namespace SPTracer
+{
+
+	// Bounds of a group of emitters: box over positions,
+	// cone over emission directions and total emitted power.
+	// Emission cone is the normal cone (half angle thetaO)
+	// widened by the spread of emission around normal (thetaE).
+	class LightBounds
+	{
+	public:
+		LightBounds();
+		LightBounds(const Vec3& min, const Vec3& max, const Vec3& axis, float cosThetaO, float cosThetaE, float power);
+
+		const Vec3& min() const;
+		const Vec3& max() const;
+		Vec3 centroid() const;
+		float power() const;
+
+		// bounds of both groups
+		static LightBounds Union(const LightBounds& a, const LightBounds& b);
+
+		// conservative estimate of light received at point with normal,
+		// zero only if no emitter in the group can illuminate the point
+		float GetImportance(const Vec3& point, const Vec3& normal) const;
+
+		// largest cosine between emission directions of the group and directions towards point,
+		// zero only if no emitter in the group can illuminate the point
+		float GetMaxCosine(const Vec3& point) const;
+
+		// surface area heuristic with orientation (used for building hierarchy)
+		float GetCost() const;
+
+	private:
+		Vec3 min_;
+		Vec3 max_;
+		Vec3 axis_;
+		float cosThetaO_;
+		float cosThetaE_;
+		float power_;
+
+		// direction wi from the center to point, and cosine of half angle of the cone
+		// of directions from point to the bounding sphere of the box
+		void GetSubtendedCone(const Vec3& point, Vec3& wi, float& cosThetaB) const;
+
+		// cosine of the smallest angle between emission cone and cone of directions to the box
+		float GetCosThetaP(const Vec3& wi, float cosThetaB) const;
+
+		// acos of value clamped to [-1, 1]
+		static float SafeAcos(float x);
+
+		// cos(max(a - b, 0)) and sin(max(a - b, 0)) for angles given by sine and cosine
+		static float CosSubClamped(float sinA, float cosA, float sinB, float cosB);
+		static float SinSubClamped(float sinA, float cosA, float sinB, float cosB);
+	};
+
+}
+
+#endif
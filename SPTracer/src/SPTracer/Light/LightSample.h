@@ -0,0 +1,21 @@
+#ifndef SPT_LIGHT_SAMPLE_H
+#define SPT_LIGHT_SAMPLE_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+
+namespace SPTracer
+{
+	class Primitive;
+
+	struct LightSample
+	{
+		Vec3 point;					// sampled point on light
+		Vec3 normal;				// light normal at the point
+		const Primitive* primitive;	// sampled emitter
+		float pdf;					// probability density with respect to area
+	};
+
+}
+
+#endif
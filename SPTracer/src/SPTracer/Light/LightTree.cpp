@@ -0,0 +1,260 @@
+#include "../stdafx.h"
+#include "../Util.h"
+#include "../Vec3.h"
+#include "LightTree.h"
+
+namespace SPTracer
+{
+
+	const size_t LightTree::BucketCount;
+
+	LightTree::LightTree()
+	{
+	}
+
+	LightTree::LightTree(const std::vector<LightBounds>& emitters)
+		: emitterNodes_(emitters.size())
+	{
+		if (emitters.empty())
+		{
+			return;
+		}
+
+		std::vector<size_t> indices(emitters.size());
+		std::iota(indices.begin(), indices.end(), 0);
+
+		nodes_.reserve(2 * emitters.size() - 1);
+		Build(emitters, indices, 0, indices.size(), 0);
+	}
+
+	bool LightTree::empty() const
+	{
+		return nodes_.empty();
+	}
+
+	bool LightTree::Sample(const Vec3& point, const Vec3& normal, float u, size_t& emitter, float& pdf) const
+	{
+		if (nodes_.empty() || (nodes_[0].bounds.GetImportance(point, normal) <= 0.0f))
+		{
+			return false;
+		}
+
+		pdf = 1.0f;
+		size_t node = 0;
+		while (!nodes_[node].leaf)
+		{
+			size_t left = node + 1;
+			size_t right = nodes_[node].index;
+
+			float leftImportance = nodes_[left].bounds.GetImportance(point, normal);
+			float rightImportance = nodes_[right].bounds.GetImportance(point, normal);
+			float importance = leftImportance + rightImportance;
+			if (importance <= 0.0f)
+			{
+				return false;
+			}
+
+			// choose child and reuse the value for the next level
+			float leftProbability = leftImportance / importance;
+			if (u < leftProbability)
+			{
+				node = left;
+				pdf *= leftProbability;
+				u = std::min(u / leftProbability, std::nextafter(1.0f, 0.0f));
+			}
+			else
+			{
+				node = right;
+				pdf *= rightImportance / importance;
+				u = std::min((u - leftProbability) / (1.0f - leftProbability), std::nextafter(1.0f, 0.0f));
+			}
+		}
+
+		emitter = nodes_[node].index;
+		return true;
+	}
+
+	float LightTree::GetPdf(const Vec3& point, const Vec3& normal, size_t emitter) const
+	{
+		if (nodes_.empty() || (nodes_[0].bounds.GetImportance(point, normal) <= 0.0f))
+		{
+			return 0.0f;
+		}
+
+		// go from the leaf up to the root,
+		// multiplying probabilities of choosing nodes on the way
+		float pdf = 1.0f;
+		size_t node = emitterNodes_[emitter];
+		while (node != 0)
+		{
+			size_t parent = nodes_[node].parent;
+			size_t left = parent + 1;
+			size_t right = nodes_[parent].index;
+
+			float leftImportance = nodes_[left].bounds.GetImportance(point, normal);
+			float rightImportance = nodes_[right].bounds.GetImportance(point, normal);
+			float importance = leftImportance + rightImportance;
+			if (importance <= 0.0f)
+			{
+				return 0.0f;
+			}
+
+			pdf *= (node == left ? leftImportance : rightImportance) / importance;
+			node = parent;
+		}
+
+		return pdf;
+	}
+
+	const LightBounds& LightTree::bounds(size_t node) const
+	{
+		return nodes_[node].bounds;
+	}
+
+	size_t LightTree::representative(size_t node) const
+	{
+		return nodes_[node].representative;
+	}
+
+	bool LightTree::GetChildren(size_t node, size_t& left, size_t& right) const
+	{
+		if (nodes_[node].leaf)
+		{
+			return false;
+		}
+
+		left = node + 1;
+		right = nodes_[node].index;
+		return true;
+	}
+
+	std::uint32_t LightTree::Build(const std::vector<LightBounds>& emitters, std::vector<size_t>& indices, size_t begin, size_t end, std::uint32_t parent)
+	{
+		std::uint32_t node = static_cast<std::uint32_t>(nodes_.size());
+		nodes_.emplace_back();
+
+		LightBounds bounds = emitters[indices[begin]];
+		for (size_t i = begin + 1; i < end; i++)
+		{
+			bounds = LightBounds::Union(bounds, emitters[indices[i]]);
+		}
+
+		nodes_[node].bounds = bounds;
+		nodes_[node].parent = parent;
+
+		if (end - begin == 1)
+		{
+			// leaf with single emitter
+			nodes_[node].index = static_cast<std::uint32_t>(indices[begin]);
+			nodes_[node].representative = nodes_[node].index;
+			nodes_[node].leaf = true;
+			emitterNodes_[indices[begin]] = node;
+			return node;
+		}
+
+		// first child follows the node
+		size_t middle = Split(emitters, indices, begin, end, bounds);
+		Build(emitters, indices, begin, middle, node);
+		std::uint32_t right = Build(emitters, indices, middle, end, node);
+
+		// representative of one of the children, with probability of its power
+		const Node& leftNode = nodes_[node + 1];
+		const Node& rightNode = nodes_[right];
+		float leftPower = leftNode.bounds.power();
+		float power = leftPower + rightNode.bounds.power();
+		bool useLeft = (power <= 0.0f) || (Util::RandFloat(0.0f, power) < leftPower);
+
+		nodes_[node].index = right;
+		nodes_[node].representative = useLeft ? leftNode.representative : rightNode.representative;
+		nodes_[node].leaf = false;
+		return node;
+	}
+
+	size_t LightTree::Split(const std::vector<LightBounds>& emitters, std::vector<size_t>& indices, size_t begin, size_t end, const LightBounds& bounds)
+	{
+		// bounds of centroids
+		Vec3 centroidMin = emitters[indices[begin]].centroid();
+		Vec3 centroidMax = centroidMin;
+		for (size_t i = begin + 1; i < end; i++)
+		{
+			Vec3 c = emitters[indices[i]].centroid();
+			for (size_t d = 0; d < 3; d++)
+			{
+				centroidMin[d] = std::min(centroidMin[d], c[d]);
+				centroidMax[d] = std::max(centroidMax[d], c[d]);
+			}
+		}
+
+		Vec3 extent = bounds.max() - bounds.min();
+		float maxExtent = std::max(std::max(extent[0], extent[1]), extent[2]);
+
+		float bestCost = std::numeric_limits<float>::infinity();
+		size_t bestDimension = 0;
+		size_t bestBucket = 0;
+
+		auto getBucket = [&](size_t index, size_t dimension)
+		{
+			float c = emitters[index].centroid()[dimension];
+			float t = (c - centroidMin[dimension]) / (centroidMax[dimension] - centroidMin[dimension]);
+			return std::min(static_cast<size_t>(t * BucketCount), BucketCount - 1);
+		};
+
+		for (size_t d = 0; d < 3; d++)
+		{
+			if (centroidMax[d] <= centroidMin[d])
+			{
+				continue;
+			}
+
+			// bounds of emitters in buckets
+			std::array<LightBounds, BucketCount> buckets;
+			for (size_t i = begin; i < end; i++)
+			{
+				size_t b = getBucket(indices[i], d);
+				buckets[b] = LightBounds::Union(buckets[b], emitters[indices[i]]);
+			}
+
+			// cost of splitting after each bucket, long thin boxes are penalized
+			float regularization = extent[d] > 0.0f ? maxExtent / extent[d] : 1.0f;
+			for (size_t split = 0; split + 1 < BucketCount; split++)
+			{
+				LightBounds left;
+				LightBounds right;
+				for (size_t b = 0; b <= split; b++)
+				{
+					left = LightBounds::Union(left, buckets[b]);
+				}
+				for (size_t b = split + 1; b < BucketCount; b++)
+				{
+					right = LightBounds::Union(right, buckets[b]);
+				}
+
+				float cost = regularization * (left.GetCost() + right.GetCost());
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestDimension = d;
+					bestBucket = split;
+				}
+			}
+		}
+
+		size_t middle = begin;
+		if (bestCost < std::numeric_limits<float>::infinity())
+		{
+			auto it = std::partition(indices.begin() + begin, indices.begin() + end, [&](size_t index) {
+				return getBucket(index, bestDimension) <= bestBucket;
+			});
+			middle = static_cast<size_t>(it - indices.begin());
+		}
+
+		// centroids can not be separated, split in the middle
+		if ((middle == begin) || (middle == end))
+		{
+			middle = (begin + end) / 2;
+		}
+
+		return middle;
+	}
+
+}
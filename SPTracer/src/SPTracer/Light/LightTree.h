@@ -0,0 +1,63 @@
+#ifndef SPT_LIGHT_TREE_H
+#define SPT_LIGHT_TREE_H
+
+#include "../stdafx.h"
+#include "LightBounds.h"
+
+namespace SPTracer
+{
+	class Vec3;
+
+	// Bounding volume hierarchy over emitters. Emitter is selected by
+	// descending from the root and choosing child nodes proportionally to
+	// their importance for the shading point, so that the cost of
+	// selection is logarithmic in the number of emitters.
+	class LightTree
+	{
+	public:
+		LightTree();
+		explicit LightTree(const std::vector<LightBounds>& emitters);
+
+		bool empty() const;
+
+		// selects emitter for shading point with uniform value in [0, 1),
+		// returns false if no emitter can illuminate the point
+		bool Sample(const Vec3& point, const Vec3& normal, float u, size_t& emitter, float& pdf) const;
+
+		// probability of selecting emitter for shading point
+		float GetPdf(const Vec3& point, const Vec3& normal, size_t emitter) const;
+
+		// nodes for cuts through the tree, the root is node 0
+		const LightBounds& bounds(size_t node) const;
+
+		// emitter representing all emitters of node, chosen proportionally to power
+		size_t representative(size_t node) const;
+
+		// children of interior node, returns false for leaf
+		bool GetChildren(size_t node, size_t& left, size_t& right) const;
+
+	private:
+		struct Node
+		{
+			LightBounds bounds;
+			std::uint32_t index;	// second child for interior node (first child follows the node), emitter for leaf
+			std::uint32_t parent;
+			std::uint32_t representative;
+			bool leaf;
+		};
+
+		static const size_t BucketCount = 12;
+
+		std::vector<Node> nodes_;
+		std::vector<std::uint32_t> emitterNodes_;	// leaf node of emitter
+
+		// recurent tree building procedure, returns node index
+		std::uint32_t Build(const std::vector<LightBounds>& emitters, std::vector<size_t>& indices, size_t begin, size_t end, std::uint32_t parent);
+
+		// splits emitters with the surface area orientation heuristic, returns split position
+		static size_t Split(const std::vector<LightBounds>& emitters, std::vector<size_t>& indices, size_t begin, size_t end, const LightBounds& bounds);
+	};
+
+}
+
+#endif
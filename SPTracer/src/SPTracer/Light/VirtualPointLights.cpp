@@ -0,0 +1,69 @@
+#include "../stdafx.h"
+#include "VirtualPointLights.h"
+
+namespace SPTracer
+{
+
+	VirtualPointLights::VirtualPointLights(size_t spectrumCount, unsigned long pathsPerPass, float clampDistance)
+		: spectrumCount_(spectrumCount), pathsPerPass_(pathsPerPass), clampDistance_(clampDistance)
+	{
+	}
+
+	unsigned long VirtualPointLights::pathsPerPass() const
+	{
+		return pathsPerPass_;
+	}
+
+	float VirtualPointLights::clampDistance() const
+	{
+		return clampDistance_;
+	}
+
+	size_t VirtualPointLights::size() const
+	{
+		return lights_.size();
+	}
+
+	const VirtualPointLights::Light& VirtualPointLights::light(size_t index) const
+	{
+		return lights_[index];
+	}
+
+	const float* VirtualPointLights::intensity(size_t index) const
+	{
+		return &intensities_[index * spectrumCount_];
+	}
+
+	const LightTree& VirtualPointLights::tree() const
+	{
+		return tree_;
+	}
+
+	void VirtualPointLights::Add(const std::vector<Light>& lights, const std::vector<float>& intensities)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		lights_.insert(lights_.end(), lights.begin(), lights.end());
+		intensities_.insert(intensities_.end(), intensities.begin(), intensities.end());
+	}
+
+	void VirtualPointLights::BuildTree()
+	{
+		// point lights emit into hemisphere around normal
+		std::vector<LightBounds> bounds;
+		bounds.reserve(lights_.size());
+		for (const Light& l : lights_)
+		{
+			bounds.emplace_back(l.point, l.point, l.normal, 1.0f, 0.0f, l.power);
+		}
+
+		tree_ = LightTree(bounds);
+	}
+
+	void VirtualPointLights::Clear()
+	{
+		lights_.clear();
+		intensities_.clear();
+		tree_ = LightTree();
+	}
+
+}
@@ -0,0 +1,64 @@
+#ifndef SPT_VIRTUAL_POINT_LIGHTS_H
+#define SPT_VIRTUAL_POINT_LIGHTS_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "LightTree.h"
+
+namespace SPTracer
+{
+	class Primitive;
+
+	// State of instant radiosity. Every pass has two phases: light subpaths
+	// leave virtual point lights at emitters and at diffuse vertices, then
+	// the light tree is built over them and every pixel is shaded by a cut
+	// through the tree.
+	class VirtualPointLights
+	{
+	public:
+		struct Light
+		{
+			Vec3 point;
+			Vec3 normal;
+			const Primitive* emitter;	// emitter for light on emitter, nullptr for diffuse vertex
+			float power;				// mean intensity of the wave lengths, used for clustering
+		};
+
+		VirtualPointLights(size_t spectrumCount, unsigned long pathsPerPass, float clampDistance);
+
+		unsigned long pathsPerPass() const;
+
+		// geometric term of lights is clamped to this distance
+		float clampDistance() const;
+
+		size_t size() const;
+		const Light& light(size_t index) const;
+
+		// spectral intensity of light, emitted radiance of emitter is not included
+		const float* intensity(size_t index) const;
+
+		// hierarchy over the lights, valid after it is built
+		const LightTree& tree() const;
+
+		// adds lights with intensities of all wave lengths (thread safe)
+		void Add(const std::vector<Light>& lights, const std::vector<float>& intensities);
+
+		// builds tree over the lights, after all are added
+		void BuildTree();
+
+		// removes lights of the pass
+		void Clear();
+
+	private:
+		const size_t spectrumCount_;
+		const unsigned long pathsPerPass_;
+		const float clampDistance_;
+		std::vector<Light> lights_;
+		std::vector<float> intensities_;
+		LightTree tree_;
+		std::mutex mutex_;
+	};
+
+}
+
+#endif
@@ -6,10 +6,11 @@
 namespace SPTracer
 {
 
-	struct Intersection;
+	struct MaterialRecord;
 	struct Spectrum;
-	struct Ray;
 
+	// Material description created by scene loaders. Rendering
+	// uses flattened materials of the material table.
 	class Material
 	{
 	public:
@@ -17,13 +18,9 @@ namespace SPTracer
 
 		virtual bool IsEmissive() const = 0;
 		virtual bool IsReflective() const = 0;
-		virtual void GetNewRayDiffuse(const Ray& ray, const Intersection& intersection, Ray& newRay, std::vector<float>& reflectance) const;
-		virtual bool GetNewRaySpecular(const Ray& ray, const Intersection& intersection, Ray& newRay, std::vector<float>& reflectance) const = 0;
-		virtual void GetDiffuseReflectance(const Ray& ray, const Intersection& intersection, const Ray& newRay, std::vector<float>& reflectance) const = 0;
-		virtual void GetSpecularReflectance(const Ray& ray, const Intersection& intersection, const Ray& newRay, std::vector<float>& reflectance) const = 0;
-		virtual void GetRadiance(const Ray& ray, const Intersection& intersection, std::vector<float>& radiance) const = 0;
 		virtual float GetDiffuseReflectionProbability(int waveIndex) const = 0;			// use index -1 for average reflectivity
 		virtual float GetSpecularReflectionProbability(int waveIndex) const = 0;		// use index -1 for average reflectivity
+		virtual void Flatten(MaterialRecord& record) const = 0;							// parameters for material table
 
 	protected:
 		Material() { };
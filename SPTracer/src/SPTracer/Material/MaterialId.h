@@ -0,0 +1,16 @@
+#ifndef SPT_MATERIAL_ID_H
+#define SPT_MATERIAL_ID_H
+
+#include "../stdafx.h"
+
+namespace SPTracer
+{
+
+	// index of material in the material table
+	using MaterialId = std::uint16_t;
+
+	const MaterialId InvalidMaterialId = std::numeric_limits<MaterialId>::max();
+
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SPT_MATERIAL_RECORD_H
+#define SPT_MATERIAL_RECORD_H
+
+#include "../stdafx.h"
+#include "../Color/SpectralPacket.h"
+#include "MaterialType.h"
+
+namespace SPTracer
+{
+
+	// Flattened parameters of a material. Reflection is described by the
+	// type tag, emission is independent of it, so that luminaires
+	// do not need to refer to another material.
+	struct MaterialRecord
+	{
+		MaterialType type;
+		bool emissive;
+		float diffuseReflectionProbability;		// for full spectrum ray
+		float specularReflectionProbability;	// for full spectrum ray
+		float phongExponent;					// specular lobe
+		float emissionExponent;					// emission distribution, 1 for cosine
+		SpectralPacket diffuseReflectance;
+		SpectralPacket specularReflectance;
+		SpectralPacket radiance;
+	};
+
+}
+
+#endif
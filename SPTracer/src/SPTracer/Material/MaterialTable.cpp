@@ -0,0 +1,297 @@
+#include "../stdafx.h"
+#include "../Exception.h"
+#include "../Frame.h"
+#include "../Log.h"
+#include "../Util.h"
+#include "../Vec3.h"
+#include "../Sampler/Sampler.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/Ray.h"
+#include "Material.h"
+#include "MaterialTable.h"
+
+namespace SPTracer
+{
+
+	MaterialId MaterialTable::Add(const Material& material)
+	{
+		// material can be shared by many primitives
+		auto it = ids_.find(&material);
+		if (it != ids_.end())
+		{
+			return it->second;
+		}
+
+		if (records_.size() >= InvalidMaterialId)
+		{
+			std::string s = "MaterialTable: Too many materials";
+			Log::Error(s);
+			throw Exception(s);
+		}
+
+		MaterialRecord record;
+		material.Flatten(record);
+		records_.push_back(std::move(record));
+
+		MaterialId id = static_cast<MaterialId>(records_.size() - 1);
+		ids_[&material] = id;
+
+		return id;
+	}
+
+	size_t MaterialTable::size() const
+	{
+		return records_.size();
+	}
+
+	const MaterialRecord& MaterialTable::record(MaterialId id) const
+	{
+		return records_[id];
+	}
+
+	bool MaterialTable::IsEmissive(MaterialId id) const
+	{
+		return records_[id].emissive;
+	}
+
+	bool MaterialTable::IsReflective(MaterialId id) const
+	{
+		return records_[id].type != MaterialType::Absorbing;
+	}
+
+	float MaterialTable::GetDiffuseReflectionProbability(MaterialId id, int waveIndex) const
+	{
+		const MaterialRecord& m = records_[id];
+		return waveIndex == -1 ? m.diffuseReflectionProbability : m.diffuseReflectance[waveIndex];
+	}
+
+	float MaterialTable::GetSpecularReflectionProbability(MaterialId id, int waveIndex) const
+	{
+		const MaterialRecord& m = records_[id];
+		return waveIndex == -1 ? m.specularReflectionProbability : m.specularReflectance[waveIndex];
+	}
+
+	bool MaterialTable::Sample(MaterialId id, const Ray& ray, const Intersection& intersection, Sampler& sampler, Ray& newRay) const
+	{
+		const MaterialRecord& m = records_[id];
+
+		float diffuseReflectionProbability = GetDiffuseReflectionProbability(id, ray.waveIndex);
+		float specularReflectionProbability = GetSpecularReflectionProbability(id, ray.waveIndex);
+		float reflectionProbability = diffuseReflectionProbability + specularReflectionProbability;
+		if ((m.type == MaterialType::Absorbing) || (reflectionProbability <= 0.0f))
+		{
+			return false;
+		}
+
+		// new ray origin is intersection point
+		newRay.origin = intersection.point;
+
+		const Frame& frame = intersection.frame;
+		if (sampler.Get1D() * reflectionProbability < diffuseReflectionProbability)
+		{
+			// cosine distributed direction in shading frame
+			float phi = 2.0f * Util::Pi * sampler.Get1D();
+			float cosTheta = std::sqrt(sampler.Get1D());
+			newRay.direction = frame.ToWorld(Vec3::FromPhiTheta(phi, cosTheta));
+			return true;
+		}
+
+		switch (m.type)
+		{
+		case MaterialType::Phong:
+		{
+			// ideal specular reflection direction in shading frame
+			Vec3 wo = frame.ToLocal(-ray.direction);
+			Vec3 specularDirection(-wo[0], -wo[1], wo[2]);
+
+			// direction in the lobe around specular direction
+			float phi = 2.0f * Util::Pi * sampler.Get1D();
+			float cosAlpha = std::pow(sampler.Get1D(), 1.0f / (m.phongExponent + 1.0f));
+			Vec3 wi = Frame(specularDirection).ToWorld(Vec3::FromPhiTheta(phi, cosAlpha));
+
+			// direction points inside the material
+			if (wi[2] < Util::Eps)
+			{
+				return false;
+			}
+
+			newRay.direction = frame.ToWorld(wi);
+			return true;
+		}
+
+		default:
+			// material has no specular reflection
+			return false;
+		}
+	}
+
+	void MaterialTable::Evaluate(MaterialId id, const Ray& ray, const Intersection& intersection, const Vec3& direction, SpectralPacket& value) const
+	{
+		Evaluate(id, ray, intersection, direction, false, value);
+	}
+
+	void MaterialTable::EvaluateAdjoint(MaterialId id, const Ray& ray, const Intersection& intersection, const Vec3& direction, SpectralPacket& value) const
+	{
+		Evaluate(id, ray, intersection, direction, true, value);
+	}
+
+	void MaterialTable::Evaluate(MaterialId id, const Ray& ray, const Intersection& intersection, const Vec3& direction, bool adjoint, SpectralPacket& value) const
+	{
+		const MaterialRecord& m = records_[id];
+
+		switch (m.type)
+		{
+		case MaterialType::Lambertian:
+		{
+			// BDRF is reflectance / pi, directions below surface get nothing
+			float cosTheta = std::max(intersection.normal.Dot(direction), 0.0f);
+			CopySpectrum(ray, m.diffuseReflectance, cosTheta / Util::Pi, value);
+			break;
+		}
+
+		case MaterialType::Phong:
+		{
+			// directions in shading frame
+			const Frame& frame = intersection.frame;
+			Vec3 wi = frame.ToLocal(direction);
+			Vec3 wo = frame.ToLocal(-ray.direction);
+
+			float diffuse = 0.0f;
+			float specular = 0.0f;
+
+			// directions below surface get nothing
+			if (wi[2] > 0.0f)
+			{
+				// Lambertian part and Phong lobe around ideal specular
+				// reflection direction, normalized the same way as in Sample
+				diffuse = wi[2] / Util::Pi;
+				specular = GetPhongPdf(m.phongExponent, wo, wi);
+
+				// the lobe is BSDF times cosine of the direction towards light, which
+				// is wo for light arriving along the ray, so the cosine is exchanged
+				if (adjoint)
+				{
+					specular = wo[2] > 0.0f ? specular * wi[2] / wo[2] : 0.0f;
+				}
+			}
+
+			if (ray.IsFullSpectrum())
+			{
+				value.Combine(m.diffuseReflectance, diffuse, m.specularReflectance, specular);
+			}
+			else
+			{
+				ray.ForEachWave(value.size(), [&](size_t i)
+				{
+					value[i] = diffuse * m.diffuseReflectance[i] + specular * m.specularReflectance[i];
+				});
+			}
+			break;
+		}
+
+		default:
+			// nothing is reflected
+			CopySpectrum(ray, m.diffuseReflectance, 0.0f, value);
+			break;
+		}
+	}
+
+	float MaterialTable::GetPdf(MaterialId id, const Ray& ray, const Intersection& intersection, const Vec3& direction) const
+	{
+		const MaterialRecord& m = records_[id];
+
+		switch (m.type)
+		{
+		case MaterialType::Lambertian:
+		{
+			// cosine distributed direction
+			float cosTheta = std::max(intersection.normal.Dot(direction), 0.0f);
+			return cosTheta / Util::Pi;
+		}
+
+		case MaterialType::Phong:
+		{
+			// directions in shading frame
+			const Frame& frame = intersection.frame;
+			Vec3 wi = frame.ToLocal(direction);
+			Vec3 wo = frame.ToLocal(-ray.direction);
+
+			float diffuseReflectionProbability = GetDiffuseReflectionProbability(id, ray.waveIndex);
+			float specularReflectionProbability = GetSpecularReflectionProbability(id, ray.waveIndex);
+			float reflectionProbability = diffuseReflectionProbability + specularReflectionProbability;
+			if ((wi[2] <= 0.0f) || (reflectionProbability <= 0.0f))
+			{
+				return 0.0f;
+			}
+
+			// lobes are chosen proportionally to reflection probabilities
+			float diffusePdf = wi[2] / Util::Pi;
+			float specularPdf = GetPhongPdf(m.phongExponent, wo, wi);
+			return (diffuseReflectionProbability * diffusePdf + specularReflectionProbability * specularPdf) / reflectionProbability;
+		}
+
+		default:
+			return 0.0f;
+		}
+	}
+
+	void MaterialTable::GetRadiance(MaterialId id, const Ray& ray, const Intersection& intersection, SpectralPacket& radiance) const
+	{
+		const MaterialRecord& m = records_[id];
+
+		// cos(theta)
+		float cosTheta = intersection.normal.Dot(-ray.direction);
+
+		// cos distribution with Phong exponent
+		float weight = m.emissionExponent != 1.0f
+			? std::pow(cosTheta, m.emissionExponent)
+			: cosTheta;
+
+		// get radiance scaled according to cosine distribution with Phong exponent
+		CopySpectrum(ray, m.radiance, weight, radiance);
+	}
+
+	Vec3 MaterialTable::SampleEmission(MaterialId id, const Intersection& intersection, Sampler& sampler) const
+	{
+		const MaterialRecord& m = records_[id];
+
+		// cos^n distribution around normal
+		float phi = 2.0f * Util::Pi * sampler.Get1D();
+		float cosTheta = std::pow(sampler.Get1D(), 1.0f / (m.emissionExponent + 1.0f));
+		return intersection.frame.ToWorld(Vec3::FromPhiTheta(phi, cosTheta));
+	}
+
+	float MaterialTable::GetEmissionPdf(MaterialId id, const Intersection& intersection, const Vec3& direction) const
+	{
+		const MaterialRecord& m = records_[id];
+
+		float cosTheta = intersection.normal.Dot(direction);
+		if (cosTheta <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		return (m.emissionExponent + 1.0f) / (2.0f * Util::Pi) * std::pow(cosTheta, m.emissionExponent);
+	}
+
+	void MaterialTable::CopySpectrum(const Ray& ray, const SpectralPacket& source, float scale, SpectralPacket& target)
+	{
+		if (ray.IsFullSpectrum())
+		{
+			target.Scale(source, scale);
+		}
+		else
+		{
+			ray.ForEachWave(source.size(), [&](size_t i) { target[i] = scale * source[i]; });
+		}
+	}
+
+	float MaterialTable::GetPhongPdf(float phongExponent, const Vec3& wo, const Vec3& wi)
+	{
+		// Phong lobe around ideal specular reflection direction
+		Vec3 specularDirection(-wo[0], -wo[1], wo[2]);
+		float cosAlpha = std::max(wi.Dot(specularDirection), 0.0f);
+		return (phongExponent + 1.0f) / (2.0f * Util::Pi) * std::pow(cosAlpha, phongExponent);
+	}
+
+}
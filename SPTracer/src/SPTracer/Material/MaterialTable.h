@@ -0,0 +1,72 @@
+#ifndef SPT_MATERIAL_TABLE_H
+#define SPT_MATERIAL_TABLE_H
+
+#include "../stdafx.h"
+#include "MaterialId.h"
+#include "MaterialRecord.h"
+
+namespace SPTracer
+{
+	struct Intersection;
+	struct Ray;
+	class Material;
+	class Sampler;
+	class Vec3;
+
+	// Closed set of flattened materials referenced by primitives
+	// through material id. Shading is evaluated with a switch on the
+	// material type, so there are no virtual calls on the hot path.
+	class MaterialTable
+	{
+	public:
+		// adds material (only once), returns its id
+		MaterialId Add(const Material& material);
+
+		size_t size() const;
+		const MaterialRecord& record(MaterialId id) const;
+
+		bool IsEmissive(MaterialId id) const;
+		bool IsReflective(MaterialId id) const;
+		float GetDiffuseReflectionProbability(MaterialId id, int waveIndex) const;		// use index -1 for average reflectivity
+		float GetSpecularReflectionProbability(MaterialId id, int waveIndex) const;		// use index -1 for average reflectivity
+
+		// samples new ray, lobe is chosen proportionally to reflection probabilities,
+		// returns false if the ray is not reflected
+		bool Sample(MaterialId id, const Ray& ray, const Intersection& intersection, Sampler& sampler, Ray& newRay) const;
+
+		// BSDF times cosine for new direction
+		void Evaluate(MaterialId id, const Ray& ray, const Intersection& intersection, const Vec3& direction, SpectralPacket& value) const;
+
+		// adjoint BSDF times cosine for new direction, used by paths traced from
+		// lights: ray brings light and new direction leads towards the camera
+		void EvaluateAdjoint(MaterialId id, const Ray& ray, const Intersection& intersection, const Vec3& direction, SpectralPacket& value) const;
+
+		// solid angle density of sampling new direction, given that the ray is reflected
+		float GetPdf(MaterialId id, const Ray& ray, const Intersection& intersection, const Vec3& direction) const;
+
+		void GetRadiance(MaterialId id, const Ray& ray, const Intersection& intersection, SpectralPacket& radiance) const;
+
+		// samples direction of emitted light proportionally to the emission distribution
+		Vec3 SampleEmission(MaterialId id, const Intersection& intersection, Sampler& sampler) const;
+
+		// solid angle density of sampling emitted direction
+		float GetEmissionPdf(MaterialId id, const Intersection& intersection, const Vec3& direction) const;
+
+	private:
+		std::vector<MaterialRecord> records_;
+		std::unordered_map<const Material*, MaterialId> ids_;
+
+		// copies scaled values of wave lengths carried by the ray
+		static void CopySpectrum(const Ray& ray, const SpectralPacket& source, float scale, SpectralPacket& target);
+
+		// BSDF times cosine, Phong lobe is not reciprocal, so it is
+		// scaled for light transported in the adjoint direction
+		void Evaluate(MaterialId id, const Ray& ray, const Intersection& intersection, const Vec3& direction, bool adjoint, SpectralPacket& value) const;
+
+		// Phong lobe densities in shading frame
+		static float GetPhongPdf(float phongExponent, const Vec3& wo, const Vec3& wi);
+	};
+
+}
+
+#endif
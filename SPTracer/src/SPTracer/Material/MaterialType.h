@@ -0,0 +1,17 @@
+#ifndef SPT_MATERIAL_TYPE_H
+#define SPT_MATERIAL_TYPE_H
+
+namespace SPTracer
+{
+
+	// reflection model of flattened material
+	enum class MaterialType
+	{
+		Absorbing,
+		Lambertian,
+		Phong
+	};
+
+}
+
+#endif
@@ -2,8 +2,7 @@
 #include "../Util.h"
 #include "../Color/Color.h"
 #include "../Color/Spectrum.h"
-#include "../Tracer/Intersection.h"
-#include "../Tracer/Ray.h"
+#include "MaterialRecord.h"
 #include "PhongLuminaireMaterial.h"
 
 namespace SPTracer
@@ -19,7 +18,7 @@ namespace SPTracer
 		      phongExponent_(phongExponent)
 	{
 		// precompute radiances
-		precomputedRadiance_.resize(spectrum.count);
+		precomputedRadiance_ = SpectralPacket(spectrum.count);
 		std::transform(spectrum.values.begin(), spectrum.values.end(), precomputedRadiance_.begin(),
 			std::bind(&Color::GetAmplitude, radiance_.get(), std::placeholders::_1));
 
@@ -41,57 +40,37 @@ namespace SPTracer
 		return reflective_;
 	}
 
-	void PhongLuminaireMaterial::GetNewRayDiffuse(const Ray& ray, const Intersection& intersection, Ray& newRay, std::vector<float>& reflectance) const
-	{
-		reflectiveMaterial_->GetNewRayDiffuse(ray, intersection, newRay, reflectance);
-	}
-
-	bool PhongLuminaireMaterial::GetNewRaySpecular(const Ray& ray, const Intersection& intersection, Ray& newRay, std::vector<float>& reflectance) const
-	{
-		return reflectiveMaterial_->GetNewRaySpecular(ray, intersection, newRay, reflectance);
-	}
-
-	void PhongLuminaireMaterial::GetDiffuseReflectance(const Ray& ray, const Intersection& intersection, const Ray& newRay, std::vector<float>& reflectance) const
+	float PhongLuminaireMaterial::GetDiffuseReflectionProbability(int waveIndex) const
 	{
-		return reflectiveMaterial_->GetDiffuseReflectance(ray, intersection, newRay, reflectance);
+		return reflectiveMaterial_->GetDiffuseReflectionProbability(waveIndex);
 	}
 
-	void PhongLuminaireMaterial::GetSpecularReflectance(const Ray& ray, const Intersection& intersection, const Ray& newRay, std::vector<float>& reflectance) const
+	float PhongLuminaireMaterial::GetSpecularReflectionProbability(int waveIndex) const
 	{
-		return reflectiveMaterial_->GetSpecularReflectance(ray, intersection, newRay, reflectance);
+		return reflectiveMaterial_->GetSpecularReflectionProbability(waveIndex);
 	}
 
-	void PhongLuminaireMaterial::GetRadiance(const Ray& ray, const Intersection& intersection, std::vector<float>& radiance) const
+	void PhongLuminaireMaterial::Flatten(MaterialRecord& record) const
 	{
-		// cos(theta)
-		float cosTheta = intersection.normal.Dot(-ray.direction);
-
-		// cos distribution with Phong exponent
-		float weight = phongExponentUsed_
-			? std::pow(cosTheta, phongExponent_)
-			: cosTheta;
-
-		if (ray.waveIndex == -1)
+		// reflection of the reflective material
+		if (reflective_)
 		{
-			// get radiance for spectrum and scale according to cosine distribution with Phong exponent
-			std::transform(precomputedRadiance_.begin(), precomputedRadiance_.end(), radiance.begin(),
-				std::bind(std::multiplies<float>(), weight, std::placeholders::_1));
+			reflectiveMaterial_->Flatten(record);
 		}
 		else
 		{
-			// get radiance for wave length scaled according to cosine distribution with Phong exponent
-			radiance[ray.waveIndex] = weight * precomputedRadiance_[ray.waveIndex];
+			record.type = MaterialType::Absorbing;
+			record.diffuseReflectionProbability = 0.0f;
+			record.specularReflectionProbability = 0.0f;
+			record.phongExponent = 0.0f;
+			record.diffuseReflectance = SpectralPacket(precomputedRadiance_.size());
+			record.specularReflectance = SpectralPacket(precomputedRadiance_.size());
 		}
-	}
-
-	float PhongLuminaireMaterial::GetDiffuseReflectionProbability(int waveIndex) const
-	{
-		return reflectiveMaterial_->GetDiffuseReflectionProbability(waveIndex);
-	}
 
-	float PhongLuminaireMaterial::GetSpecularReflectionProbability(int waveIndex) const
-	{
-		return reflectiveMaterial_->GetSpecularReflectionProbability(waveIndex);
+		// emission
+		record.emissive = true;
+		record.emissionExponent = phongExponentUsed_ ? phongExponent_ : 1.0f;
+		record.radiance = precomputedRadiance_;
 	}
 
 }
@@ -2,6 +2,7 @@
 #define SPT_PHONG_LUMINAIRE_MATERIAL_H
 
 #include "../stdafx.h"
+#include "../Color/SpectralPacket.h"
 #include "Material.h"
 
 namespace SPTracer
@@ -20,19 +21,15 @@ namespace SPTracer
 
 		virtual bool IsEmissive() const override;
 		virtual bool IsReflective() const override;
-		virtual void GetNewRayDiffuse(const Ray& ray, const Intersection& intersection, Ray& newRay, std::vector<float>& reflectance) const override;
-		virtual bool GetNewRaySpecular(const Ray& ray, const Intersection& intersection, Ray& newRay, std::vector<float>& reflectance) const override;
-		virtual void GetDiffuseReflectance(const Ray& ray, const Intersection& intersection, const Ray& newRay, std::vector<float>& reflectance) const override;
-		virtual void GetSpecularReflectance(const Ray& ray, const Intersection& intersection, const Ray& newRay, std::vector<float>& reflectance) const override;
-		virtual void GetRadiance(const Ray& ray, const Intersection& intersection, std::vector<float>& radiance) const override;
 		virtual float GetDiffuseReflectionProbability(int waveIndex) const override;		// use index -1 for average reflectivity
 		virtual float GetSpecularReflectionProbability(int waveIndex) const override;		// use index -1 for average reflectivity
+		virtual void Flatten(MaterialRecord& record) const override;
 
 	private:
 		std::unique_ptr<Material> reflectiveMaterial_;
 		std::unique_ptr<Color> radiance_;
 		float phongExponent_;
-		std::vector<float> precomputedRadiance_;
+		SpectralPacket precomputedRadiance_;
 		bool reflective_;
 		bool phongExponentUsed_;
 	};
@@ -0,0 +1,113 @@
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "PhotonGrid.h"
+
+namespace SPTracer
+{
+
+	PhotonGrid::PhotonGrid()
+		: invCellSize_(0.0f)
+	{
+	}
+
+	void PhotonGrid::Build(const std::vector<Vec3>& points, const std::vector<float>& radii)
+	{
+		buckets_.clear();
+		indices_.clear();
+
+		// bounds of points and the largest radius
+		float maxRadius = 0.0f;
+		size_t count = 0;
+		Vec3 min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			if (radii[i] <= 0.0f)
+			{
+				continue;
+			}
+
+			for (size_t axis = 0; axis < 3; axis++)
+			{
+				min[axis] = std::min(min[axis], points[i][axis] - radii[i]);
+			}
+
+			maxRadius = std::max(maxRadius, radii[i]);
+			count++;
+		}
+
+		if (count == 0)
+		{
+			return;
+		}
+
+		// sphere overlaps at most two cells along each axis
+		origin_ = min;
+		invCellSize_ = 1.0f / (2.0f * maxRadius);
+
+		// count entries of buckets, then place sphere indices
+		// after the entries of preceding buckets
+		buckets_.assign(count + 1, 0);
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			if (radii[i] > 0.0f)
+			{
+				ForEachBucket(points[i], radii[i], [&](size_t bucket) { buckets_[bucket + 1]++; });
+			}
+		}
+
+		std::partial_sum(buckets_.begin(), buckets_.end(), buckets_.begin());
+		indices_.resize(buckets_.back());
+
+		std::vector<std::uint32_t> next(buckets_.begin(), buckets_.end() - 1);
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			if (radii[i] > 0.0f)
+			{
+				ForEachBucket(points[i], radii[i], [&](size_t bucket) { indices_[next[bucket]++] = static_cast<std::uint32_t>(i); });
+			}
+		}
+	}
+
+	int PhotonGrid::GetCell(const Vec3& point, size_t axis) const
+	{
+		return static_cast<int>(std::floor((point[axis] - origin_[axis]) * invCellSize_));
+	}
+
+	size_t PhotonGrid::GetBucket(int x, int y, int z) const
+	{
+		// large primes decorrelate neighbouring cells
+		std::uint32_t h = (static_cast<std::uint32_t>(x) * 73856093u) ^
+			(static_cast<std::uint32_t>(y) * 19349663u) ^
+			(static_cast<std::uint32_t>(z) * 83492791u);
+		return static_cast<size_t>(h) % (buckets_.size() - 1);
+	}
+
+	template <typename Function>
+	void PhotonGrid::ForEachBucket(const Vec3& point, float radius, Function function) const
+	{
+		Vec3 min = point - radius;
+		Vec3 max = point + radius;
+
+		// distinct cells may share bucket, sphere is stored in it only once,
+		// sphere overlaps two cells along axis (three, if rounded up at both ends)
+		std::array<size_t, 27> stored;
+		size_t storedCount = 0;
+
+		for (int z = GetCell(min, 2); z <= GetCell(max, 2); z++)
+		{
+			for (int y = GetCell(min, 1); y <= GetCell(max, 1); y++)
+			{
+				for (int x = GetCell(min, 0); x <= GetCell(max, 0); x++)
+				{
+					size_t bucket = GetBucket(x, y, z);
+					if (std::find(stored.begin(), stored.begin() + storedCount, bucket) == stored.begin() + storedCount)
+					{
+						stored[storedCount++] = bucket;
+						function(bucket);
+					}
+				}
+			}
+		}
+	}
+
+}
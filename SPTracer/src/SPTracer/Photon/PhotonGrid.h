@@ -0,0 +1,55 @@
+#ifndef SPT_PHOTON_GRID_H
+#define SPT_PHOTON_GRID_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+
+namespace SPTracer
+{
+
+	// Spatial hash grid over spheres around points. Every sphere is stored
+	// in all cells overlapped by its bounding box, cells are hashed into
+	// a table with as many buckets as there are spheres. Buckets are kept
+	// in one array (compressed rows), so that lookups touch few cache lines.
+	class PhotonGrid
+	{
+	public:
+		PhotonGrid();
+
+		// builds grid, spheres with zero radius are skipped
+		void Build(const std::vector<Vec3>& points, const std::vector<float>& radii);
+
+		// calls function with index of every sphere which can contain the point,
+		// spheres in hash collisions are included, so distance must be checked
+		template <typename Function>
+		void ForEachCandidate(const Vec3& point, Function function) const
+		{
+			if (buckets_.empty())
+			{
+				return;
+			}
+
+			size_t bucket = GetBucket(GetCell(point, 0), GetCell(point, 1), GetCell(point, 2));
+			for (std::uint32_t i = buckets_[bucket]; i < buckets_[bucket + 1]; i++)
+			{
+				function(static_cast<size_t>(indices_[i]));
+			}
+		}
+
+	private:
+		Vec3 origin_;
+		float invCellSize_;
+		std::vector<std::uint32_t> buckets_;	// first index of bucket, one more for the end
+		std::vector<std::uint32_t> indices_;	// sphere indices of all buckets
+
+		int GetCell(const Vec3& point, size_t axis) const;
+		size_t GetBucket(int x, int y, int z) const;
+
+		// calls function with bucket of every cell overlapped by the sphere
+		template <typename Function>
+		void ForEachBucket(const Vec3& point, float radius, Function function) const;
+	};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "../stdafx.h"
+#include "../Util.h"
+#include "ProgressivePhotonMap.h"
+
+namespace SPTracer
+{
+
+	const float ProgressivePhotonMap::Alpha = 2.0f / 3.0f;
+
+	ProgressivePhotonMap::ProgressivePhotonMap(size_t pixelCount, size_t spectrumCount, float initialRadius, unsigned long photonsPerIteration)
+		: visiblePoints_(pixelCount), pixels_(pixelCount), photonsPerIteration_(photonsPerIteration)
+	{
+		for (VisiblePoint& v : visiblePoints_)
+		{
+			v.weight = SpectralPacket(spectrumCount);
+			v.valid = false;
+		}
+
+		for (PixelStatistics& p : pixels_)
+		{
+			p.radius = initialRadius;
+			p.photons = 0.0f;
+			p.flux = Vec3(0.0f, 0.0f, 0.0f);
+		}
+	}
+
+	unsigned long ProgressivePhotonMap::photonsPerIteration() const
+	{
+		return photonsPerIteration_;
+	}
+
+	unsigned long long ProgressivePhotonMap::photonCount() const
+	{
+		return photonCount_;
+	}
+
+	ProgressivePhotonMap::VisiblePoint& ProgressivePhotonMap::visiblePoint(size_t pixel)
+	{
+		return visiblePoints_[pixel];
+	}
+
+	void ProgressivePhotonMap::BuildGrid()
+	{
+		std::vector<Vec3> points(visiblePoints_.size());
+		std::vector<float> radii(visiblePoints_.size());
+		for (size_t i = 0; i < visiblePoints_.size(); i++)
+		{
+			points[i] = visiblePoints_[i].point;
+			radii[i] = visiblePoints_[i].valid ? pixels_[i].radius : 0.0f;
+		}
+
+		grid_.Build(points, radii);
+	}
+
+	void ProgressivePhotonMap::AddFlux(size_t pixel, const Vec3& flux)
+	{
+		PixelStatistics& p = pixels_[pixel];
+		p.iterationFlux[0].Add(flux[0]);
+		p.iterationFlux[1].Add(flux[1]);
+		p.iterationFlux[2].Add(flux[2]);
+		p.iterationPhotons.Add(1.0f);
+	}
+
+	void ProgressivePhotonMap::Update()
+	{
+		for (size_t i = 0; i < pixels_.size(); i++)
+		{
+			PixelStatistics& p = pixels_[i];
+			float m = p.iterationPhotons.load();
+			if (m > 0.0f)
+			{
+				// only a fraction of new photons is kept, and radius is reduced,
+				// so that density of photons in the disc stays the same
+				float photons = p.photons + Alpha * m;
+				float radius = p.radius * std::sqrt(photons / (p.photons + m));
+				Vec3 iterationFlux(p.iterationFlux[0].load(), p.iterationFlux[1].load(), p.iterationFlux[2].load());
+				p.flux = (p.flux + iterationFlux) * (radius * radius / (p.radius * p.radius));
+				p.photons = photons;
+				p.radius = radius;
+			}
+
+			p.iterationFlux.fill(0.0f);
+			p.iterationPhotons = 0.0f;
+			visiblePoints_[i].valid = false;
+		}
+
+		photonCount_ += photonsPerIteration_;
+	}
+
+	Vec3 ProgressivePhotonMap::GetRadiance(size_t pixel) const
+	{
+		const PixelStatistics& p = pixels_[pixel];
+		if ((photonCount_ == 0) || (p.radius <= 0.0f))
+		{
+			return Vec3(0.0f, 0.0f, 0.0f);
+		}
+
+		// flux per unit area of the disc, per emitted photon
+		return p.flux / (static_cast<float>(photonCount_) * Util::Pi * p.radius * p.radius);
+	}
+
+}
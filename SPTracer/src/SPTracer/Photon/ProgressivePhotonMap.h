@@ -0,0 +1,88 @@
+#ifndef SPT_PROGRESSIVE_PHOTON_MAP_H
+#define SPT_PROGRESSIVE_PHOTON_MAP_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "../Color/SpectralPacket.h"
+#include "../Guiding/AtomicFloat.h"
+#include "PhotonGrid.h"
+
+namespace SPTracer
+{
+
+	// State of stochastic progressive photon mapping. Every iteration has two
+	// phases: visible points of all pixels are found by camera paths, then
+	// photons are shot from lights and their flux is gathered in visible points
+	// through the hash grid. At the end of iteration gathering radius of pixels
+	// that received photons is reduced.
+	class ProgressivePhotonMap
+	{
+	public:
+		// first diffuse vertex of camera path
+		struct VisiblePoint
+		{
+			Vec3 point;
+			Vec3 normal;
+			SpectralPacket weight;	// camera path weight times BSDF
+			bool valid;
+		};
+
+		ProgressivePhotonMap(size_t pixelCount, size_t spectrumCount, float initialRadius, unsigned long photonsPerIteration);
+
+		unsigned long photonsPerIteration() const;
+
+		// photons shot in completed iterations
+		unsigned long long photonCount() const;
+
+		VisiblePoint& visiblePoint(size_t pixel);
+
+		// builds grid over visible points, after they are found
+		void BuildGrid();
+
+		// calls function with pixel and visible point for every visible point with point inside gathering radius
+		template <typename Function>
+		void ForEachVisiblePoint(const Vec3& point, Function function) const
+		{
+			grid_.ForEachCandidate(point, [&](size_t pixel)
+			{
+				const VisiblePoint& v = visiblePoints_[pixel];
+				Vec3 d = v.point - point;
+				if (d.Dot(d) < pixels_[pixel].radius * pixels_[pixel].radius)
+				{
+					function(pixel, v);
+				}
+			});
+		}
+
+		// adds flux (XYZ) of photon to pixel (thread safe)
+		void AddFlux(size_t pixel, const Vec3& flux);
+
+		// ends iteration: reduces radii and clears visible points
+		void Update();
+
+		// radiance estimate (XYZ) of photons gathered in pixel
+		Vec3 GetRadiance(size_t pixel) const;
+
+	private:
+		// fraction of new photons kept in statistics
+		static const float Alpha;
+
+		struct PixelStatistics
+		{
+			float radius;
+			float photons;		// photons gathered with reduced radius
+			Vec3 flux;			// flux of the photons, in XYZ
+			std::array<AtomicFloat, 3> iterationFlux;
+			AtomicFloat iterationPhotons;
+		};
+
+		std::vector<VisiblePoint> visiblePoints_;
+		std::vector<PixelStatistics> pixels_;
+		PhotonGrid grid_;
+		const unsigned long photonsPerIteration_;
+		unsigned long long photonCount_ = 0;
+	};
+
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "../stdafx.h"
+#include "../Material/MaterialTable.h"
+#include "../Scene/Mesh.h"
+#include "../Tracer/Hit.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/Ray.h"
+#include "Instance.h"
+
+namespace SPTracer
+{
+
+	// Emissive primitive of the mesh placed in world space by the instance.
+	// Mesh primitives are planar, so the transform scales their area by a
+	// constant factor and uniformly sampled points stay uniform.
+	class Instance::Emitter : public Primitive
+	{
+	public:
+		Emitter(const Instance& instance, const Primitive& primitive);
+
+		virtual bool Intersect(const Ray& ray, Hit& hit) const override;
+		virtual void GetIntersection(const Ray& ray, const Hit& hit, Intersection& intersection) const override;
+		virtual const Box GetBox() const override;
+		virtual Box Clip(const Box& box) const override;
+		virtual float GetArea() const override;
+		virtual void SamplePoint(float u, float v, Vec3& point, Vec3& normal) const override;
+		virtual void GetNormalBounds(Vec3& axis, float& cosTheta) const override;
+
+	private:
+		const Instance& instance_;
+		const Primitive& primitive_;
+		Box box_;
+		float area_;
+	};
+
+	Instance::Emitter::Emitter(const Instance& instance, const Primitive& primitive)
+		: Primitive(primitive), instance_(instance), primitive_(primitive), box_(instance.ToWorldSpace(primitive.GetBox()))
+	{
+		// emitter is a copy of the primitive with its material id, which is already registered
+
+		// area scale of the plane is found from three points of the surface,
+		// corners of the sampled square are vertices of triangle
+		Vec3 p0, p1, p2, normal;
+		primitive_.SamplePoint(0.0f, 0.0f, p0, normal);
+		primitive_.SamplePoint(1.0f, 0.0f, p1, normal);
+		primitive_.SamplePoint(1.0f, 1.0f, p2, normal);
+
+		float objectArea = (p1 - p0).Cross(p2 - p0).Length();
+		float worldArea = instance_.transform_.TransformVector(p1 - p0).Cross(instance_.transform_.TransformVector(p2 - p0)).Length();
+		area_ = objectArea > 0.0f ? primitive_.GetArea() * worldArea / objectArea : 0.0f;
+	}
+
+	bool Instance::Emitter::Intersect(const Ray& ray, Hit& hit) const
+	{
+		if (!primitive_.Intersect(instance_.ToObjectSpace(ray), hit))
+		{
+			return false;
+		}
+
+		// hit of the primitive inside of the instance
+		hit.subPrimitive = &primitive_;
+		hit.primitive = &instance_;
+
+		return true;
+	}
+
+	void Instance::Emitter::GetIntersection(const Ray& ray, const Hit& hit, Intersection& intersection) const
+	{
+		instance_.GetIntersection(ray, hit, intersection);
+	}
+
+	const Box Instance::Emitter::GetBox() const
+	{
+		return box_;
+	}
+
+	Box Instance::Emitter::Clip(const Box& box) const
+	{
+		return Overlap(box_, box);
+	}
+
+	float Instance::Emitter::GetArea() const
+	{
+		return area_;
+	}
+
+	void Instance::Emitter::SamplePoint(float u, float v, Vec3& point, Vec3& normal) const
+	{
+		primitive_.SamplePoint(u, v, point, normal);
+		point = instance_.transform_.TransformPoint(point);
+		normal = instance_.transform_.TransformNormal(normal).Normalize();
+	}
+
+	void Instance::Emitter::GetNormalBounds(Vec3& axis, float& cosTheta) const
+	{
+		primitive_.GetNormalBounds(axis, cosTheta);
+		axis = instance_.transform_.TransformNormal(axis).Normalize();
+
+		// transform which is not a rotation can widen the cone of interpolated normals
+		if (cosTheta < 1.0f)
+		{
+			cosTheta = -1.0f;
+		}
+	}
+
+	Instance::Instance(std::shared_ptr<Mesh> mesh, Transform transform)
+		: Primitive(nullptr), mesh_(std::move(mesh)), transform_(std::move(transform)), invTransform_(transform_.Inverse())
+	{
+		// mirroring transform changes the winding of triangles
+		flipsHandedness_ = transform_.Determinant() < 0.0f;
+
+		// world space bounding box of the mesh
+		box_ = ToWorldSpace(mesh_->box());
+	}
+
+	Instance::~Instance()
+	{
+	}
+
+	bool Instance::Intersect(const Ray& ray, Hit& hit) const
+	{
+		// intersect mesh in object space
+		if (!mesh_->Intersect(ToObjectSpace(ray), hit))
+		{
+			return false;
+		}
+
+		// remember the primitive of the mesh for attributes fetch
+		hit.subPrimitive = hit.primitive;
+		hit.primitive = this;
+
+		return true;
+	}
+
+	void Instance::GetIntersection(const Ray& ray, const Hit& hit, Intersection& intersection) const
+	{
+		// get intersection with the primitive of the mesh,
+		// intersection primitive is the primitive of the mesh
+		Hit objectHit = hit;
+		objectHit.primitive = hit.subPrimitive;
+		hit.subPrimitive->GetIntersection(ToObjectSpace(ray), objectHit, intersection);
+
+		// transform intersection back to world space
+		intersection.point = ray.origin + hit.distance * ray.direction;
+		intersection.normal = transform_.TransformNormal(intersection.normal).Normalize();
+
+		// emissive primitive is represented by the emitter of this instance
+		if (!meshEmitters_.empty())
+		{
+			auto it = meshEmitters_.find(hit.subPrimitive);
+			if (it != meshEmitters_.end())
+			{
+				intersection.primitive = it->second;
+			}
+		}
+	}
+
+	const Box Instance::GetBox() const
+	{
+		return box_;
+	}
+
+	Box Instance::Clip(const Box& box) const
+	{
+		return Overlap(box_, box);
+	}
+
+	void Instance::RegisterMaterials(MaterialTable& materialTable)
+	{
+		// materials of the mesh primitives
+		mesh_->RegisterMaterials(materialTable);
+
+		// emissive primitives of the mesh are placed by this instance
+		emitters_.clear();
+		meshEmitters_.clear();
+		for (const auto& p : mesh_->primitives())
+		{
+			if (p->hasMaterial() && materialTable.IsEmissive(p->materialId()))
+			{
+				emitters_.push_back(std::make_shared<Emitter>(*this, *p));
+				meshEmitters_[p.get()] = emitters_.back().get();
+			}
+		}
+	}
+
+	const std::vector<std::shared_ptr<Primitive>>& Instance::emitters() const
+	{
+		return emitters_;
+	}
+
+	Ray Instance::ToObjectSpace(const Ray& ray) const
+	{
+		// transform ray into object space, direction is not normalized,
+		// so that distances along the ray are the same in both spaces
+		Ray objectRay;
+		objectRay.origin = invTransform_.TransformPoint(ray.origin);
+		objectRay.direction = invTransform_.TransformVector(ray.direction);
+		objectRay.waveIndex = ray.waveIndex;
+		objectRay.heroIndex = ray.heroIndex;
+		objectRay.waveCount = ray.waveCount;
+
+		// mirroring transform flips front and back faces
+		objectRay.refracted = flipsHandedness_ ? !ray.refracted : ray.refracted;
+
+		return objectRay;
+	}
+
+	Box Instance::ToWorldSpace(const Box& box) const
+	{
+		// box around transformed corners of the box
+		Vec3 min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+		Vec3 max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+
+		for (size_t i = 0; i < 8; i++)
+		{
+			Vec3 corner(
+				(i & 1) ? box.max()[0] : box.min()[0],
+				(i & 2) ? box.max()[1] : box.min()[1],
+				(i & 4) ? box.max()[2] : box.min()[2]
+				);
+
+			Vec3 p = transform_.TransformPoint(corner);
+			for (size_t j = 0; j < 3; j++)
+			{
+				min[j] = std::min(min[j], p[j]);
+				max[j] = std::max(max[j], p[j]);
+			}
+		}
+
+		return Box(std::move(min), std::move(max));
+	}
+
+	Box Instance::Overlap(const Box& bounds, const Box& box)
+	{
+		Vec3 min;
+		Vec3 max;
+		for (size_t i = 0; i < 3; i++)
+		{
+			min[i] = std::max(bounds.min()[i], box.min()[i]);
+			max[i] = std::min(bounds.max()[i], box.max()[i]);
+		}
+
+		return Box(std::move(min), std::move(max));
+	}
+
+}
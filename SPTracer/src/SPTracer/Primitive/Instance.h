@@ -0,0 +1,58 @@
+#ifndef SPT_INSTANCE_H
+#define SPT_INSTANCE_H
+
+#include "../stdafx.h"
+#include "../Transform.h"
+#include "Box.h"
+#include "Primitive.h"
+
+namespace SPTracer
+{
+	struct Hit;
+	struct Intersection;
+	struct Ray;
+	class Mesh;
+
+	// Placement of a shared mesh in the scene. Rays are transformed
+	// into the object space of the mesh during traversal. Instance itself
+	// is not an area light, emissive primitives of the mesh are sampled
+	// through emitters placed in world space by the instance.
+	class Instance : public Primitive
+	{
+	public:
+		Instance(std::shared_ptr<Mesh> mesh, Transform transform);
+		virtual ~Instance();
+
+		virtual bool Intersect(const Ray& ray, Hit& hit) const override;
+		virtual void GetIntersection(const Ray& ray, const Hit& hit, Intersection& intersection) const override;
+		virtual const Box GetBox() const override;
+		virtual Box Clip(const Box& box) const override;
+		virtual void RegisterMaterials(MaterialTable& materialTable) override;
+
+		// emissive primitives of the mesh in world space, available after materials are registered;
+		// intersections with them refer to these emitters instead of the primitives of the mesh
+		const std::vector<std::shared_ptr<Primitive>>& emitters() const;
+
+	private:
+		class Emitter;
+
+		std::shared_ptr<Mesh> mesh_;
+		Transform transform_;		// object to world
+		Transform invTransform_;	// world to object
+		Box box_;					// world space bounding box
+		bool flipsHandedness_;
+		std::vector<std::shared_ptr<Primitive>> emitters_;
+		std::unordered_map<const Primitive*, const Primitive*> meshEmitters_;	// emitter of mesh primitive
+
+		Ray ToObjectSpace(const Ray& ray) const;
+
+		// world space box around transformed object space box
+		Box ToWorldSpace(const Box& box) const;
+
+		// overlap of bounds and the given box
+		static Box Overlap(const Box& bounds, const Box& box);
+	};
+
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef SPT_PACKED_VERTEX_H
+#define SPT_PACKED_VERTEX_H
+
+#include "../stdafx.h"
+
+namespace SPTracer
+{
+
+	// vertex shading attributes in compressed form (8 bytes),
+	// see VertexCompression for encoding and decoding
+	struct PackedVertex
+	{
+		std::uint32_t normal;				// octahedral encoded normal
+		std::array<std::uint16_t, 2> tex;	// half float texture coordinates
+	};
+
+}
+
+#endif
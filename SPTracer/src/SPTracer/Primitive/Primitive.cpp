@@ -1,4 +1,6 @@
 #include "../stdafx.h"
+#include "../Vec3.h"
+#include "../Material/MaterialTable.h"
 #include "Primitive.h"
 
 namespace SPTracer
@@ -17,4 +19,40 @@ namespace SPTracer
 		return *material_;
 	}
 
+	bool Primitive::hasMaterial() const
+	{
+		return material_ != nullptr;
+	}
+
+	MaterialId Primitive::materialId() const
+	{
+		return materialId_;
+	}
+
+	void Primitive::RegisterMaterials(MaterialTable& materialTable)
+	{
+		if (material_ != nullptr)
+		{
+			materialId_ = materialTable.Add(*material_);
+		}
+	}
+
+	float Primitive::GetArea() const
+	{
+		return 0.0f;
+	}
+
+	void Primitive::SamplePoint(float u, float v, Vec3& point, Vec3& normal) const
+	{
+		point = Vec3(0.0f, 0.0f, 0.0f);
+		normal = Vec3(0.0f, 0.0f, 1.0f);
+	}
+
+	void Primitive::GetNormalBounds(Vec3& axis, float& cosTheta) const
+	{
+		// all directions
+		axis = Vec3(0.0f, 0.0f, 1.0f);
+		cosTheta = -1.0f;
+	}
+
 }
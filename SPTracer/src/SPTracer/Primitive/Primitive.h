@@ -2,13 +2,17 @@
 #define SPT_PRIMITIVE_H
 
 #include "../stdafx.h"
+#include "../Material/MaterialId.h"
 
 namespace SPTracer
 {
+	struct Hit;
 	struct Intersection;
 	struct Ray;
 	class Box;
 	class Material;
+	class MaterialTable;
+	class Vec3;
 
 	class Primitive
 	{
@@ -16,15 +20,30 @@ namespace SPTracer
 		virtual ~Primitive();
 
 		const Material& material() const;
+		bool hasMaterial() const;
+		MaterialId materialId() const;
+
+		// adds material to material table and stores its id
+		virtual void RegisterMaterials(MaterialTable& materialTable);
 		virtual const Box GetBox() const = 0;
-		virtual bool Intersect(const Ray& ray, Intersection& intersection) const = 0;
+		virtual bool Intersect(const Ray& ray, Hit& hit) const = 0;
+		virtual void GetIntersection(const Ray& ray, const Hit& hit, Intersection& intersection) const = 0;
 		virtual Box Clip(const Box& box) const = 0;
 
+		// surface area and uniform sampling of surface points (used for area lights),
+		// primitives without area (instances) are not sampled
+		virtual float GetArea() const;
+		virtual void SamplePoint(float u, float v, Vec3& point, Vec3& normal) const;
+
+		// cone containing all shading normals of the surface (used for light hierarchy)
+		virtual void GetNormalBounds(Vec3& axis, float& cosTheta) const;
+
 	protected:
 		explicit Primitive(std::shared_ptr<Material> material);
 
 	private:
 		std::shared_ptr<Material> material_;
+		MaterialId materialId_ = InvalidMaterialId;
 	};
 
 }
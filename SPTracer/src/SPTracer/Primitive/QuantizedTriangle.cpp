@@ -0,0 +1,87 @@
+#include "../stdafx.h"
+#include "../Tracer/Hit.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/Ray.h"
+#include "QuantizedTriangle.h"
+#include "Triangle.h"
+
+namespace SPTracer
+{
+
+	QuantizedTriangle::QuantizedTriangle(std::shared_ptr<Material> material, std::shared_ptr<const Box> bounds, const Triangle& triangle)
+		: Primitive(std::move(material)), bounds_(std::move(bounds)), attributes_(triangle.attributes())
+	{
+		// quantize vertex coordinates
+		for (size_t i = 0; i < 3; i++)
+		{
+			positions_[i] = VertexCompression::QuantizePosition(triangle.coord(i), *bounds_);
+		}
+	}
+
+	QuantizedTriangle::~QuantizedTriangle()
+	{
+	}
+
+	bool QuantizedTriangle::Intersect(const Ray& ray, Hit& hit) const
+	{
+		// decode vertex coordinates
+		std::array<Vec3, 3> coords = GetCoords();
+
+		if (!Triangle::IntersectTriangle(ray, coords[0], coords[1] - coords[0], coords[2] - coords[0], hit.distance, hit.u, hit.v))
+		{
+			return false;
+		}
+
+		hit.primitive = this;
+
+		return true;
+	}
+
+	void QuantizedTriangle::GetIntersection(const Ray& ray, const Hit& hit, Intersection& intersection) const
+	{
+		intersection.point = ray.origin + hit.distance * ray.direction;
+		intersection.normal = Triangle::InterpolateNormal(attributes_, hit.u, hit.v);
+		intersection.distance = hit.distance;
+		intersection.primitive = this;
+	}
+
+	const Box QuantizedTriangle::GetBox() const
+	{
+		return Triangle::GetTriangleBox(GetCoords());
+	}
+
+	Box QuantizedTriangle::Clip(const Box& box) const
+	{
+		return Triangle::ClipTriangle(GetCoords(), box);
+	}
+
+	float QuantizedTriangle::GetArea() const
+	{
+		std::array<Vec3, 3> coords = GetCoords();
+		return 0.5f * (coords[1] - coords[0]).Cross(coords[2] - coords[0]).Length();
+	}
+
+	void QuantizedTriangle::SamplePoint(float u, float v, Vec3& point, Vec3& normal) const
+	{
+		std::array<Vec3, 3> coords = GetCoords();
+		float b1, b2;
+		Triangle::SampleTriangle(u, v, b1, b2);
+		point = coords[0] + b1 * (coords[1] - coords[0]) + b2 * (coords[2] - coords[0]);
+		normal = Triangle::InterpolateNormal(attributes_, b1, b2);
+	}
+
+	void QuantizedTriangle::GetNormalBounds(Vec3& axis, float& cosTheta) const
+	{
+		Triangle::GetNormalCone(attributes_, axis, cosTheta);
+	}
+
+	std::array<Vec3, 3> QuantizedTriangle::GetCoords() const
+	{
+		return {
+			VertexCompression::DequantizePosition(positions_[0], *bounds_),
+			VertexCompression::DequantizePosition(positions_[1], *bounds_),
+			VertexCompression::DequantizePosition(positions_[2], *bounds_)
+		};
+	}
+
+}
@@ -0,0 +1,44 @@
+#ifndef SPT_QUANTIZED_TRIANGLE_H
+#define SPT_QUANTIZED_TRIANGLE_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "Box.h"
+#include "PackedVertex.h"
+#include "Primitive.h"
+#include "VertexCompression.h"
+
+namespace SPTracer
+{
+	struct Hit;
+	struct Intersection;
+	struct Ray;
+	class Material;
+	class Triangle;
+
+	// triangle with 16 bit vertex coordinates relative to bounds shared by a mesh
+	class QuantizedTriangle : public Primitive
+	{
+	public:
+		QuantizedTriangle(std::shared_ptr<Material> material, std::shared_ptr<const Box> bounds, const Triangle& triangle);
+		virtual ~QuantizedTriangle();
+
+		virtual bool Intersect(const Ray& ray, Hit& hit) const override;
+		virtual void GetIntersection(const Ray& ray, const Hit& hit, Intersection& intersection) const override;
+		virtual const Box GetBox() const override;
+		virtual Box Clip(const Box& box) const override;
+		virtual float GetArea() const override;
+		virtual void SamplePoint(float u, float v, Vec3& point, Vec3& normal) const override;
+		virtual void GetNormalBounds(Vec3& axis, float& cosTheta) const override;
+
+	private:
+		std::shared_ptr<const Box> bounds_;
+		std::array<VertexCompression::QuantizedPosition, 3> positions_;
+		std::array<PackedVertex, 3> attributes_;
+
+		std::array<Vec3, 3> GetCoords() const;
+	};
+
+}
+
+#endif
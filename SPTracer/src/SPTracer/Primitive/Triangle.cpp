@@ -3,9 +3,11 @@
 #include "../Scene/SplitEvent.h"
 #include "../Scene/SplitEventType.h"
 #include "../Scene/SplitPlane.h"
+#include "../Tracer/Hit.h"
 #include "../Tracer/Intersection.h"
 #include "../Tracer/Ray.h"
 #include "Triangle.h"
+#include "VertexCompression.h"
 
 namespace SPTracer
 {
@@ -15,26 +17,43 @@ namespace SPTracer
 	{
 	}
 
-	Triangle::Triangle(std::shared_ptr<Material> material, Vertex v1, Vertex v2, Vertex v3)
-		: Primitive(std::move(material)), vertices_{ std::move(v1), std::move(v2), std::move(v3) }
+	Triangle::Triangle(std::shared_ptr<Material> material, const Vertex& v1, const Vertex& v2, const Vertex& v3)
+		: Primitive(std::move(material)), v0_(v1.coord),
+		attributes_{ VertexCompression::Pack(v1), VertexCompression::Pack(v2), VertexCompression::Pack(v3) }
 	{
 		// pre-compute edges for ray-triangle intersection test
-		e1_ = vertices_[1].coord - vertices_[0].coord;
-		e2_ = vertices_[2].coord - vertices_[0].coord;
+		e1_ = v2.coord - v1.coord;
+		e2_ = v3.coord - v1.coord;
 	}
 
 	Triangle::~Triangle()
 	{
 	}
 
-	Vertex& Triangle::operator[](size_t index)
+	Vertex Triangle::operator[](size_t index) const
 	{
-		return vertices_[index];
+		Vertex v;
+		v.coord = coord(index);
+		VertexCompression::Unpack(attributes_[index], v);
+		return v;
 	}
 
-	const Vertex& Triangle::operator[](size_t index) const
+	Vec3 Triangle::coord(size_t index) const
 	{
-		return vertices_[index];
+		switch (index)
+		{
+		case 1:
+			return v0_ + e1_;
+		case 2:
+			return v0_ + e2_;
+		default:
+			return v0_;
+		}
+	}
+
+	const std::array<PackedVertex, 3>& Triangle::attributes() const
+	{
+		return attributes_;
 	}
 
 	const Vec3& Triangle::e1() const
@@ -50,47 +69,137 @@ namespace SPTracer
 	void Triangle::ComputeNormals()
 	{
 		// compute normal vector (using cross product)
-		Vec3 normal = e1_.Cross(e2_).Normalize();
+		std::uint32_t normal = VertexCompression::EncodeNormal(e1_.Cross(e2_).Normalize());
 
 		// set normal for vertices
-		std::for_each(vertices_.begin(), vertices_.end(), [&normal](Vertex& v) { v.normal = normal; });
+		std::for_each(attributes_.begin(), attributes_.end(), [normal](PackedVertex& v) { v.normal = normal; });
 	}
 
 	const Box Triangle::GetBox() const
+	{
+		return GetTriangleBox({ coord(0), coord(1), coord(2) });
+	}
+
+	bool Triangle::Intersect(const Ray& ray, Hit& hit) const
+	{
+		if (!IntersectTriangle(ray, v0_, e1_, e2_, hit.distance, hit.u, hit.v))
+		{
+			return false;
+		}
+
+		hit.primitive = this;
+
+		return true;
+	}
+
+	void Triangle::GetIntersection(const Ray& ray, const Hit& hit, Intersection& intersection) const
+	{
+		intersection.point = ray.origin + hit.distance * ray.direction;
+		intersection.normal = InterpolateNormal(attributes_, hit.u, hit.v);
+		intersection.distance = hit.distance;
+		intersection.primitive = this;
+	}
+
+	Box Triangle::Clip(const Box& box) const
+	{
+		return ClipTriangle({ coord(0), coord(1), coord(2) }, box);
+	}
+
+	float Triangle::GetArea() const
+	{
+		return 0.5f * e1_.Cross(e2_).Length();
+	}
+
+	void Triangle::SamplePoint(float u, float v, Vec3& point, Vec3& normal) const
+	{
+		float b1, b2;
+		SampleTriangle(u, v, b1, b2);
+		point = v0_ + b1 * e1_ + b2 * e2_;
+		normal = InterpolateNormal(attributes_, b1, b2);
+	}
+
+	void Triangle::GetNormalBounds(Vec3& axis, float& cosTheta) const
+	{
+		GetNormalCone(attributes_, axis, cosTheta);
+	}
+
+	Box Triangle::GetTriangleBox(const std::array<Vec3, 3>& coords)
 	{
 		// compute AABB
-		auto result = std::minmax_element(vertices_.begin(), vertices_.end(), [](const Vertex& a, const Vertex& b) {
-			return a.coord[0] < b.coord[0];
+		auto result = std::minmax_element(coords.begin(), coords.end(), [](const Vec3& a, const Vec3& b) {
+			return a[0] < b[0];
 		});
 
-		float minX = (*result.first).coord[0];
-		float maxX = (*result.second).coord[0];
+		float minX = (*result.first)[0];
+		float maxX = (*result.second)[0];
 
-		result = std::minmax_element(vertices_.begin(), vertices_.end(), [](const Vertex& a, const Vertex& b) {
-			return a.coord[1] < b.coord[1];
+		result = std::minmax_element(coords.begin(), coords.end(), [](const Vec3& a, const Vec3& b) {
+			return a[1] < b[1];
 		});
 
-		float minY = (*result.first).coord[1];
-		float maxY = (*result.second).coord[1];
+		float minY = (*result.first)[1];
+		float maxY = (*result.second)[1];
 
-		result = std::minmax_element(vertices_.begin(), vertices_.end(), [](const Vertex& a, const Vertex& b) {
-			return a.coord[2] < b.coord[2];
+		result = std::minmax_element(coords.begin(), coords.end(), [](const Vec3& a, const Vec3& b) {
+			return a[2] < b[2];
 		});
 
-		float minZ = (*result.first).coord[2];
-		float maxZ = (*result.second).coord[2];
+		float minZ = (*result.first)[2];
+		float maxZ = (*result.second)[2];
 
 		return Box(Vec3(minX, minY, minZ), Vec3(maxX, maxY, maxZ));
 	}
 
-	bool Triangle::Intersect(const Ray& ray, Intersection& intersection) const
+	Vec3 Triangle::InterpolateNormal(const std::array<PackedVertex, 3>& attributes, float u, float v)
+	{
+		return ((1.0f - u - v) * VertexCompression::DecodeNormal(attributes[0].normal) +
+			u * VertexCompression::DecodeNormal(attributes[1].normal) +
+			v * VertexCompression::DecodeNormal(attributes[2].normal)).Normalize();
+	}
+
+	void Triangle::SampleTriangle(float u, float v, float& b1, float& b2)
+	{
+		// uniform barycentric coordinates from unit square
+		float su = std::sqrt(u);
+		b1 = su * (1.0f - v);
+		b2 = su * v;
+	}
+
+	void Triangle::GetNormalCone(const std::array<PackedVertex, 3>& attributes, Vec3& axis, float& cosTheta)
+	{
+		std::array<Vec3, 3> normals = {
+			VertexCompression::DecodeNormal(attributes[0].normal),
+			VertexCompression::DecodeNormal(attributes[1].normal),
+			VertexCompression::DecodeNormal(attributes[2].normal)
+		};
+
+		Vec3 sum = normals[0] + normals[1] + normals[2];
+		float length = sum.Length();
+
+		// interpolated normals stay inside the cone of vertex normals
+		// only if the cone is not wider than a hemisphere
+		cosTheta = -1.0f;
+		axis = Vec3(0.0f, 0.0f, 1.0f);
+		if (length > 0.0f)
+		{
+			Vec3 a = sum / length;
+			float c = std::min(std::min(a.Dot(normals[0]), a.Dot(normals[1])), a.Dot(normals[2]));
+			if (c >= 0.0f)
+			{
+				axis = a;
+				cosTheta = std::min(c, 1.0f);
+			}
+		}
+	}
+
+	bool Triangle::IntersectTriangle(const Ray& ray, const Vec3& v0, const Vec3& e1, const Vec3& e2, float& t, float& u, float& v)
 	{
 		//
 		// MollerTrumbore intersection algorithm
 		//
 
-		Vec3 p = ray.direction.Cross(e2_);
-		float det = e1_.Dot(p);
+		Vec3 p = ray.direction.Cross(e2);
+		float det = e1.Dot(p);
 
 		// check determinant
 		if (ray.refracted)
@@ -116,8 +225,8 @@ namespace SPTracer
 		float invDet = 1.0f / det;
 
 		// get first barycentric coordinate
-		Vec3 s = ray.origin - vertices_[0].coord;
-		float u = invDet * s.Dot(p);
+		Vec3 s = ray.origin - v0;
+		u = invDet * s.Dot(p);
 
 		// check first barycentric coordinate
 		if ((u < 0.0f) || (u > 1.0f))
@@ -126,8 +235,8 @@ namespace SPTracer
 		}
 
 		// get second barycentric coordinate
-		Vec3 q = s.Cross(e1_);
-		float v = invDet * ray.direction.Dot(q);
+		Vec3 q = s.Cross(e1);
+		v = invDet * ray.direction.Dot(q);
 
 		// check second and third barycentric coordinates
 		if ((v < 0.0f) || ((u + v) > 1.0f))
@@ -137,7 +246,7 @@ namespace SPTracer
 
 		// at this stage we can compute t to find out where
 		// the intersection point is on the line
-		float t = invDet * e2_.Dot(q);
+		t = invDet * e2.Dot(q);
 
 		// check intersection
 		if (t < Util::Eps)
@@ -147,21 +256,10 @@ namespace SPTracer
 			return false;
 		}
 
-		// ray intersection point
-		Vec3 point = ray.origin + t * ray.direction;
-
-		// normal
-		intersection.normal = ((1.0f - u - v) * vertices_[0].normal + u * vertices_[1].normal + v * vertices_[2].normal).Normalize();
-
-		// fill the intersection data
-		intersection.point = std::move(point);
-		// intersection.normal = n;
-		intersection.distance = t;
-
 		return true;
 	}
 
-	Box Triangle::Clip(const Box& box) const
+	Box Triangle::ClipTriangle(const std::array<Vec3, 3>& coords, const Box& box)
 	{
 		// key keyPoints (intersections and keyPoints inside the box)
 		std::vector<Vec3> keyPoints;
@@ -193,7 +291,7 @@ namespace SPTracer
 			// sort points of triangle
 			for (size_t i = 0; i < 3; i++)
 			{
-				const Vec3& v = vertices_[i].coord;
+				const Vec3& v = coords[i];
 
 				if (v[dimension] < box.min()[dimension])
 				{
@@ -220,12 +318,12 @@ namespace SPTracer
 			for (size_t il : left)
 			{
 				// line start point
-				const Vec3& a = vertices_[il].coord;
+				const Vec3& a = coords[il];
 
 				for (size_t ir : rightAndMiddle)
 				{
 					// line end point
-					const Vec3& b = vertices_[ir].coord;
+					const Vec3& b = coords[ir];
 
 					// distance from line keyPoints to plane
 					float da = box.min()[dimension] - a[dimension];
@@ -269,12 +367,12 @@ namespace SPTracer
 			for (size_t il : leftAndMiddle)
 			{
 				// line start point
-				const Vec3& a = vertices_[il].coord;
+				const Vec3& a = coords[il];
 
 				for (size_t ir : right)
 				{
 					// line end point
-					const Vec3& b = vertices_[ir].coord;
+					const Vec3& b = coords[ir];
 
 					// distance from line keyPoints to plane
 					float da = box.max()[dimension] - a[dimension];
@@ -321,7 +419,7 @@ namespace SPTracer
 		{
 			if (middleCount[i] == 3)
 			{
-				keyPoints.push_back(vertices_[i].coord);
+				keyPoints.push_back(coords[i]);
 			}
 		}
 
@@ -336,7 +434,7 @@ namespace SPTracer
 		Vec3 clippedMax;
 
 		// get AABB box for triangle
-		const auto aabb = GetBox();
+		const auto aabb = GetTriangleBox(coords);
 
 		// find perfect perfect splits for all dimensions
 		for (unsigned char dimension = 0; dimension < 3; dimension++)
@@ -4,11 +4,13 @@
 #include "../stdafx.h"
 #include "../Vec3.h"
 #include "Box.h"
+#include "PackedVertex.h"
 #include "Primitive.h"
 #include "Vertex.h"
 
 namespace SPTracer
 {
+	struct Hit;
 	struct Intersection;
 	struct Ray;
 	class Material;
@@ -17,23 +19,37 @@ namespace SPTracer
 	{
 	public:
 		explicit Triangle(std::shared_ptr<Material> material);
-		Triangle(std::shared_ptr<Material> material, Vertex v1, Vertex v2, Vertex v3);
+		Triangle(std::shared_ptr<Material> material, const Vertex& v1, const Vertex& v2, const Vertex& v3);
 		virtual ~Triangle();
 
-		Vertex& operator[](size_t index);
-		const Vertex& operator[](size_t index) const;
+		Vertex operator[](size_t index) const;
+		Vec3 coord(size_t index) const;
+		const std::array<PackedVertex, 3>& attributes() const;
 		const Vec3& e1() const;
 		const Vec3& e2() const;
 
 		void ComputeNormals();
-		virtual bool Intersect(const Ray& ray, Intersection& intersection) const override;
+		virtual bool Intersect(const Ray& ray, Hit& hit) const override;
+		virtual void GetIntersection(const Ray& ray, const Hit& hit, Intersection& intersection) const override;
 		virtual const Box GetBox() const override;
 		virtual Box Clip(const Box& box) const override;
+		virtual float GetArea() const override;
+		virtual void SamplePoint(float u, float v, Vec3& point, Vec3& normal) const override;
+		virtual void GetNormalBounds(Vec3& axis, float& cosTheta) const override;
+
+		// geometry routines shared with other triangle representations
+		static bool IntersectTriangle(const Ray& ray, const Vec3& v0, const Vec3& e1, const Vec3& e2, float& t, float& u, float& v);
+		static Vec3 InterpolateNormal(const std::array<PackedVertex, 3>& attributes, float u, float v);
+		static Box GetTriangleBox(const std::array<Vec3, 3>& coords);
+		static Box ClipTriangle(const std::array<Vec3, 3>& coords, const Box& box);
+		static void SampleTriangle(float u, float v, float& b1, float& b2);
+		static void GetNormalCone(const std::array<PackedVertex, 3>& attributes, Vec3& axis, float& cosTheta);
 
 	private:
-		std::array<Vertex, 3> vertices_;
+		Vec3 v0_;
 		Vec3 e1_;
 		Vec3 e2_;
+		std::array<PackedVertex, 3> attributes_;
 	};
 
 }
@@ -0,0 +1,209 @@
+#include "../stdafx.h"
+#include "Box.h"
+#include "Vertex.h"
+#include "VertexCompression.h"
+
+namespace SPTracer
+{
+
+	namespace
+	{
+		// maximal value of 16 bit signed normalized component
+		const float SNormMax = 32767.0f;
+
+		// maximal value of 16 bit unsigned quantized coordinate
+		const float QuantizedMax = 65535.0f;
+
+		float SignNotZero(float value)
+		{
+			return value >= 0.0f ? 1.0f : -1.0f;
+		}
+
+		std::uint16_t EncodeSNorm(float value)
+		{
+			value = std::min(std::max(value, -1.0f), 1.0f);
+			return static_cast<std::uint16_t>(static_cast<std::int16_t>(std::round(value * SNormMax)));
+		}
+
+		float DecodeSNorm(std::uint16_t value)
+		{
+			return std::max(static_cast<std::int16_t>(value) / SNormMax, -1.0f);
+		}
+	}
+
+	std::uint32_t VertexCompression::EncodeNormal(const Vec3& normal)
+	{
+		// project on octahedron |x| + |y| + |z| = 1
+		float l1 = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+		if (l1 <= 0.0f)
+		{
+			// degenerate normal, encode default direction (0, 0, 1)
+			return 0;
+		}
+
+		float x = normal[0] / l1;
+		float y = normal[1] / l1;
+
+		// fold lower hemisphere over the diagonals
+		if (normal[2] < 0.0f)
+		{
+			float fx = (1.0f - std::abs(y)) * SignNotZero(x);
+			float fy = (1.0f - std::abs(x)) * SignNotZero(y);
+			x = fx;
+			y = fy;
+		}
+
+		return static_cast<std::uint32_t>(EncodeSNorm(x)) |
+			(static_cast<std::uint32_t>(EncodeSNorm(y)) << 16);
+	}
+
+	Vec3 VertexCompression::DecodeNormal(std::uint32_t packed)
+	{
+		float x = DecodeSNorm(static_cast<std::uint16_t>(packed & 0xFFFF));
+		float y = DecodeSNorm(static_cast<std::uint16_t>(packed >> 16));
+		float z = 1.0f - std::abs(x) - std::abs(y);
+
+		// unfold lower hemisphere
+		float t = std::max(-z, 0.0f);
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		return Vec3(x, y, z).Normalize();
+	}
+
+	std::uint16_t VertexCompression::EncodeHalf(float value)
+	{
+		std::uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		std::uint16_t sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000);
+		std::uint32_t mantissa = bits & 0x007FFFFF;
+		int exponent = static_cast<int>((bits >> 23) & 0xFF);
+
+		// infinity and NaN
+		if (exponent == 0xFF)
+		{
+			return static_cast<std::uint16_t>(sign | 0x7C00 | (mantissa != 0 ? 0x0200 : 0));
+		}
+
+		// re-bias exponent
+		exponent = exponent - 127 + 15;
+
+		// overflow to infinity
+		if (exponent >= 0x1F)
+		{
+			return static_cast<std::uint16_t>(sign | 0x7C00);
+		}
+
+		// denormalized half or zero
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+			{
+				return sign;
+			}
+
+			// add implicit leading bit and shift with rounding to nearest
+			mantissa |= 0x00800000;
+			int shift = 14 - exponent;
+			std::uint32_t half = mantissa >> shift;
+			std::uint32_t remainder = mantissa & ((1u << shift) - 1);
+			std::uint32_t halfway = 1u << (shift - 1);
+			if ((remainder > halfway) || ((remainder == halfway) && (half & 1)))
+			{
+				half++;
+			}
+
+			return static_cast<std::uint16_t>(sign | half);
+		}
+
+		// normalized half, round mantissa to nearest even
+		std::uint32_t half = (static_cast<std::uint32_t>(exponent) << 10) | (mantissa >> 13);
+		std::uint32_t remainder = mantissa & 0x1FFF;
+		if ((remainder > 0x1000) || ((remainder == 0x1000) && (half & 1)))
+		{
+			// carry into exponent is correct, including overflow to infinity
+			half++;
+		}
+
+		return static_cast<std::uint16_t>(sign | half);
+	}
+
+	float VertexCompression::DecodeHalf(std::uint16_t half)
+	{
+		std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000) << 16;
+		std::uint32_t exponent = (half >> 10) & 0x1F;
+		std::uint32_t mantissa = half & 0x03FF;
+
+		std::uint32_t bits;
+		if (exponent == 0x1F)
+		{
+			// infinity and NaN
+			bits = sign | 0x7F800000 | (mantissa << 13);
+		}
+		else if (exponent != 0)
+		{
+			// normalized value
+			bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+		}
+		else if (mantissa != 0)
+		{
+			// denormalized value, normalize it
+			exponent = 127 - 15 + 1;
+			while ((mantissa & 0x0400) == 0)
+			{
+				mantissa <<= 1;
+				exponent--;
+			}
+
+			bits = sign | (exponent << 23) | ((mantissa & 0x03FF) << 13);
+		}
+		else
+		{
+			// signed zero
+			bits = sign;
+		}
+
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	VertexCompression::QuantizedPosition VertexCompression::QuantizePosition(const Vec3& position, const Box& bounds)
+	{
+		QuantizedPosition result;
+		for (size_t i = 0; i < 3; i++)
+		{
+			float extent = bounds.max()[i] - bounds.min()[i];
+			float t = extent > 0.0f ? (position[i] - bounds.min()[i]) / extent : 0.0f;
+			t = std::min(std::max(t, 0.0f), 1.0f);
+			result[i] = static_cast<std::uint16_t>(std::round(t * QuantizedMax));
+		}
+
+		return result;
+	}
+
+	Vec3 VertexCompression::DequantizePosition(const QuantizedPosition& position, const Box& bounds)
+	{
+		Vec3 extent = bounds.max() - bounds.min();
+		return Vec3(
+			bounds.min()[0] + extent[0] * (position[0] / QuantizedMax),
+			bounds.min()[1] + extent[1] * (position[1] / QuantizedMax),
+			bounds.min()[2] + extent[2] * (position[2] / QuantizedMax));
+	}
+
+	PackedVertex VertexCompression::Pack(const Vertex& vertex)
+	{
+		PackedVertex result;
+		result.normal = EncodeNormal(vertex.normal);
+		result.tex = { EncodeHalf(vertex.tex[0]), EncodeHalf(vertex.tex[1]) };
+		return result;
+	}
+
+	void VertexCompression::Unpack(const PackedVertex& packed, Vertex& vertex)
+	{
+		vertex.normal = DecodeNormal(packed.normal);
+		vertex.tex = Vec3(DecodeHalf(packed.tex[0]), DecodeHalf(packed.tex[1]), 0.0f);
+	}
+
+}
@@ -0,0 +1,40 @@
+#ifndef SPT_VERTEX_COMPRESSION_H
+#define SPT_VERTEX_COMPRESSION_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "PackedVertex.h"
+
+namespace SPTracer
+{
+	class Box;
+	struct Vertex;
+
+	class VertexCompression
+	{
+	public:
+		VertexCompression() = delete;
+
+		// quantized position (16 bits per coordinate relative to bounds)
+		using QuantizedPosition = std::array<std::uint16_t, 3>;
+
+		// normal in octahedral mapping (two 16 bit signed components)
+		static std::uint32_t EncodeNormal(const Vec3& normal);
+		static Vec3 DecodeNormal(std::uint32_t packed);
+
+		// IEEE 754 half precision float
+		static std::uint16_t EncodeHalf(float value);
+		static float DecodeHalf(std::uint16_t half);
+
+		// position relative to bounding box
+		static QuantizedPosition QuantizePosition(const Vec3& position, const Box& bounds);
+		static Vec3 DequantizePosition(const QuantizedPosition& position, const Box& bounds);
+
+		// vertex shading attributes (coordinates are not packed)
+		static PackedVertex Pack(const Vertex& vertex);
+		static void Unpack(const PackedVertex& packed, Vertex& vertex);
+	};
+
+}
+
+#endif
@@ -0,0 +1,267 @@
+#include "../stdafx.h"
+#include "../Exception.h"
+#include "../Frame.h"
+#include "../Log.h"
+#include "../Util.h"
+#include "../Color/SpectralPacket.h"
+#include "../Material/MaterialTable.h"
+#include "../Primitive/Triangle.h"
+#include "../Sampler/Sampler.h"
+#include "../Scene/Scene.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/Ray.h"
+#include "RadiositySolver.h"
+
+namespace SPTracer
+{
+
+	const size_t RadiositySolver::NoPatch = std::numeric_limits<size_t>::max();
+
+	RadiositySolver::RadiositySolver(const Scene& scene, size_t spectrumCount, unsigned int taskCount,
+		float patchSize, unsigned int rayCount, unsigned int iterationCount)
+		: scene_(scene), spectrumCount_(spectrumCount), rayCount_(std::max(rayCount, 1u)),
+		  iterationCount_(iterationCount), work_(taskCount)
+	{
+		for (const std::shared_ptr<Triangle>& triangle : scene_.planarTriangles())
+		{
+			// the longest edge is split into cells no longer than patch size
+			Vec3 origin = triangle->coord(0);
+			Vec3 e1 = triangle->e1();
+			Vec3 e2 = triangle->e2();
+			float length = std::max(std::max(e1.Length(), e2.Length()), (e2 - e1).Length());
+			size_t segments = std::max(static_cast<size_t>(std::ceil(length / patchSize)), static_cast<size_t>(1));
+
+			// planar mesh has the same normal at all vertices
+			Vec3 normal;
+			float cosTheta;
+			triangle->GetNormalBounds(normal, cosTheta);
+
+			AddPatches(*triangle, origin, e1, e2, normal, segments, triangle->materialId());
+		}
+
+		formFactors_.resize(patches_.size());
+		radiosity_ = emission_;
+		nextRadiosity_.resize(emission_.size());
+
+		Log::Info("RadiositySolver: " + std::to_string(patches_.size()) + " patches");
+	}
+
+	size_t RadiositySolver::patchCount() const
+	{
+		return patches_.size();
+	}
+
+	unsigned int RadiositySolver::iteration() const
+	{
+		return iteration_;
+	}
+
+	unsigned int RadiositySolver::iterationCount() const
+	{
+		return iterationCount_;
+	}
+
+	PhaseWork& RadiositySolver::work()
+	{
+		return work_;
+	}
+
+	void RadiositySolver::AddPatches(const Primitive& primitive, const Vec3& origin, const Vec3& e1, const Vec3& e2, const Vec3& normal,
+		size_t segments, MaterialId material)
+	{
+		const MaterialRecord& m = scene_.materialTable().record(material);
+
+		PatchGrid grid;
+		grid.first = patches_.size();
+		grid.segments = segments;
+		grid.origin = origin;
+		grid.e1 = e1;
+		grid.e2 = e2;
+		grids_[&primitive] = grid;
+
+		Vec3 d1 = e1 / static_cast<float>(segments);
+		Vec3 d2 = e2 / static_cast<float>(segments);
+
+		// rows along the first edge, each has lower and upper triangles of cells
+		// interleaved, the last cell of row has only the lower one
+		for (size_t a = 0; a < segments; a++)
+		{
+			for (size_t b = 0; b < segments - a; b++)
+			{
+				Vec3 corner = origin + d1 * static_cast<float>(a) + d2 * static_cast<float>(b);
+				patches_.push_back({ corner, d1, d2, normal });
+				if (b + 1 < segments - a)
+				{
+					patches_.push_back({ corner + d1 + d2, -d2, -d1, normal });
+				}
+			}
+		}
+
+#ifdef _DEBUG
+		// every cell of the grid is found from a point inside it
+		for (size_t i = grid.first; i < patches_.size(); i++)
+		{
+			const Patch& p = patches_[i];
+			Intersection intersection;
+			intersection.point = p.origin + (p.e1 + p.e2) / 3.0f;
+			intersection.primitive = &primitive;
+			if (FindCell(intersection) != i)
+			{
+				std::string msg = "RadiositySolver: Patch " + std::to_string(i) + " is not found from its center";
+				Log::Error(msg);
+				throw Exception(msg);
+			}
+		}
+#endif
+
+		// emitted exitance of radiance distributed as cos^n
+		float emissionScale = m.emissive ? 2.0f * Util::Pi / (m.emissionExponent + 2.0f) : 0.0f;
+		float reflectanceScale = m.type == MaterialType::Lambertian ? 1.0f : 0.0f;
+		for (size_t i = grid.first; i < patches_.size(); i++)
+		{
+			for (size_t t = 0; t < spectrumCount_; t++)
+			{
+				emission_.push_back(m.radiance[t] * emissionScale);
+				reflectance_.push_back(m.diffuseReflectance[t] * reflectanceScale);
+			}
+		}
+	}
+
+	void RadiositySolver::ComputeFormFactors(size_t patch, Sampler& sampler)
+	{
+		const Patch& p = patches_[patch];
+		Frame frame(p.normal);
+
+		// fraction of cosine distributed rays from uniformly distributed points is the form factor
+		std::vector<std::uint32_t> hits;
+		hits.reserve(rayCount_);
+		for (unsigned int i = 0; i < rayCount_; i++)
+		{
+			float u, v, b1, b2;
+			sampler.Get2D(u, v);
+			Triangle::SampleTriangle(u, v, b1, b2);
+
+			float phi = 2.0f * Util::Pi * sampler.Get1D();
+			float cosTheta = std::sqrt(sampler.Get1D());
+
+			Ray ray;
+			ray.origin = p.origin + b1 * p.e1 + b2 * p.e2;
+			ray.direction = frame.ToWorld(Vec3::FromPhiTheta(phi, cosTheta));
+			ray.waveIndex = -1;
+			ray.heroIndex = 0;
+			ray.waveCount = 0;
+			ray.refracted = false;
+
+			Intersection intersection;
+			if (scene_.Intersect(ray, intersection))
+			{
+				size_t hit = FindPatch(ray, intersection);
+				if ((hit != NoPatch) && (hit != patch))
+				{
+					hits.push_back(static_cast<std::uint32_t>(hit));
+				}
+			}
+		}
+
+		// rays hitting the same patch are merged
+		std::sort(hits.begin(), hits.end());
+		std::vector<FormFactor>& row = formFactors_[patch];
+		row.clear();
+		float weight = 1.0f / static_cast<float>(rayCount_);
+		for (std::uint32_t hit : hits)
+		{
+			if (row.empty() || (row.back().patch != hit))
+			{
+				row.push_back({ hit, 0.0f });
+			}
+
+			row.back().value += weight;
+		}
+	}
+
+	void RadiositySolver::Iterate(size_t patch)
+	{
+		const float* reflectance = &reflectance_[patch * spectrumCount_];
+		const float* emission = &emission_[patch * spectrumCount_];
+		float* next = &nextRadiosity_[patch * spectrumCount_];
+
+		// exitance arriving from other patches
+		std::fill(next, next + spectrumCount_, 0.0f);
+		for (const FormFactor& f : formFactors_[patch])
+		{
+			const float* radiosity = &radiosity_[f.patch * spectrumCount_];
+			for (size_t t = 0; t < spectrumCount_; t++)
+			{
+				next[t] += f.value * radiosity[t];
+			}
+		}
+
+		for (size_t t = 0; t < spectrumCount_; t++)
+		{
+			next[t] = emission[t] + reflectance[t] * next[t];
+		}
+	}
+
+	void RadiositySolver::CompleteIteration()
+	{
+		std::swap(radiosity_, nextRadiosity_);
+		iteration_++;
+	}
+
+	size_t RadiositySolver::FindPatch(const Ray& ray, const Intersection& intersection) const
+	{
+		size_t patch = FindCell(intersection);
+		if ((patch == NoPatch) || (ray.direction.Dot(patches_[patch].normal) >= 0.0f))
+		{
+			return NoPatch;
+		}
+
+		return patch;
+	}
+
+	size_t RadiositySolver::FindCell(const Intersection& intersection) const
+	{
+		auto it = grids_.find(intersection.primitive);
+		if (it == grids_.end())
+		{
+			return NoPatch;
+		}
+
+		// barycentric coordinates of the point
+		const PatchGrid& grid = it->second;
+		Vec3 d = intersection.point - grid.origin;
+		float d11 = grid.e1.Dot(grid.e1);
+		float d12 = grid.e1.Dot(grid.e2);
+		float d22 = grid.e2.Dot(grid.e2);
+		float p1 = d.Dot(grid.e1);
+		float p2 = d.Dot(grid.e2);
+		float det = d11 * d22 - d12 * d12;
+		float u = (d22 * p1 - d12 * p2) / det;
+		float v = (d11 * p2 - d12 * p1) / det;
+
+		// cell of the grid, clamped to the triangle
+		int n = static_cast<int>(grid.segments);
+		float x = u * n;
+		float y = v * n;
+		int a = std::min(std::max(static_cast<int>(std::floor(x)), 0), n - 1);
+		int b = std::min(std::max(static_cast<int>(std::floor(y)), 0), n - 1 - a);
+		bool upper = (a + b < n - 1) && ((x - a) + (y - b) > 1.0f);
+
+		// row k has 2 * (n - k) - 1 patches, so rows before the row have a * (2 * n - a)
+		size_t index = static_cast<size_t>(a * (2 * n - a) + 2 * b + (upper ? 1 : 0));
+		return grid.first + index;
+	}
+
+	void RadiositySolver::GetRadiance(size_t patch, SpectralPacket& radiance) const
+	{
+		const float* emission = &emission_[patch * spectrumCount_];
+		const float* radiosity = &radiosity_[patch * spectrumCount_];
+
+		// exitance of Lambertian surface is pi times its radiance
+		for (size_t t = 0; t < spectrumCount_; t++)
+		{
+			radiance[t] = (radiosity[t] - emission[t]) / Util::Pi;
+		}
+	}
+
+}
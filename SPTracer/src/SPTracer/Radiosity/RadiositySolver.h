@@ -0,0 +1,110 @@
+#ifndef SPT_RADIOSITY_SOLVER_H
+#define SPT_RADIOSITY_SOLVER_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "../Material/MaterialId.h"
+#include "../Task/PhaseWork.h"
+
+namespace SPTracer
+{
+	struct Intersection;
+	struct Ray;
+	class Primitive;
+	class Sampler;
+	class Scene;
+	class SpectralPacket;
+
+	// Finite element radiosity of planar meshes. Every triangle is split into
+	// a regular grid of triangular patches no larger than patch size. Form
+	// factors are estimated by casting cosine distributed rays from patches,
+	// and radiosity is found by Jacobi iterations. Form factor rows and
+	// iterations are computed by tasks sharing the work of the phase, one
+	// patch per item. Surfaces other than planar meshes only block light.
+	class RadiositySolver
+	{
+	public:
+		// index of missing patch
+		static const size_t NoPatch;
+
+		RadiositySolver(const Scene& scene, size_t spectrumCount, unsigned int taskCount,
+			float patchSize, unsigned int rayCount, unsigned int iterationCount);
+
+		size_t patchCount() const;
+
+		// completed iterations
+		unsigned int iteration() const;
+		unsigned int iterationCount() const;
+
+		// work of the current phase
+		PhaseWork& work();
+
+		// estimates form factors from patch to all patches
+		void ComputeFormFactors(size_t patch, Sampler& sampler);
+
+		// computes radiosity of patch for the next iteration
+		void Iterate(size_t patch);
+
+		// makes radiosity of the next iteration current, after all patches are iterated
+		void CompleteIteration();
+
+		// patch containing intersection point, NoPatch if the surface has no patches
+		// or the ray arrives from its back side, patches are one-sided
+		size_t FindPatch(const Ray& ray, const Intersection& intersection) const;
+
+		// radiance reflected by patch, emission is not included
+		void GetRadiance(size_t patch, SpectralPacket& radiance) const;
+
+	private:
+		// patch covering one cell of triangle grid
+		struct Patch
+		{
+			Vec3 origin;
+			Vec3 e1;
+			Vec3 e2;
+			Vec3 normal;
+		};
+
+		// grid of patches made from triangle
+		struct PatchGrid
+		{
+			size_t first;		// index of the first patch
+			size_t segments;	// cells along triangle edge
+			Vec3 origin;
+			Vec3 e1;
+			Vec3 e2;
+		};
+
+		struct FormFactor
+		{
+			std::uint32_t patch;
+			float value;
+		};
+
+		const Scene& scene_;
+		const size_t spectrumCount_;
+		const unsigned int rayCount_;
+		const unsigned int iterationCount_;
+		unsigned int iteration_ = 0;
+		PhaseWork work_;
+		std::vector<Patch> patches_;
+		std::unordered_map<const Primitive*, PatchGrid> grids_;
+		std::vector<std::vector<FormFactor>> formFactors_;
+
+		// spectral values of all patches, spectrum count per patch
+		std::vector<float> emission_;		// radiant exitance of emitted light
+		std::vector<float> reflectance_;	// diffuse reflectance
+		std::vector<float> radiosity_;		// radiant exitance of the current iteration
+		std::vector<float> nextRadiosity_;	// radiant exitance of the next iteration
+
+		// patch whose grid cell contains intersection point, NoPatch if the surface has no patches
+		size_t FindCell(const Intersection& intersection) const;
+
+		// adds patches of triangle grid with the material
+		void AddPatches(const Primitive& primitive, const Vec3& origin, const Vec3& e1, const Vec3& e2, const Vec3& normal,
+			size_t segments, MaterialId material);
+	};
+
+}
+
+#endif
@@ -0,0 +1,28 @@
+#include "../stdafx.h"
+#include "PixelReservoirs.h"
+
+namespace SPTracer
+{
+
+	PixelReservoirs::PixelReservoirs(size_t pixelCount)
+		: initial_(pixelCount), shaded_(pixelCount)
+	{
+		// nothing is reused in the first pass
+		for (Pixel& p : shaded_)
+		{
+			p.valid = false;
+			p.reservoir.Reset();
+		}
+	}
+
+	PixelReservoirs::Pixel& PixelReservoirs::initial(size_t pixel)
+	{
+		return initial_[pixel];
+	}
+
+	PixelReservoirs::Pixel& PixelReservoirs::shaded(size_t pixel)
+	{
+		return shaded_[pixel];
+	}
+
+}
@@ -0,0 +1,45 @@
+#ifndef SPT_PIXEL_RESERVOIRS_H
+#define SPT_PIXEL_RESERVOIRS_H
+
+#include "../stdafx.h"
+#include "../Material/MaterialId.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/Ray.h"
+#include "Reservoir.h"
+
+namespace SPTracer
+{
+
+	// State of reservoir resampling of direct light. Every pass has two
+	// phases: first visible surface of every pixel gets reservoir of light
+	// sample candidates, merged with the reservoir of the previous pass, then
+	// reservoirs of neighbouring pixels are merged and the selected sample is
+	// shaded.
+	class PixelReservoirs
+	{
+	public:
+		// first visible surface of pixel and reservoir of light samples for it
+		struct Pixel
+		{
+			Ray ray;
+			Intersection intersection;
+			MaterialId material;
+			bool valid;
+			Reservoir reservoir;
+		};
+
+		explicit PixelReservoirs(size_t pixelCount);
+
+		// reservoirs of candidates and temporal reuse in the current pass
+		Pixel& initial(size_t pixel);
+
+		// reservoirs after spatial reuse, which are shaded and kept for the next pass
+		Pixel& shaded(size_t pixel);
+	private:
+		std::vector<Pixel> initial_;
+		std::vector<Pixel> shaded_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,39 @@
+#include "../stdafx.h"
+#include "Reservoir.h"
+
+namespace SPTracer
+{
+
+	void Reservoir::Reset()
+	{
+		sample.primitive = nullptr;
+		target = 0.0f;
+		weightSum = 0.0f;
+		count = 0.0f;
+		weight = 0.0f;
+	}
+
+	bool Reservoir::Update(const LightSample& candidate, float candidateTarget, float resamplingWeight, float u)
+	{
+		if (resamplingWeight <= 0.0f)
+		{
+			return false;
+		}
+
+		weightSum += resamplingWeight;
+		if (u * weightSum >= resamplingWeight)
+		{
+			return false;
+		}
+
+		sample = candidate;
+		target = candidateTarget;
+		return true;
+	}
+
+	void Reservoir::Finalize(float normalization)
+	{
+		weight = (target > 0.0f) && (normalization > 0.0f) ? weightSum / (target * normalization) : 0.0f;
+	}
+
+}
@@ -0,0 +1,36 @@
+#ifndef SPT_RESERVOIR_H
+#define SPT_RESERVOIR_H
+
+#include "../stdafx.h"
+#include "../Light/LightSample.h"
+
+namespace SPTracer
+{
+
+	// Weighted reservoir holding one light sample selected from a stream of
+	// candidates. Candidate is kept with probability of its resampling weight
+	// relative to the sum of all weights. Contribution weight of the kept
+	// sample is set when the stream ends.
+	struct Reservoir
+	{
+		LightSample sample;
+		float target;		// target function of the sample
+		float weightSum;	// sum of resampling weights of all candidates
+		float count;		// number of candidates (M)
+		float weight;		// unbiased contribution weight of the sample (W)
+
+		// empty reservoir
+		void Reset();
+
+		// streams candidate with its target function and resampling weight,
+		// u is uniform value in [0, 1), returns true if candidate is kept
+		bool Update(const LightSample& candidate, float candidateTarget, float resamplingWeight, float u);
+
+		// sets contribution weight of the sample, normalized by count of candidates
+		// which could have produced the sample
+		void Finalize(float normalization);
+	};
+
+}
+
+#endif
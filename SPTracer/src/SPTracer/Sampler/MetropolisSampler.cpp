@@ -0,0 +1,91 @@
+#include "../stdafx.h"
+#include "MetropolisSampler.h"
+
+namespace SPTracer
+{
+
+	MetropolisSampler::MetropolisSampler(unsigned int seed, float sigma, float largeStepProbability)
+		: generator_(seed), uniform_(0.0f, 1.0f), normal_(0.0f, 1.0f),
+		  sigma_(sigma), largeStepProbability_(largeStepProbability)
+	{
+	}
+
+	float MetropolisSampler::Get1D()
+	{
+		// value requested for the first time is a part of the state already
+		while (sampleIndex_ >= samples_.size())
+		{
+			PrimarySample sample;
+			sample.value = uniform_(generator_);
+			sample.lastModification = iteration_;
+			samples_.push_back(sample);
+		}
+
+		PrimarySample& sample = samples_[sampleIndex_++];
+		Mutate(sample);
+		return sample.value;
+	}
+
+	void MetropolisSampler::StartIteration()
+	{
+		iteration_++;
+		largeStep_ = uniform_(generator_) < largeStepProbability_;
+		sampleIndex_ = 0;
+	}
+
+	void MetropolisSampler::Accept()
+	{
+		if (largeStep_)
+		{
+			lastLargeStepIteration_ = iteration_;
+		}
+	}
+
+	void MetropolisSampler::Reject()
+	{
+		for (PrimarySample& sample : samples_)
+		{
+			if (sample.lastModification == iteration_)
+			{
+				sample.value = sample.valueBackup;
+				sample.lastModification = sample.modificationBackup;
+			}
+		}
+
+		iteration_--;
+	}
+
+	void MetropolisSampler::Mutate(PrimarySample& sample)
+	{
+		// value which was not requested since the last accepted large step is independent of the chain
+		if (sample.lastModification < lastLargeStepIteration_)
+		{
+			sample.value = uniform_(generator_);
+			sample.lastModification = lastLargeStepIteration_;
+		}
+
+		sample.valueBackup = sample.value;
+		sample.modificationBackup = sample.lastModification;
+
+		if (largeStep_)
+		{
+			sample.value = uniform_(generator_);
+		}
+		else
+		{
+			// small steps skipped by the value add up to one normal step with larger deviation
+			float steps = static_cast<float>(iteration_ - sample.lastModification);
+			sample.value += normal_(generator_) * sigma_ * std::sqrt(steps);
+
+			// wrap around, so that the distribution stays uniform
+			sample.value -= std::floor(sample.value);
+			if (sample.value >= 1.0f)
+			{
+				sample.value = 0.0f;
+			}
+		}
+
+		sample.lastModification = iteration_;
+	}
+
+}
@@ -0,0 +1,54 @@
+#ifndef SPT_METROPOLIS_SAMPLER_H
+#define SPT_METROPOLIS_SAMPLER_H
+
+#include "../stdafx.h"
+#include "Sampler.h"
+
+namespace SPTracer
+{
+
+	// Sample values of a Markov chain in primary sample space. Every iteration
+	// either replaces all values (large step) or perturbs them slightly (small
+	// step). Values are mutated lazily, when they are requested, so paths may
+	// use any number of them. Rejected iteration restores previous values.
+	class MetropolisSampler : public Sampler
+	{
+	public:
+		MetropolisSampler(unsigned int seed, float sigma, float largeStepProbability);
+
+		virtual float Get1D() override;
+
+		// starts mutation, sample values are requested from the first dimension again
+		void StartIteration();
+
+		// keeps or reverts values of the current iteration
+		void Accept();
+		void Reject();
+
+	private:
+		struct PrimarySample
+		{
+			float value = 0.0f;
+			unsigned long long lastModification = 0;	// iteration which changed the value
+			float valueBackup = 0.0f;
+			unsigned long long modificationBackup = 0;
+		};
+
+		std::mt19937 generator_;
+		std::uniform_real_distribution<float> uniform_;
+		std::normal_distribution<float> normal_;
+		const float sigma_;
+		const float largeStepProbability_;
+		std::vector<PrimarySample> samples_;
+		unsigned long long iteration_ = 0;
+		unsigned long long lastLargeStepIteration_ = 0;
+		bool largeStep_ = true;		// the first values are independent
+		size_t sampleIndex_ = 0;
+
+		// applies mutations skipped since the value was last requested
+		void Mutate(PrimarySample& sample);
+	};
+
+}
+
+#endif
@@ -0,0 +1,17 @@
+#include "../stdafx.h"
+#include "RandomSampler.h"
+
+namespace SPTracer
+{
+
+	RandomSampler::RandomSampler(unsigned int seed)
+		: generator_(seed), distribution_(0.0f, 1.0f)
+	{
+	}
+
+	float RandomSampler::Get1D()
+	{
+		return distribution_(generator_);
+	}
+
+}
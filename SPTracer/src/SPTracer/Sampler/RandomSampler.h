@@ -0,0 +1,25 @@
+#ifndef SPT_RANDOM_SAMPLER_H
+#define SPT_RANDOM_SAMPLER_H
+
+#include "../stdafx.h"
+#include "Sampler.h"
+
+namespace SPTracer
+{
+
+	// independent uniform samples
+	class RandomSampler : public Sampler
+	{
+	public:
+		explicit RandomSampler(unsigned int seed);
+
+		virtual float Get1D() override;
+
+	private:
+		std::mt19937 generator_;
+		std::uniform_real_distribution<float> distribution_;
+	};
+
+}
+
+#endif
@@ -0,0 +1,17 @@
+#include "../stdafx.h"
+#include "Sampler.h"
+
+namespace SPTracer
+{
+
+	Sampler::~Sampler()
+	{
+	}
+
+	void Sampler::Get2D(float& u, float& v)
+	{
+		u = Get1D();
+		v = Get1D();
+	}
+
+}
@@ -0,0 +1,24 @@
+#ifndef SPT_SAMPLER_H
+#define SPT_SAMPLER_H
+
+#include "../stdafx.h"
+
+namespace SPTracer
+{
+
+	// Source of sample values in [0, 1) used for all random decisions of a path.
+	class Sampler
+	{
+	public:
+		virtual ~Sampler();
+
+		// next sample dimension
+		virtual float Get1D() = 0;
+
+		// next two sample dimensions
+		virtual void Get2D(float& u, float& v);
+	};
+
+}
+
+#endif
@@ -1,6 +1,9 @@
 #include "../stdafx.h"
+#include "../Exception.h"
 #include "../Util.h"
 #include "../Primitive/Primitive.h"
+#include "../Tracer/Hit.h"
+#include "../Tracer/Ray.h"
 #include "KdTree.h"
 #include "KdTreeNode.h"
 #include "SplitEvent.h"
@@ -16,7 +19,7 @@ namespace SPTracer
 	{
 		// get the bounding box for scene
 		Vec3 min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
-		Vec3 max(std::numeric_limits<float>::min(), std::numeric_limits<float>::min(), std::numeric_limits<float>::min());
+		Vec3 max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
 
 		for (const auto& p : primitives)
 		{
@@ -52,6 +55,253 @@ namespace SPTracer
 		return *rootNode_;
 	}
 
+	bool KdTree::Intersect(const Ray& ray, Hit& hit) const
+	{
+		// ray inverted direction
+		const Vec3 invDirection = 1 / ray.direction;
+
+		// find the first box that ray intersects
+		float tnear, tfar;
+		const KdTreeNode* node = FindFirstIntersection(ray, invDirection, tnear, tfar);
+		if (!node)
+		{
+			// no intersection with scene
+			return false;
+		}
+
+		// set initial intersection distance to max possible,
+		// so that any intersection will be closer than that
+		hit.distance = std::numeric_limits<float>::max();
+
+		Hit newHit;
+
+		// find intersection with primitive
+		while (true)
+		{
+			// find intersections with primitives in the node
+			for (const auto& p : node->primitives())
+			{
+				// find new intersection, only distance and
+				// barycentric coordinates are computed here
+				bool success = p->Intersect(ray, newHit);
+
+				// check if new intersection is closer
+				if (success && (newHit.distance < hit.distance) && (newHit.distance <= tfar))
+				{
+					hit = newHit;
+				}
+			}
+
+			// check if intersection was found
+			if (hit.distance < std::numeric_limits<float>::max())
+			{
+				return true;
+			}
+
+			// Intersection was not found,
+			// get the node where ray travels next.
+			node = FindNextIntersection(node, ray, invDirection, tnear, tfar);
+			if (node == nullptr)
+			{
+				// no next node - no intersection
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	bool KdTree::Occluded(const Ray& ray, float maxDistance) const
+	{
+		// ray inverted direction
+		const Vec3 invDirection = 1 / ray.direction;
+
+		// find the first box that ray intersects
+		float tnear, tfar;
+		const KdTreeNode* node = FindFirstIntersection(ray, invDirection, tnear, tfar);
+
+		Hit hit;
+
+		// stop at any intersection before max distance
+		while ((node != nullptr) && (tnear < maxDistance))
+		{
+			for (const auto& p : node->primitives())
+			{
+				if (p->Intersect(ray, hit) && (hit.distance < maxDistance))
+				{
+					return true;
+				}
+			}
+
+			node = FindNextIntersection(node, ray, invDirection, tnear, tfar);
+		}
+
+		return false;
+	}
+
+	const KdTreeNode* KdTree::FindFirstIntersection(const Ray& ray, const Vec3& invDirection, float& tnear, float& tfar) const
+	{
+		// start with root node
+		const KdTreeNode* node = rootNode_.get();
+
+		// check if ray intersects the scene
+		if (!node->box().Intersect(ray, invDirection, tnear, tfar))
+		{
+			return nullptr;
+		}
+
+		// find the first box that ray intersects
+		while (true)
+		{
+			// check if node is leaf
+			if (node->isLeaf())
+			{
+				// the smallest first box interseced by the ray is found
+				return node;
+			}
+
+			// test intersection with left sub-box
+			float tnearLeft, tfarLeft;
+			bool left = node->left().box().Intersect(ray, invDirection, tnearLeft, tfarLeft);
+
+			// test intersection with right sub-box
+			float tnearRight, tfarRight;
+			bool right = node->right().box().Intersect(ray, invDirection, tnearRight, tfarRight);
+
+			// check what sub-boxes were intersected
+			if (left && right)
+			{
+				// both sub-boxes were intersected
+				if (std::abs(tnearLeft - tnearRight) < Util::Eps)
+				{
+					// special case when ray hits exactly between the sub-boxes
+					// choose the sub-box in which far intersection point is further
+					if (tfarLeft > tfarRight)
+					{
+						// select left sub-box
+						right = false;
+					}
+					else
+					{
+						// select right sub-box
+						left = false;
+					}
+				}
+				else if (tnearLeft < tnearRight)
+				{
+					// select left sub-box
+					right = false;
+				}
+				else
+				{
+					// select right sub-box
+					left = false;
+				}
+			}
+			
+			if (left)
+			{
+				// select left sub-box
+				node = &node->left();
+				tnear = tnearLeft;
+				tfar = tfarLeft;
+			}
+			else
+			{
+				// select right sub-box
+				node = &node->right();
+				tnear = tnearRight;
+				tfar = tfarRight;
+			}
+		}
+
+		// should never get here
+		throw Exception("Somehow escaped infinite loop in KdTree::FindFirstIntersection");
+	}
+
+	const KdTreeNode* KdTree::FindNextIntersection(const KdTreeNode* node, const Ray& ray, const Vec3& invDirection, float& tnear, float& tfar) const
+	{
+		// get the far point of intersection
+		Vec3 far = ray.origin + tfar * ray.direction;
+
+		// store original tfar to avoid infinite loop between two neighbours
+		float tfarOriginal = tfar;
+
+		// set initial value for tnear equal to tfar
+		tnear = tfar;
+
+		// next node
+		KdTreeNode* nextNode = nullptr;
+
+		// check all dimensions
+		for (int i = 0; i < 3; ++i)
+		{
+			int face = -1;
+			if (std::abs(far[i] - node->box().min()[i]) < Util::Eps)
+			{
+				// left plane in the current dimension
+				face = i * 2;
+			}
+			else if (std::abs(far[i] - node->box().max()[i]) < Util::Eps)
+			{
+				// right plane in the current dimension
+				face = i * 2 + 1;
+			}
+
+			if (face == -1)
+			{
+				// no faces
+				continue;
+			}
+
+			// check if intersection point lies on any of the neighbour cells
+			for (const auto& n : node->neighbours()[face])
+			{
+				bool found = true;
+				for (int j = 0; j < 3; ++j)
+				{
+					// skip current dimension
+					if (i == j)
+					{
+						continue;
+					}
+
+					if ((far[j] < node->box().min()[j]) || (far[j] > node->box().max()[j]))
+					{
+						found = false;
+						break;
+					}
+				}
+
+				// check if neighbour was found
+				if (found)
+				{
+					// intersect ray with neigbour
+					float tnearCandidate, tfarCandidate;
+					if (!n->box().Intersect(ray, invDirection, tnearCandidate, tfarCandidate))
+					{
+						// some mistake, no intersection
+						continue;
+					}
+
+					// the first check is needed to select the right neighbour if ray hits
+					// exactly in between two neighbours
+					// the second check is needed to ensure that the selected neighbour near
+					// intersection matches the original box far intersection
+					if (((tfarCandidate - tnearCandidate) > (tfar - tnear)) && (std::abs(tnearCandidate - tfarOriginal) < Util::Eps))
+					{
+						// store found neighbour
+						nextNode = n.get();
+						tnear = tnearCandidate;
+						tfar = tfarCandidate;
+					}
+				}
+			}
+		}
+
+		return nextNode;
+	}
+
 	std::shared_ptr<KdTreeNode> KdTree::Build(Box box, std::vector<std::shared_ptr<Primitive>> primitives)
 	{
 		// return node if there are no primitives
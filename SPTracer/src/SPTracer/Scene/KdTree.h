@@ -5,8 +5,11 @@
 
 namespace SPTracer
 {
+	struct Hit;
+	struct Ray;
 	struct SplitPlane;
 	class Box;
+	class Vec3;
 	class KdTreeNode;
 	class Primitive;
 	class Scene;
@@ -18,6 +21,8 @@ namespace SPTracer
 		virtual ~KdTree();
 
 		const KdTreeNode& rootNode() const;
+		bool Intersect(const Ray& ray, Hit& hit) const;
+		bool Occluded(const Ray& ray, float maxDistance) const;
 
 	private:
 		struct Event
@@ -53,6 +58,10 @@ namespace SPTracer
 
 		// find indirect neighbours of node
 		void FindIndirectNeighbours(KdTreeNode& node, std::shared_ptr<KdTreeNode> searchNode, unsigned char face);
+
+		// traversal
+		const KdTreeNode* FindFirstIntersection(const Ray& ray, const Vec3& invDirection, float& tnear, float& tfar) const;
+		const KdTreeNode* FindNextIntersection(const KdTreeNode* node, const Ray& ray, const Vec3& invDirection, float& tnear, float& tfar) const;
 	};
 
 }
@@ -1,6 +1,7 @@
 #include "../stdafx.h"
 #include "../Exception.h"
 #include "../Log.h"
+#include "../Camera/Camera.h"
 #include "../Color/ScalarColor.h"
 #include "../Color/SpectralColor.h"
 #include "../Color/Spectrum.h"
@@ -8,7 +9,6 @@
 #include "../Material/PhongLuminaireMaterial.h"
 #include "../Primitive/Triangle.h"
 #include "../Primitive/Vertex.h"
-#include "Camera.h"
 #include "MDLAModel.h"
 #include "Scene.h"
 
@@ -645,6 +645,7 @@ namespace SPTracer
 			// new triangle
 			auto t = std::make_shared<Triangle>(material, v1, v2, v3);
 			t->ComputeNormals();
+			scene_->planarTriangles_.push_back(t);
 			scene_->primitives_.push_back(std::move(t));
 		}
 	}
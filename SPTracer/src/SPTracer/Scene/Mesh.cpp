@@ -0,0 +1,60 @@
+#include "../stdafx.h"
+#include "../Exception.h"
+#include "../Log.h"
+#include "../Primitive/Primitive.h"
+#include "KdTree.h"
+#include "KdTreeNode.h"
+#include "Mesh.h"
+
+namespace SPTracer
+{
+
+	Mesh::Mesh(std::vector<std::shared_ptr<Primitive>> primitives)
+		: primitives_(std::move(primitives))
+	{
+		// check mesh
+		if (primitives_.size() == 0)
+		{
+			std::string s = "Mesh: Mesh has no primitives";
+			Log::Error(s);
+			throw Exception(s);
+		}
+
+		// build kd-Tree in object space, primitives are kept
+		// to assign material ids when the scene is built
+		kdTree_ = std::make_unique<KdTree>(primitives_);
+	}
+
+	Mesh::~Mesh()
+	{
+	}
+
+	const Box& Mesh::box() const
+	{
+		return kdTree_->rootNode().box();
+	}
+
+	size_t Mesh::primitivesCount() const
+	{
+		return primitives_.size();
+	}
+
+	const std::vector<std::shared_ptr<Primitive>>& Mesh::primitives() const
+	{
+		return primitives_;
+	}
+
+	bool Mesh::Intersect(const Ray& ray, Hit& hit) const
+	{
+		return kdTree_->Intersect(ray, hit);
+	}
+
+	void Mesh::RegisterMaterials(MaterialTable& materialTable)
+	{
+		for (auto& p : primitives_)
+		{
+			p->RegisterMaterials(materialTable);
+		}
+	}
+
+}
@@ -0,0 +1,38 @@
+#ifndef SPT_MESH_H
+#define SPT_MESH_H
+
+#include "../stdafx.h"
+#include "../Primitive/Box.h"
+
+namespace SPTracer
+{
+	struct Hit;
+	struct Ray;
+	class KdTree;
+	class MaterialTable;
+	class Primitive;
+
+	// Geometry that is shared between instances. Mesh is stored
+	// in object space and has its own kd-Tree.
+	class Mesh
+	{
+	public:
+		explicit Mesh(std::vector<std::shared_ptr<Primitive>> primitives);
+		virtual ~Mesh();
+
+		const Box& box() const;
+		size_t primitivesCount() const;
+		const std::vector<std::shared_ptr<Primitive>>& primitives() const;
+		bool Intersect(const Ray& ray, Hit& hit) const;
+
+		// adds materials of all primitives to material table
+		void RegisterMaterials(MaterialTable& materialTable);
+
+	private:
+		std::vector<std::shared_ptr<Primitive>> primitives_;
+		std::unique_ptr<KdTree> kdTree_;
+	};
+
+}
+
+#endif
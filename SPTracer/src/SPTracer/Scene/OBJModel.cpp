@@ -8,8 +8,11 @@
 #include "../Material/LambertianMaterial.h"
 #include "../Material/PhongMaterial.h"
 #include "../Material/PhongLuminaireMaterial.h"
+#include "../Primitive/Box.h"
+#include "../Primitive/QuantizedTriangle.h"
 #include "../Primitive/Triangle.h"
 #include "../Primitive/Vertex.h"
+#include "Mesh.h"
 #include "OBJModel.h"
 #include "Scene.h"
 
@@ -18,13 +21,13 @@ namespace SPTracer
 
 	std::unique_ptr<Scene> OBJModel::scene_;
 
-	std::unique_ptr<Scene> OBJModel::Load(std::string fileName, const Spectrum& spectrum)
+	std::unique_ptr<Scene> OBJModel::Load(std::string fileName, const Spectrum& spectrum, bool quantizePositions)
 	{
 		scene_ = std::make_unique<Scene>();
 
 		try
 		{
-			ParseModelFile(fileName, spectrum);
+			ParseModelFile(fileName, spectrum, quantizePositions);
 		}
 		catch (Exception e)
 		{
@@ -36,6 +39,24 @@ namespace SPTracer
 		return std::move(scene_);
 	}
 
+	std::shared_ptr<Mesh> OBJModel::LoadMesh(std::string fileName, const Spectrum& spectrum, bool quantizePositions)
+	{
+		// load model as a scene and keep only its primitives,
+		// materials are owned by the primitives
+		std::unique_ptr<Scene> scene = Load(fileName, spectrum, quantizePositions);
+
+		try
+		{
+			return std::make_shared<Mesh>(std::move(scene->primitives_));
+		}
+		catch (Exception e)
+		{
+			std::string msg = "OBJModel: " + fileName + ": " + std::string(e.what());
+			Log::Error(msg);
+			throw Exception(msg);
+		}
+	}
+
 	void OBJModel::GetKeywordAndValue(std::string line, std::string& keyword, std::string& value)
 	{
 		keyword = "";
@@ -82,7 +103,7 @@ namespace SPTracer
 		}
 	}
 
-	void OBJModel::ParseModelFile(const std::string& fileName, const Spectrum& spectrum)
+	void OBJModel::ParseModelFile(const std::string& fileName, const Spectrum& spectrum, bool quantizePositions)
 	{
 		// open file
 		std::ifstream file(fileName);
@@ -103,6 +124,9 @@ namespace SPTracer
 		std::vector<std::shared_ptr<Triangle>> triangles;
 		std::shared_ptr<Material> material;
 
+		// material groups of the file
+		std::vector<TriangleGroup> groups;
+
 		bool computeNormals = true;
 
 		// read model file
@@ -172,7 +196,7 @@ namespace SPTracer
 				// store old object
 				if (saveObject)
 				{
-					AddTriangles(std::move(triangles), computeNormals);
+					AddTriangles(std::move(triangles), material, computeNormals, groups);
 				}
 
 				// reset object data
@@ -263,7 +287,10 @@ namespace SPTracer
 		}
 
 		// add last object
-		AddTriangles(std::move(triangles), computeNormals);
+		AddTriangles(std::move(triangles), material, computeNormals, groups);
+
+		// groups share vertices, so they are quantized together
+		AddPrimitives(std::move(groups), quantizePositions);
 	}
 
 	void OBJModel::ParseMaterialsLibFile(const std::string& fileName, const Spectrum & spectrum)
@@ -380,16 +407,60 @@ namespace SPTracer
 		}
 	}
 
-	void OBJModel::AddTriangles(std::vector<std::shared_ptr<Triangle>> triangles, bool computeNormals)
+	void OBJModel::AddTriangles(std::vector<std::shared_ptr<Triangle>> triangles, std::shared_ptr<Material> material, bool computeNormals, std::vector<TriangleGroup>& groups)
 	{
-		for (auto& t : triangles)
+		if (computeNormals)
 		{
-			if (computeNormals)
+			for (auto& t : triangles)
 			{
 				t->ComputeNormals();
 			}
+		}
+
+		groups.push_back({ std::move(material), std::move(triangles) });
+	}
+
+	void OBJModel::AddPrimitives(std::vector<TriangleGroup> groups, bool quantizePositions)
+	{
+		if (!quantizePositions)
+		{
+			for (auto& group : groups)
+			{
+				for (auto& t : group.triangles)
+				{
+					scene_->primitives_.push_back(std::move(t));
+				}
+			}
 
-			scene_->primitives_.push_back(std::move(t));
+			return;
+		}
+
+		// one box for the whole file, so that vertex shared by
+		// material groups is restored to the same position
+		const float inf = std::numeric_limits<float>::max();
+		Vec3 min(inf, inf, inf);
+		Vec3 max(-inf, -inf, -inf);
+		for (const auto& group : groups)
+		{
+			for (const auto& t : group.triangles)
+			{
+				const Box box = t->GetBox();
+				for (size_t i = 0; i < 3; i++)
+				{
+					min[i] = std::min(min[i], box.min()[i]);
+					max[i] = std::max(max[i], box.max()[i]);
+				}
+			}
+		}
+
+		auto bounds = std::make_shared<const Box>(std::move(min), std::move(max));
+
+		for (const auto& group : groups)
+		{
+			for (const auto& t : group.triangles)
+			{
+				scene_->primitives_.push_back(std::make_shared<QuantizedTriangle>(group.material, bounds, *t));
+			}
 		}
 	}
 
@@ -5,25 +5,36 @@
 
 namespace SPTracer
 {
+	class Material;
 	class Triangle;
 	struct Spectrum;
 	class Color;
+	class Mesh;
 	class Scene;
 
 	class OBJModel
 	{
 	public:
-		static std::unique_ptr<Scene> Load(std::string fileName, const Spectrum& spectrum);
+		static std::unique_ptr<Scene> Load(std::string fileName, const Spectrum& spectrum, bool quantizePositions = false);
+		static std::shared_ptr<Mesh> LoadMesh(std::string fileName, const Spectrum& spectrum, bool quantizePositions = false);
 
 	private:
+		// triangles of one material group, kept until the whole file is read
+		struct TriangleGroup
+		{
+			std::shared_ptr<Material> material;
+			std::vector<std::shared_ptr<Triangle>> triangles;
+		};
+
 		static std::unique_ptr<Scene> scene_;
 
 		OBJModel();
 
 		static void GetKeywordAndValue(std::string line, std::string& keyword, std::string& value);
-		static void ParseModelFile(const std::string& fileName, const Spectrum& spectrum);
+		static void ParseModelFile(const std::string& fileName, const Spectrum& spectrum, bool quantizePositions);
 		static void ParseMaterialsLibFile(const std::string& fileName, const Spectrum& spectrum);
-		static void AddTriangles(std::vector<std::shared_ptr<Triangle>> triangles, bool computeNormals);
+		static void AddTriangles(std::vector<std::shared_ptr<Triangle>> triangles, std::shared_ptr<Material> material, bool computeNormals, std::vector<TriangleGroup>& groups);
+		static void AddPrimitives(std::vector<TriangleGroup> groups, bool quantizePositions);
 		static void AddMaterial(
 			std::string materialName,
 			std::unique_ptr<Color> diffuseReflectance,
@@ -1,11 +1,14 @@
 #include "../stdafx.h"
-#include "../Exception.h"
-#include "../Util.h"
-#include "../Primitive/Primitive.h"
+#include "../Light/EmitterTable.h"
+#include "../Light/EnvironmentLight.h"
+#include "../Material/MaterialTable.h"
+#include "../Primitive/Instance.h"
+#include "../Primitive/Triangle.h"
+#include "../Tracer/Hit.h"
 #include "../Tracer/Intersection.h"
-#include "../Tracer/Ray.h"
 #include "KDTree.h"
 #include "KDTreeNode.h"
+#include "Mesh.h"
 #include "Scene.h"
 
 namespace SPTracer
@@ -18,229 +21,80 @@ namespace SPTracer
 	{
 	}
 
-	void Scene::BuildKdTree()
+	void Scene::AddInstance(std::shared_ptr<Mesh> mesh, const Transform& transform)
 	{
-		// move primitives vector, because it will not be used in the future
-		kdTree_ = std::make_unique<KdTree>(std::move(primitives_));
+		// instance is a primitive of the top-level kd-Tree that refers to the mesh with its own kd-Tree
+		instances_.push_back(std::make_shared<Instance>(std::move(mesh), transform));
+		primitives_.push_back(instances_.back());
 	}
 
-	bool Scene::Intersect(const Ray& ray, Intersection& intersection) const
+	void Scene::SetEnvironment(std::unique_ptr<EnvironmentLight> environment)
 	{
-		// ray inverted direction
-		const Vec3 invDirection = 1 / ray.direction;
+		environment_ = std::move(environment);
+	}
 
-		// find the first box that ray intersects
-		float tnear, tfar;
-		const KdTreeNode* node = FindFirstIntersection(ray, invDirection, tnear, tfar);
-		if (!node)
+	void Scene::BuildKdTree()
+	{
+		// material ids of all primitives (including instanced meshes)
+		materialTable_ = std::make_unique<MaterialTable>();
+		for (auto& p : primitives_)
 		{
-			// no intersection with scene
-			return false;
+			p->RegisterMaterials(*materialTable_);
 		}
 
-		// set initial intersection distance to max possible,
-		// so that any intersection will be closer than that
-		intersection.distance = std::numeric_limits<float>::max();
-
-		Intersection newIntersection;
+		// emissive primitives for light sampling
+		emitters_ = std::make_unique<EmitterTable>(primitives_, instances_, *materialTable_);
 
-		// find intersection with primitive
-		while (true)
-		{
-			// find intersections with primitives in the node
-			for (const auto& p : node->primitives())
-			{
-				// find new intersection
-				bool success = p->Intersect(ray, newIntersection);
-
-				// check if new intersection is closer
-				if (success && (newIntersection.distance < intersection.distance) && (newIntersection.distance <= tfar))
-				{
-					intersection = newIntersection;
-					intersection.primitive = p.get();
-				}
-			}
-
-			// check if intersection was found
-			if (intersection.distance < std::numeric_limits<float>::max())
-			{
-				return true;
-			}
-
-			// Intersection was not found,
-			// get the node where ray travels next.
-			node = FindNextIntersection(node, ray, invDirection, tnear, tfar);
-			if (node == nullptr)
-			{
-				// no next node - no intersection
-				return false;
-			}
-		}
-
-		return false;
+		// move primitives vector, because it will not be used in the future
+		kdTree_ = std::make_unique<KdTree>(std::move(primitives_));
 	}
 
-	const KdTreeNode* Scene::FindFirstIntersection(const Ray& ray, const Vec3& invDirection, float& tnear, float& tfar) const
+	const Box& Scene::box() const
 	{
-		// start with root node
-		const KdTreeNode* node = &kdTree_->rootNode();
+		return kdTree_->rootNode().box();
+	}
 
-		// check if ray intersects the scene
-		if (!node->box().Intersect(ray, invDirection, tnear, tfar))
-		{
-			return nullptr;
-		}
+	const EmitterTable& Scene::emitters() const
+	{
+		return *emitters_;
+	}
 
-		// find the first box that ray intersects
-		while (true)
-		{
-			// check if node is leaf
-			if (node->isLeaf())
-			{
-				// the smallest first box interseced by the ray is found
-				return node;
-			}
-
-			// test intersection with left sub-box
-			float tnearLeft, tfarLeft;
-			bool left = node->left().box().Intersect(ray, invDirection, tnearLeft, tfarLeft);
-
-			// test intersection with right sub-box
-			float tnearRight, tfarRight;
-			bool right = node->right().box().Intersect(ray, invDirection, tnearRight, tfarRight);
-
-			// check what sub-boxes were intersected
-			if (left && right)
-			{
-				// both sub-boxes were intersected
-				if (std::abs(tnearLeft - tnearRight) < Util::Eps)
-				{
-					// special case when ray hits exactly between the sub-boxes
-					// choose the sub-box in which far intersection point is further
-					if (tfarLeft > tfarRight)
-					{
-						// select left sub-box
-						right = false;
-					}
-					else
-					{
-						// select right sub-box
-						left = false;
-					}
-				}
-				else if (tnearLeft < tnearRight)
-				{
-					// select left sub-box
-					right = false;
-				}
-				else
-				{
-					// select right sub-box
-					left = false;
-				}
-			}
-			
-			if (left)
-			{
-				// select left sub-box
-				node = &node->left();
-				tnear = tnearLeft;
-				tfar = tfarLeft;
-			}
-			else
-			{
-				// select right sub-box
-				node = &node->right();
-				tnear = tnearRight;
-				tfar = tfarRight;
-			}
-		}
+	const EnvironmentLight* Scene::environment() const
+	{
+		return environment_.get();
+	}
 
-		// should never get here
-		throw Exception("Somehow escaped infinite loop in Scene::FindFirstIntersection");
+	const MaterialTable& Scene::materialTable() const
+	{
+		return *materialTable_;
 	}
 
-	const KdTreeNode* Scene::FindNextIntersection(const KdTreeNode* node, const Ray& ray, const Vec3& invDirection, float& tnear, float& tfar) const
+	const std::vector<std::shared_ptr<Triangle>>& Scene::planarTriangles() const
 	{
-		// get the far point of intersection
-		Vec3 far = ray.origin + tfar * ray.direction;
+		return planarTriangles_;
+	}
 
-		// store original tfar to avoid infinite loop between two neighbours
-		float tfarOriginal = tfar;
+	bool Scene::Intersect(const Ray& ray, Intersection& intersection) const
+	{
+		// find the closest hit
+		Hit hit;
+		if (!kdTree_->Intersect(ray, hit))
+		{
+			return false;
+		}
 
-		// set initial value for tnear equal to tfar
-		tnear = tfar;
+		// fetch surface attributes only for the closest hit
+		hit.primitive->GetIntersection(ray, hit, intersection);
 
-		// next node
-		KdTreeNode* nextNode = nullptr;
+		// shading frame is built once and shared by sampling and evaluation
+		intersection.frame = Frame(intersection.normal);
 
-		// check all dimensions
-		for (int i = 0; i < 3; ++i)
-		{
-			int face = -1;
-			if (std::abs(far[i] - node->box().min()[i]) < Util::Eps)
-			{
-				// left plane in the current dimension
-				face = i * 2;
-			}
-			else if (std::abs(far[i] - node->box().max()[i]) < Util::Eps)
-			{
-				// right plane in the current dimension
-				face = i * 2 + 1;
-			}
-
-			if (face == -1)
-			{
-				// no faces
-				continue;
-			}
-
-			// check if intersection point lies on any of the neighbour cells
-			for (const auto& n : node->neighbours()[face])
-			{
-				bool found = true;
-				for (int j = 0; j < 3; ++j)
-				{
-					// skip current dimension
-					if (i == j)
-					{
-						continue;
-					}
-
-					if ((far[j] < node->box().min()[j]) || (far[j] > node->box().max()[j]))
-					{
-						found = false;
-						break;
-					}
-				}
-
-				// check if neighbour was found
-				if (found)
-				{
-					// intersect ray with neigbour
-					float tnearCandidate, tfarCandidate;
-					if (!n->box().Intersect(ray, invDirection, tnearCandidate, tfarCandidate))
-					{
-						// some mistake, no intersection
-						continue;
-					}
-
-					// the first check is needed to select the right neighbour if ray hits
-					// exactly in between two neighbours
-					// the second check is needed to ensure that the selected neighbour near
-					// intersection matches the original box far intersection
-					if (((tfarCandidate - tnearCandidate) > (tfar - tnear)) && (std::abs(tnearCandidate - tfarOriginal) < Util::Eps))
-					{
-						// store found neighbour
-						nextNode = n.get();
-						tnear = tnearCandidate;
-						tfar = tfarCandidate;
-					}
-				}
-			}
-		}
+		return true;
+	}
 
-		return nextNode;
+	bool Scene::Occluded(const Ray& ray, float maxDistance) const
+	{
+		return kdTree_->Occluded(ray, maxDistance);
 	}
 
 }
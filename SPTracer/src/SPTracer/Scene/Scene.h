@@ -8,10 +8,17 @@
 namespace SPTracer
 {
 	struct Intersection;
+	class Box;
+	class EmitterTable;
+	class EnvironmentLight;
+	class Instance;
 	struct Ray;
 	class KdTree;
-	class KdTreeNode;
+	class MaterialTable;
+	class Mesh;
 	class Primitive;
+	class Transform;
+	class Triangle;
 
 	class Scene
 	{
@@ -22,16 +29,39 @@ namespace SPTracer
 		Scene();
 		virtual ~Scene();
 
+		void AddInstance(std::shared_ptr<Mesh> mesh, const Transform& transform);
+		void SetEnvironment(std::unique_ptr<EnvironmentLight> environment);
 		void BuildKdTree();
 		bool Intersect(const Ray& ray, Intersection& intersection) const;
 
+		// checks if anything is hit closer than max distance (shadow rays)
+		bool Occluded(const Ray& ray, float maxDistance) const;
+
+		// bounding box of the scene, available after kd-Tree is built
+		const Box& box() const;
+
+		// emissive primitives, available after kd-Tree is built
+		const EmitterTable& emitters() const;
+
+		// light arriving from infinity along rays leaving the scene, nullptr if there is none
+		const EnvironmentLight* environment() const;
+
+		// flattened materials referenced by material ids of primitives,
+		// available after kd-Tree is built
+		const MaterialTable& materialTable() const;
+
+		// triangles of planar mesh objects, radiosity patches are made of them
+		const std::vector<std::shared_ptr<Triangle>>& planarTriangles() const;
+
 	private:
 		std::unordered_map<std::string, std::shared_ptr<Material>> materials_;
 		std::vector<std::shared_ptr<Primitive>> primitives_;
+		std::vector<std::shared_ptr<Instance>> instances_;
+		std::vector<std::shared_ptr<Triangle>> planarTriangles_;
 		std::unique_ptr<KdTree> kdTree_;
-
-		const KdTreeNode* FindFirstIntersection(const Ray& ray, const Vec3& invDirection, float& tnear, float& tfar) const;
-		const KdTreeNode* FindNextIntersection(const KdTreeNode* node, const Ray& ray, const Vec3& invDirection, float& tnear, float& tfar) const;
+		std::unique_ptr<EmitterTable> emitters_;
+		std::unique_ptr<EnvironmentLight> environment_;
+		std::unique_ptr<MaterialTable> materialTable_;
 	};
 
 }
@@ -0,0 +1,592 @@
+#include "../stdafx.h"
+#include "../Frame.h"
+#include "../Util.h"
+#include "../Camera/CameraModel.h"
+#include "../Color/SpectralPacket.h"
+#include "../Color/Spectrum.h"
+#include "../Color/WavelengthSampler.h"
+#include "../Color/XYZConverter.h"
+#include "../Light/EmitterTable.h"
+#include "../Light/LightSample.h"
+#include "../Material/MaterialTable.h"
+#include "../Scene/Scene.h"
+#include "../Primitive/Primitive.h"
+#include "../Sampler/RandomSampler.h"
+#include "../Tracer/PathStatistics.h"
+#include "../Tracer/Tracer.h"
+#include "TaskScheduler.h"
+#include "BidirectionalTask.h"
+
+namespace SPTracer
+{
+
+	BidirectionalTask::BidirectionalTask(Tracer& tracer)
+		: IntegratorTask(tracer)
+	{
+	}
+
+	void BidirectionalTask::Run()
+	{
+		// width and height
+		static const unsigned int width = tracer_.width_;
+		static const unsigned int height = tracer_.height_;
+
+		// spectrum
+		static const Spectrum& spectrum = tracer_.spectrum_;
+
+		// wave lengths per path, 0 for full spectrum
+		static const int heroWavelengths = static_cast<int>(std::min(tracer_.settings_.heroWavelengths, spectrum.count));
+
+		// path depth
+		static const int minDepth = static_cast<int>(tracer_.settings_.minDepth);
+		static const int maxDepth = static_cast<int>(tracer_.settings_.maxDepth);
+
+		static thread_local std::vector<Vec3> color(width * height);
+		static thread_local PathStatistics pathStatistics;
+
+		// subpaths
+		static thread_local std::vector<Vertex> cameraPath;
+		static thread_local std::vector<Vertex> lightPath;
+
+		// primary rays of one image row
+		static thread_local std::vector<Ray> cameraRays(width);
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		// reset all colors
+		std::for_each(color.begin(), color.end(), [](Vec3& c) { c.Reset(); });
+		pathStatistics.Reset();
+
+		for (size_t i = 0; i < height; i++)
+		{
+			// generate primary rays for the row
+			GenerateCameraRays(i, sampler, cameraRays);
+
+			for (size_t j = 0; j < width; j++)
+			{
+				// spawn new ray
+				Ray ray = cameraRays[j];
+
+				// originally ray contains all spectrum or hero packet with random first wave length,
+				// light subpath carries the same wave lengths
+				ray.heroIndex = tracer_.wavelengthSampler_->Sample(sampler.Get1D());
+				ray.waveCount = heroWavelengths;
+
+				size_t cameraVertices = TraceCameraPath(ray, sampler, cameraPath);
+				size_t lightVertices = TraceLightPath(ray, sampler, lightPath);
+
+				// every strategy with s light and t camera vertices, the camera
+				// can not be hit and light seen directly is found by camera path
+				for (size_t t = 1; t <= cameraVertices; t++)
+				{
+					for (size_t s = 0; s <= lightVertices; s++)
+					{
+						int depth = static_cast<int>(s + t) - 2;
+						if ((depth < 0) || (depth < minDepth) || ((maxDepth != 0) && (depth > maxDepth)) || ((s == 1) && (t == 1)))
+						{
+							continue;
+						}
+
+						Connect(lightPath, cameraPath, s, t, sampler, color, i * width + j);
+					}
+				}
+
+				pathStatistics.Add(cameraVertices - 1);
+			}
+		}
+
+		// add another task
+		tracer_.taskScheduler_->AddTask(std::make_unique<BidirectionalTask>(tracer_));
+
+		// add samples
+		tracer_.AddSamples(color, pathStatistics);
+	}
+
+	BidirectionalTask::Vertex& BidirectionalTask::GetVertex(std::vector<Vertex>& path, size_t index) const
+	{
+		while (path.size() <= index)
+		{
+			path.emplace_back(tracer_.spectrum_.count);
+		}
+
+		return path[index];
+	}
+
+	size_t BidirectionalTask::TraceCameraPath(const Ray& ray, Sampler& sampler, std::vector<Vertex>& path) const
+	{
+		static const CameraModel& camera = *tracer_.cameraModel_;
+		static const size_t maxDepth = tracer_.settings_.maxDepth;
+		static thread_local SpectralPacket beta(tracer_.spectrum_.count);
+
+		Vertex& vertex = GetVertex(path, 0);
+		vertex.type = VertexType::Camera;
+		vertex.intersection.point = ray.origin;
+		vertex.intersection.normal = ray.direction;
+		vertex.intersection.primitive = nullptr;
+		vertex.ray = ray;
+		vertex.pdfForward = 1.0f;
+		vertex.pdfReverse = 0.0f;
+		ray.ForEachWave(tracer_.spectrum_.count, [&](size_t t) { vertex.beta[t] = 1.0f; });
+
+		// direction is sampled proportionally to camera importance, so the weight is one,
+		// the camera and maximum depth surface vertices
+		ray.ForEachWave(tracer_.spectrum_.count, [&](size_t t) { beta[t] = 1.0f; });
+		size_t maxVertices = maxDepth != 0 ? maxDepth + 2 : 0;
+		return RandomWalk(ray, sampler, beta, camera.GetDirectionPdf(ray.direction), maxVertices, false, path);
+	}
+
+	size_t BidirectionalTask::TraceLightPath(const Ray& cameraRay, Sampler& sampler, std::vector<Vertex>& path) const
+	{
+		static const EmitterTable& emitters = tracer_.scene_->emitters();
+		static const MaterialTable& materials = tracer_.scene_->materialTable();
+		static const size_t maxDepth = tracer_.settings_.maxDepth;
+		static thread_local SpectralPacket beta(tracer_.spectrum_.count);
+
+		if (emitters.empty())
+		{
+			return 0;
+		}
+
+		// point on lights
+		LightSample light;
+		emitters.SampleEmission(sampler, light);
+
+		Vertex& vertex = GetVertex(path, 0);
+		vertex.type = VertexType::Light;
+		vertex.intersection.point = light.point;
+		vertex.intersection.normal = light.normal;
+		vertex.intersection.frame = Frame(light.normal);
+		vertex.intersection.distance = 0.0f;
+		vertex.intersection.primitive = light.primitive;
+		vertex.material = light.primitive->materialId();
+		vertex.ray = cameraRay;
+		vertex.pdfForward = light.pdf;
+		vertex.pdfReverse = 0.0f;
+		cameraRay.ForEachWave(tracer_.spectrum_.count, [&](size_t t) { vertex.beta[t] = 1.0f / light.pdf; });
+
+		// direction of emitted light
+		Ray ray = cameraRay;
+		ray.origin = light.point;
+		ray.direction = materials.SampleEmission(vertex.material, vertex.intersection, sampler);
+
+		float pdf = materials.GetEmissionPdf(vertex.material, vertex.intersection, ray.direction);
+		if (pdf <= 0.0f)
+		{
+			return 1;
+		}
+
+		// emitted radiance times cosine, divided by densities of point and direction
+		Evaluate(vertex, ray.direction, true, beta);
+		ray.ForEachWave(tracer_.spectrum_.count, [&](size_t t) { beta[t] *= vertex.beta[t] / pdf; });
+
+		// the light and maximum depth surface vertices
+		size_t maxVertices = maxDepth != 0 ? maxDepth + 1 : 0;
+		return RandomWalk(ray, sampler, beta, pdf, maxVertices, true, path);
+	}
+
+	size_t BidirectionalTask::RandomWalk(Ray ray, Sampler& sampler, SpectralPacket& beta, float pdf, size_t maxVertices, bool adjoint, std::vector<Vertex>& path) const
+	{
+		static const Scene& scene = *tracer_.scene_;
+		static const MaterialTable& materials = scene.materialTable();
+		static const size_t spectrumCount = tracer_.spectrum_.count;
+		static const size_t rouletteDepth = tracer_.settings_.rouletteDepth;
+		static const bool russianRoulette = tracer_.settings_.russianRoulette;
+		static thread_local SpectralPacket reflectance(tracer_.spectrum_.count);
+
+		// light subpaths carry power instead of weight, so Russian
+		// roulette uses throughput relative to the start of subpath
+		float throughput = GetThroughput(ray, beta);
+		float throughputScale = throughput > 0.0f ? 1.0f / throughput : 0.0f;
+
+		size_t count = 1;
+		while ((maxVertices == 0) || (count < maxVertices))
+		{
+			// try to find intersection
+			Intersection intersection;
+			if (!scene.Intersect(ray, intersection))
+			{
+				break;
+			}
+
+			Vertex& vertex = GetVertex(path, count);
+			Vertex& previous = path[count - 1];
+			count++;
+
+			vertex.type = VertexType::Surface;
+			vertex.intersection = intersection;
+			vertex.material = intersection.primitive->materialId();
+			vertex.ray = ray;
+			vertex.pdfReverse = 0.0f;
+			ray.ForEachWave(spectrumCount, [&](size_t t) { vertex.beta[t] = beta[t]; });
+
+			// solid angle density converted to area density
+			vertex.pdfForward = pdf * std::abs(ray.direction.Dot(intersection.normal)) / (intersection.distance * intersection.distance);
+
+			// check if material is reflective and path can be extended
+			MaterialId material = vertex.material;
+			if (!materials.IsReflective(material) || ((maxVertices != 0) && (count >= maxVertices)))
+			{
+				break;
+			}
+
+			// preserve wave lengths of the path
+			Ray newRay;
+			newRay.refracted = ray.refracted;
+			newRay.waveIndex = ray.waveIndex;
+			newRay.heroIndex = ray.heroIndex;
+			newRay.waveCount = ray.waveCount;
+
+			if (!materials.Sample(material, ray, intersection, sampler, newRay))
+			{
+				break;
+			}
+
+			pdf = materials.GetPdf(material, ray, intersection, newRay.direction);
+			if (pdf <= 0.0f)
+			{
+				break;
+			}
+
+			// update ray weight
+			if (adjoint)
+			{
+				materials.EvaluateAdjoint(material, ray, intersection, newRay.direction, reflectance);
+			}
+			else
+			{
+				materials.Evaluate(material, ray, intersection, newRay.direction, reflectance);
+			}
+			ray.ForEachWave(spectrumCount, [&](size_t t) { beta[t] *= reflectance[t] / pdf; });
+
+			// density of sampling the previous vertex, when the path is traced from the other end
+			if (previous.type != VertexType::Camera)
+			{
+				Ray reversed = ray;
+				reversed.direction = -newRay.direction;
+				float pdfReverse = materials.GetPdf(material, reversed, intersection, -ray.direction);
+				previous.pdfReverse = pdfReverse * std::abs(ray.direction.Dot(previous.intersection.normal)) /
+					(intersection.distance * intersection.distance);
+			}
+
+			// Russian roulette: continue with probability of the path throughput
+			if (russianRoulette && (count - 1 >= rouletteDepth))
+			{
+				float continueProbability = std::min(GetThroughput(ray, beta) * throughputScale, 1.0f);
+				if (sampler.Get1D() >= continueProbability)
+				{
+					break;
+				}
+
+				// survived ray compensates for terminated rays
+				ray.ForEachWave(spectrumCount, [&](size_t t) { beta[t] /= continueProbability; });
+			}
+
+			// change current ray to reflected ray
+			std::swap(ray, newRay);
+		}
+
+		return count;
+	}
+
+	void BidirectionalTask::Connect(std::vector<Vertex>& lightPath, std::vector<Vertex>& cameraPath, size_t s, size_t t,
+		Sampler& sampler, std::vector<Vec3>& color, size_t pixel) const
+	{
+		static const Scene& scene = *tracer_.scene_;
+		static const CameraModel& camera = *tracer_.cameraModel_;
+		static const MaterialTable& materials = scene.materialTable();
+		static const EmitterTable& emitters = scene.emitters();
+		static const size_t spectrumCount = tracer_.spectrum_.count;
+		static const unsigned int width = tracer_.width_;
+
+		static thread_local SpectralPacket value(tracer_.spectrum_.count);
+		static thread_local SpectralPacket scattering(tracer_.spectrum_.count);
+		static thread_local Vertex lightVertex(tracer_.spectrum_.count);
+
+		const Ray& ray = cameraPath[0].ray;
+		float scale = 1.0f;
+
+		if (s == 0)
+		{
+			// camera subpath has found light
+			const Vertex& pt = cameraPath[t - 1];
+			if (!materials.IsEmissive(pt.material) || (pt.ray.direction.Dot(pt.intersection.normal) >= 0.0f))
+			{
+				return;
+			}
+
+			materials.GetRadiance(pt.material, pt.ray, pt.intersection, value);
+			ray.ForEachWave(spectrumCount, [&](size_t i) { value[i] *= pt.beta[i]; });
+		}
+		else if (t == 1)
+		{
+			// light subpath is seen by the camera
+			const Vertex& qs = lightPath[s - 1];
+			float x, y;
+			if (!camera.Project(qs.intersection.point, x, y))
+			{
+				return;
+			}
+
+			Vec3 toCamera = cameraPath[0].intersection.point - qs.intersection.point;
+			float distance = toCamera.Length();
+			Vec3 direction = toCamera / distance;
+
+			Evaluate(qs, direction, true, value);
+			ray.ForEachWave(spectrumCount, [&](size_t i) { value[i] *= qs.beta[i]; });
+			if (GetThroughput(ray, value) <= 0.0f)
+			{
+				return;
+			}
+
+			// camera ray through the point
+			Ray cameraRay = ray;
+			cameraRay.direction = -direction;
+			if (scene.Occluded(cameraRay, distance * (1.0f - ShadowRayEps)))
+			{
+				return;
+			}
+
+			// importance emitted by the camera
+			scale = camera.GetDirectionPdf(-direction) / (distance * distance);
+			pixel = static_cast<size_t>(y) * width + static_cast<size_t>(x);
+		}
+		else
+		{
+			const Vertex& pt = cameraPath[t - 1];
+			if (!materials.IsReflective(pt.material))
+			{
+				return;
+			}
+
+			if (s == 1)
+			{
+				// point on light is sampled for the camera vertex, and replaces the first light vertex
+				LightSample light;
+				if (!emitters.Sample(pt.intersection.point, pt.intersection.normal, sampler, light))
+				{
+					return;
+				}
+
+				lightVertex.type = VertexType::Light;
+				lightVertex.intersection.point = light.point;
+				lightVertex.intersection.normal = light.normal;
+				lightVertex.intersection.frame = Frame(light.normal);
+				lightVertex.intersection.distance = 0.0f;
+				lightVertex.intersection.primitive = light.primitive;
+				lightVertex.material = light.primitive->materialId();
+				lightVertex.ray = ray;
+				ray.ForEachWave(spectrumCount, [&](size_t i) { lightVertex.beta[i] = 1.0f / light.pdf; });
+
+				// weights assume that light subpaths start from the point,
+				// difference of the densities is accounted for in MIS weight
+				lightVertex.pdfForward = emitters.GetEmissionPdf(light.primitive);
+				lightVertex.pdfReverse = 0.0f;
+				std::swap(lightPath[0], lightVertex);
+			}
+
+			const Vertex& qs = lightPath[s - 1];
+			Vec3 toLight = qs.intersection.point - pt.intersection.point;
+			float distanceSquared = toLight.Dot(toLight);
+			float distance = std::sqrt(distanceSquared);
+			Vec3 direction = toLight / distance;
+
+			// scattering at both ends of the connection
+			Evaluate(pt, direction, false, value);
+			Evaluate(qs, -direction, true, scattering);
+			ray.ForEachWave(spectrumCount, [&](size_t i) { value[i] *= scattering[i] * pt.beta[i] * qs.beta[i]; });
+
+			bool visible = false;
+			if (GetThroughput(ray, value) > 0.0f)
+			{
+				Ray shadowRay = pt.ray;
+				shadowRay.origin = pt.intersection.point;
+				shadowRay.direction = direction;
+				visible = !scene.Occluded(shadowRay, distance * (1.0f - ShadowRayEps));
+			}
+
+			scale = visible ? GetMISWeight(lightPath, cameraPath, s, t) / distanceSquared : 0.0f;
+			if (s == 1)
+			{
+				std::swap(lightPath[0], lightVertex);
+			}
+
+			if (scale > 0.0f)
+			{
+				AddRadiance(ray, value, scale, color[pixel]);
+			}
+			return;
+		}
+
+		float misWeight = GetMISWeight(lightPath, cameraPath, s, t);
+		AddRadiance(ray, value, scale * misWeight, color[pixel]);
+	}
+
+	float BidirectionalTask::GetMISWeight(std::vector<Vertex>& lightPath, std::vector<Vertex>& cameraPath, size_t s, size_t t) const
+	{
+		static const EmitterTable& emitters = tracer_.scene_->emitters();
+
+		// light seen directly can be found only by camera subpath
+		if (s + t == 2)
+		{
+			return 1.0f;
+		}
+
+		// vertices at both sides of the connection
+		Vertex* qs = s > 0 ? &lightPath[s - 1] : nullptr;
+		Vertex* qsMinus = s > 1 ? &lightPath[s - 2] : nullptr;
+		Vertex* pt = &cameraPath[t - 1];
+		Vertex* ptMinus = t > 1 ? &cameraPath[t - 2] : nullptr;
+
+		// reverse densities of the connected vertices depend on the connection,
+		// they are changed only while the weight is computed
+		float ptReverse = pt->pdfReverse;
+		float ptMinusReverse = ptMinus != nullptr ? ptMinus->pdfReverse : 0.0f;
+		float qsReverse = qs != nullptr ? qs->pdfReverse : 0.0f;
+		float qsMinusReverse = qsMinus != nullptr ? qsMinus->pdfReverse : 0.0f;
+
+		pt->pdfReverse = s > 0 ? GetPdf(qsMinus, *qs, *pt) : emitters.GetEmissionPdf(pt->intersection.primitive);
+		if (ptMinus != nullptr)
+		{
+			ptMinus->pdfReverse = s > 0 ? GetPdf(qs, *pt, *ptMinus) : GetEmissionPdf(*pt, *ptMinus);
+		}
+
+		if (qs != nullptr)
+		{
+			qs->pdfReverse = GetPdf(ptMinus, *pt, *qs);
+		}
+
+		if (qsMinus != nullptr)
+		{
+			qsMinus->pdfReverse = GetPdf(pt, *qs, *qsMinus);
+		}
+
+		// light subpaths start from emitters selected by power, while connection
+		// to a single light vertex selects emitter by its importance for the next vertex
+		const Vertex& light = s > 0 ? lightPath[0] : *pt;
+		const Vertex& next = s > 1 ? lightPath[1] : (s == 1 ? *pt : *ptMinus);
+		float emissionPdf = emitters.GetEmissionPdf(light.intersection.primitive);
+		float lightRatio = emissionPdf > 0.0f
+			? emitters.GetPdf(light.intersection.primitive, next.intersection.point, next.intersection.normal) / emissionPdf
+			: 0.0f;
+		float lightFactor = lightRatio * lightRatio;
+
+		// relative densities of strategies with i light vertices, squared for power heuristic
+		auto strategy = [&](size_t i, float ratio) { return i == 1 ? ratio * lightFactor : ratio; };
+
+		float current = strategy(s, 1.0f);
+		float sum = current;
+
+		// strategies with more light vertices
+		float ratio = 1.0f;
+		for (size_t i = t - 1; i > 0; i--)
+		{
+			float r = cameraPath[i].pdfReverse / cameraPath[i].pdfForward;
+			ratio *= r * r;
+			sum += strategy(s + t - i, ratio);
+		}
+
+		// strategies with more camera vertices
+		ratio = 1.0f;
+		for (size_t i = s; i-- > 0;)
+		{
+			float r = lightPath[i].pdfReverse / lightPath[i].pdfForward;
+			ratio *= r * r;
+			sum += strategy(i, ratio);
+		}
+
+		pt->pdfReverse = ptReverse;
+		if (ptMinus != nullptr)
+		{
+			ptMinus->pdfReverse = ptMinusReverse;
+		}
+
+		if (qs != nullptr)
+		{
+			qs->pdfReverse = qsReverse;
+		}
+
+		if (qsMinus != nullptr)
+		{
+			qsMinus->pdfReverse = qsMinusReverse;
+		}
+
+		return current / sum;
+	}
+
+	float BidirectionalTask::GetPdf(const Vertex* previous, const Vertex& vertex, const Vertex& next) const
+	{
+		static const CameraModel& camera = *tracer_.cameraModel_;
+		static const MaterialTable& materials = tracer_.scene_->materialTable();
+
+		if (vertex.type == VertexType::Light)
+		{
+			return GetEmissionPdf(vertex, next);
+		}
+
+		Vec3 toNext = next.intersection.point - vertex.intersection.point;
+		float distanceSquared = toNext.Dot(toNext);
+		Vec3 direction = toNext / std::sqrt(distanceSquared);
+
+		float pdf;
+		if (vertex.type == VertexType::Camera)
+		{
+			pdf = camera.GetDirectionPdf(direction);
+		}
+		else
+		{
+			// surface is reached from previous vertex
+			Ray ray = vertex.ray;
+			ray.direction = (vertex.intersection.point - previous->intersection.point).Normalize();
+			pdf = materials.GetPdf(vertex.material, ray, vertex.intersection, direction);
+		}
+
+		// convert solid angle density to area density
+		return pdf * std::abs(direction.Dot(next.intersection.normal)) / distanceSquared;
+	}
+
+	float BidirectionalTask::GetEmissionPdf(const Vertex& vertex, const Vertex& next) const
+	{
+		static const MaterialTable& materials = tracer_.scene_->materialTable();
+
+		Vec3 toNext = next.intersection.point - vertex.intersection.point;
+		float distanceSquared = toNext.Dot(toNext);
+		Vec3 direction = toNext / std::sqrt(distanceSquared);
+
+		float pdf = materials.GetEmissionPdf(vertex.material, vertex.intersection, direction);
+		return pdf * std::abs(direction.Dot(next.intersection.normal)) / distanceSquared;
+	}
+
+	void BidirectionalTask::Evaluate(const Vertex& vertex, const Vec3& direction, bool adjoint, SpectralPacket& value) const
+	{
+		static const MaterialTable& materials = tracer_.scene_->materialTable();
+
+		if (vertex.type == VertexType::Surface)
+		{
+			if (adjoint)
+			{
+				materials.EvaluateAdjoint(vertex.material, vertex.ray, vertex.intersection, direction, value);
+			}
+			else
+			{
+				materials.Evaluate(vertex.material, vertex.ray, vertex.intersection, direction, value);
+			}
+			return;
+		}
+
+		// light is emitted to the front side only
+		float cosTheta = vertex.intersection.normal.Dot(direction);
+		if (cosTheta <= 0.0f)
+		{
+			vertex.ray.ForEachWave(value.size(), [&](size_t t) { value[t] = 0.0f; });
+			return;
+		}
+
+		// radiance arriving along the ray from light
+		Ray ray = vertex.ray;
+		ray.direction = -direction;
+		materials.GetRadiance(vertex.material, ray, vertex.intersection, value);
+		ray.ForEachWave(value.size(), [&](size_t t) { value[t] *= cosTheta; });
+	}
+
+}
@@ -0,0 +1,83 @@
+#ifndef SPT_BIDIRECTIONAL_TASK_H
+#define SPT_BIDIRECTIONAL_TASK_H
+
+#include "../stdafx.h"
+#include "../Color/SpectralPacket.h"
+#include "../Material/MaterialId.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/Ray.h"
+#include "IntegratorTask.h"
+
+namespace SPTracer
+{
+	class Sampler;
+	class Tracer;
+
+	// Bidirectional path tracing. For every pixel a camera subpath and a light
+	// subpath are traced, and every pair of their vertices is connected. Each
+	// connection is weighted with the power heuristic over all strategies which
+	// could generate the same path. Light vertices connected to the camera are
+	// splatted to the pixels they are projected to.
+	class BidirectionalTask : public IntegratorTask
+	{
+	public:
+		explicit BidirectionalTask(Tracer& tracer);
+
+		virtual void Run() override;
+
+	private:
+		enum class VertexType
+		{
+			Camera,
+			Light,
+			Surface
+		};
+
+		struct Vertex
+		{
+			VertexType type;
+			Intersection intersection;	// point, normal and primitive
+			MaterialId material;		// light and surface vertices
+			Ray ray;					// ray reaching the vertex, carries wave lengths of the path
+			SpectralPacket beta;		// weight of subpath up to the vertex
+			float pdfForward;			// area density of the vertex, when it is sampled by its subpath
+			float pdfReverse;			// area density of the vertex, when it is sampled from the other end
+
+			explicit Vertex(size_t spectrumCount) : beta(spectrumCount) { }
+		};
+
+		// vertex of path, path grows when needed
+		Vertex& GetVertex(std::vector<Vertex>& path, size_t index) const;
+
+		// subpaths start from camera ray and from a point sampled on lights,
+		// light subpath carries wave lengths of the camera ray, returns number of vertices
+		size_t TraceCameraPath(const Ray& ray, Sampler& sampler, std::vector<Vertex>& path) const;
+		size_t TraceLightPath(const Ray& cameraRay, Sampler& sampler, std::vector<Vertex>& path) const;
+
+		// extends subpath from its first vertex, ray direction was sampled with solid
+		// angle density pdf, beta is the weight of the ray, light subpaths scatter with
+		// adjoint BSDF, returns number of vertices
+		size_t RandomWalk(Ray ray, Sampler& sampler, SpectralPacket& beta, float pdf, size_t maxVertices, bool adjoint, std::vector<Vertex>& path) const;
+
+		// adds path made of s light and t camera vertices to the pixel,
+		// or to the pixel the light vertex is seen in, if t is 1
+		void Connect(std::vector<Vertex>& lightPath, std::vector<Vertex>& cameraPath, size_t s, size_t t,
+			Sampler& sampler, std::vector<Vec3>& color, size_t pixel) const;
+
+		// power heuristic weight of the connection, among all strategies generating the path
+		float GetMISWeight(std::vector<Vertex>& lightPath, std::vector<Vertex>& cameraPath, size_t s, size_t t) const;
+
+		// area density of sampling vertex next from vertex, which was reached from previous
+		float GetPdf(const Vertex* previous, const Vertex& vertex, const Vertex& next) const;
+
+		// area density of emitting light from vertex towards next
+		float GetEmissionPdf(const Vertex& vertex, const Vertex& next) const;
+
+		// BSDF times cosine at surface vertex (adjoint BSDF for vertex of light subpath),
+		// or emitted radiance times cosine at light vertex
+		void Evaluate(const Vertex& vertex, const Vec3& direction, bool adjoint, SpectralPacket& value) const;
+	};
+
+}
+
+#endif
@@ -0,0 +1,541 @@
+#include "../stdafx.h"
+#include "../Frame.h"
+#include "../Util.h"
+#include "../Color/SpectralPacket.h"
+#include "../Color/Spectrum.h"
+#include "../Color/XYZConverter.h"
+#include "../Light/EmitterTable.h"
+#include "../Light/LightSample.h"
+#include "../Material/MaterialTable.h"
+#include "../Primitive/Box.h"
+#include "../Scene/Scene.h"
+#include "../Primitive/Primitive.h"
+#include "../Sampler/RandomSampler.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/PathStatistics.h"
+#include "../Tracer/Ray.h"
+#include "../Tracer/Tracer.h"
+#include "PassState.h"
+#include "TaskScheduler.h"
+#include "InstantRadiosityTask.h"
+
+namespace SPTracer
+{
+
+	const size_t InstantRadiosityTask::PathBatchSize = 256;
+
+	InstantRadiosityTask::InstantRadiosityTask(Tracer& tracer, Phase phase)
+		: IntegratorTask(tracer), phase_(phase)
+	{
+	}
+
+	void InstantRadiosityTask::Run()
+	{
+		switch (phase_)
+		{
+		case Phase::Lights:
+			TraceLights();
+			break;
+
+		case Phase::Image:
+			TraceImage();
+			break;
+		}
+	}
+
+	void InstantRadiosityTask::TraceLights()
+	{
+		static VirtualPointLights& lights = *tracer_.virtualPointLights_;
+		static PassState& pass = *tracer_.passState_;
+		static const size_t pathCount = lights.pathsPerPass();
+		static const size_t batchCount = (pathCount + PathBatchSize - 1) / PathBatchSize;
+		static const bool emitters = !tracer_.scene_->emitters().empty();
+
+		// lights of one batch
+		static thread_local std::vector<VirtualPointLights::Light> batchLights;
+		static thread_local std::vector<float> batchIntensities;
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		size_t batch;
+		while (pass.work().GetWork(batchCount, batch))
+		{
+			batchLights.clear();
+			batchIntensities.clear();
+
+			size_t count = std::min(PathBatchSize, pathCount - batch * PathBatchSize);
+			for (size_t i = 0; emitters && (i < count); i++)
+			{
+				TraceLightPath(sampler, 1.0f / static_cast<float>(pathCount), batchLights, batchIntensities);
+			}
+
+			lights.Add(batchLights, batchIntensities);
+		}
+
+		if (!pass.work().CompleteTask())
+		{
+			return;
+		}
+
+		// all lights of the pass are found
+		lights.BuildTree();
+		pass.work().AddTasks<InstantRadiosityTask>(*tracer_.taskScheduler_, tracer_, Phase::Image);
+	}
+
+	void InstantRadiosityTask::TraceImage()
+	{
+		// width and height
+		static const unsigned int width = tracer_.width_;
+		static const unsigned int height = tracer_.height_;
+
+		static VirtualPointLights& lights = *tracer_.virtualPointLights_;
+		static PassState& pass = *tracer_.passState_;
+		static thread_local PathStatistics pathStatistics;
+
+		// primary rays of one image row
+		static thread_local std::vector<Ray> cameraRays(width);
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		pathStatistics.Reset();
+
+		size_t i;
+		while (pass.work().GetWork(height, i))
+		{
+			// generate primary rays for the row
+			GenerateCameraRays(i, sampler, cameraRays);
+
+			for (size_t j = 0; j < width; j++)
+			{
+				// lights carry all wave lengths, so camera paths carry full spectrum too
+				Ray ray = cameraRays[j];
+
+				Vec3& color = pass.image()[i * width + j];
+				color.Reset();
+
+				TraceCameraPath(ray, sampler, color, pathStatistics);
+			}
+		}
+
+		pass.MergePathStatistics(pathStatistics);
+		if (!pass.work().CompleteTask())
+		{
+			return;
+		}
+
+		// image of the pass is complete
+		tracer_.AddSamples(pass.image(), pass.pathStatistics());
+		pass.pathStatistics().Reset();
+
+		// next pass with new lights
+		lights.Clear();
+		pass.work().AddTasks<InstantRadiosityTask>(*tracer_.taskScheduler_, tracer_, Phase::Lights);
+	}
+
+	void InstantRadiosityTask::TraceLightPath(Sampler& sampler, float scale, std::vector<VirtualPointLights::Light>& lights, std::vector<float>& intensities) const
+	{
+		static const Scene& scene = *tracer_.scene_;
+		static const MaterialTable& materials = scene.materialTable();
+		static const EmitterTable& emitters = scene.emitters();
+		static const size_t spectrumCount = tracer_.spectrum_.count;
+		static const size_t maxDepth = tracer_.settings_.maxDepth;
+		static const bool russianRoulette = tracer_.settings_.russianRoulette;
+		static const size_t rouletteDepth = tracer_.settings_.rouletteDepth;
+
+		static thread_local SpectralPacket reflectance(tracer_.spectrum_.count);
+		static thread_local SpectralPacket power(tracer_.spectrum_.count);
+
+		// point on lights
+		LightSample light;
+		emitters.SampleEmission(sampler, light);
+
+		Intersection lightIntersection;
+		lightIntersection.point = light.point;
+		lightIntersection.normal = light.normal;
+		lightIntersection.frame = Frame(light.normal);
+		lightIntersection.distance = 0.0f;
+		lightIntersection.primitive = light.primitive;
+		MaterialId lightMaterial = light.primitive->materialId();
+
+		Ray ray;
+		ray.origin = light.point;
+		ray.waveIndex = -1;
+		ray.heroIndex = 0;
+		ray.waveCount = 0;
+		ray.refracted = false;
+
+		// light on emitter gets emitted radiance when it is shaded,
+		// it is clustered by radiance along the normal
+		Ray toLight = ray;
+		toLight.direction = -light.normal;
+		materials.GetRadiance(lightMaterial, toLight, lightIntersection, power);
+
+		float emitterPower = 0.0f;
+		for (size_t t = 0; t < spectrumCount; t++)
+		{
+			intensities.push_back(scale / light.pdf);
+			emitterPower += power[t] * scale / light.pdf;
+		}
+		lights.push_back({ light.point, light.normal, light.primitive, emitterPower / static_cast<float>(spectrumCount) });
+
+		// direction of the subpath
+		ray.direction = materials.SampleEmission(lightMaterial, lightIntersection, sampler);
+		float pdf = materials.GetEmissionPdf(lightMaterial, lightIntersection, ray.direction);
+		float cosTheta = light.normal.Dot(ray.direction);
+		if ((pdf <= 0.0f) || (cosTheta <= 0.0f))
+		{
+			return;
+		}
+
+		// emitted radiance times cosine, divided by densities of point and direction
+		toLight.direction = -ray.direction;
+		materials.GetRadiance(lightMaterial, toLight, lightIntersection, power);
+		float emissionScale = scale * cosTheta / (light.pdf * pdf);
+		for (size_t t = 0; t < spectrumCount; t++)
+		{
+			power[t] *= emissionScale;
+		}
+
+		// Russian roulette uses throughput relative to the emitted power
+		float throughput = power.Max();
+		float throughputScale = throughput > 0.0f ? 1.0f / throughput : 0.0f;
+
+		// number of bounces
+		size_t depth = 0;
+
+		while (true)
+		{
+			// try to find intersection
+			Intersection intersection;
+			if (!scene.Intersect(ray, intersection))
+			{
+				break;
+			}
+
+			MaterialId material = intersection.primitive->materialId();
+
+			// diffuse vertex reflects power as point light with cosine distribution
+			const MaterialRecord& m = materials.record(material);
+			if (m.type == MaterialType::Lambertian)
+			{
+				float lightPower = 0.0f;
+				for (size_t t = 0; t < spectrumCount; t++)
+				{
+					float intensity = power[t] * m.diffuseReflectance[t] / Util::Pi;
+					intensities.push_back(intensity);
+					lightPower += intensity;
+				}
+
+				if (lightPower > 0.0f)
+				{
+					lights.push_back({ intersection.point, intersection.normal, nullptr, lightPower / static_cast<float>(spectrumCount) });
+				}
+				else
+				{
+					intensities.resize(intensities.size() - spectrumCount);
+				}
+			}
+
+			// check if material is reflective and path can be extended,
+			// the last vertex is used only as light
+			if (!materials.IsReflective(material) || ((maxDepth != 0) && (depth + 1 >= maxDepth)))
+			{
+				break;
+			}
+
+			Ray newRay;
+			newRay.refracted = ray.refracted;
+			newRay.waveIndex = ray.waveIndex;
+			newRay.heroIndex = ray.heroIndex;
+			newRay.waveCount = ray.waveCount;
+
+			if (!materials.Sample(material, ray, intersection, sampler, newRay))
+			{
+				break;
+			}
+
+			pdf = materials.GetPdf(material, ray, intersection, newRay.direction);
+			if (pdf <= 0.0f)
+			{
+				break;
+			}
+
+			// power scattered towards the next vertex, evaluated from the light side
+			materials.EvaluateAdjoint(material, ray, intersection, newRay.direction, reflectance);
+			power.MultiplyScaled(reflectance, 1.0f / pdf);
+			depth++;
+
+			// Russian roulette: continue with probability of the subpath throughput
+			if (russianRoulette && (depth >= rouletteDepth))
+			{
+				float continueProbability = std::min(power.Max() * throughputScale, 1.0f);
+				if (sampler.Get1D() >= continueProbability)
+				{
+					break;
+				}
+
+				// survived subpath compensates for terminated subpaths
+				power.Divide(continueProbability);
+			}
+
+			std::swap(ray, newRay);
+		}
+	}
+
+	void InstantRadiosityTask::TraceCameraPath(Ray ray, Sampler& sampler, Vec3& color, PathStatistics& pathStatistics) const
+	{
+		static thread_local SpectralPacket weight(tracer_.spectrum_.count);
+
+		Intersection intersection;
+		if (!TraceToDiffuse(ray, sampler, intersection, weight, color, pathStatistics))
+		{
+			return;
+		}
+
+		// diffuse vertex is lit by virtual point lights
+		ShadeLightcut(ray, intersection, intersection.primitive->materialId(), weight, color);
+	}
+
+	void InstantRadiosityTask::ShadeLightcut(const Ray& ray, const Intersection& intersection, MaterialId material,
+		const SpectralPacket& weight, Vec3& color) const
+	{
+		static const VirtualPointLights& lights = *tracer_.virtualPointLights_;
+		static const size_t spectrumCount = tracer_.spectrum_.count;
+		static const size_t maxCutSize = std::max(tracer_.settings_.lightcutsMaxSize, 1u);
+		static const float errorRatio = tracer_.settings_.lightcutsError;
+
+		// clusters which can be refined, ordered by bound, and single lights
+		static thread_local std::vector<Cluster> clusters;
+		static thread_local std::vector<Cluster> leaves;
+
+		// spectral estimates of clusters, refined cluster passes its slot to one of the children
+		static thread_local std::vector<float> estimates((maxCutSize + 1) * spectrumCount);
+		static thread_local SpectralPacket radiance(tracer_.spectrum_.count);
+
+		const LightTree& tree = lights.tree();
+		if (tree.empty())
+		{
+			return;
+		}
+
+		auto compare = [](const Cluster& a, const Cluster& b) { return a.bound < b.bound; };
+		float reflectance = tracer_.scene_->materialTable().record(material).diffuseReflectance.Max();
+		float total = 0.0f;
+		size_t slotCount = 0;
+
+		// cluster is shaded by its representative, scaled by power of the cluster,
+		// estimate of the parent is reused by the child with the same representative
+		auto addCluster = [&](size_t node, const Cluster* parent)
+		{
+			float bound = GetBound(node, intersection, reflectance);
+			if (bound <= 0.0f)
+			{
+				return;
+			}
+
+			Cluster c;
+			c.node = node;
+			c.bound = bound;
+
+			size_t representative = tree.representative(node);
+			if ((parent != nullptr) && (tree.representative(parent->node) == representative))
+			{
+				float scale = tree.bounds(node).power() / tree.bounds(parent->node).power();
+				c.slot = parent->slot;
+				c.estimate = parent->estimate * scale;
+
+				float* estimate = &estimates[c.slot * spectrumCount];
+				std::for_each(estimate, estimate + spectrumCount, [&](float& e) { e *= scale; });
+			}
+			else
+			{
+				float scale = tree.bounds(node).power() / lights.light(representative).power;
+				c.slot = slotCount++;
+
+				float* estimate = &estimates[c.slot * spectrumCount];
+				c.estimate = EvaluateLight(representative, ray, intersection, material, estimate) * scale;
+				std::for_each(estimate, estimate + spectrumCount, [&](float& e) { e *= scale; });
+			}
+
+			total += c.estimate;
+
+			size_t left, right;
+			if (tree.GetChildren(node, left, right))
+			{
+				clusters.push_back(c);
+				std::push_heap(clusters.begin(), clusters.end(), compare);
+			}
+			else
+			{
+				leaves.push_back(c);
+			}
+		};
+
+		clusters.clear();
+		leaves.clear();
+		addCluster(0, nullptr);
+
+		// refine cluster with the largest error bound, until all bounds are small
+		// relative to the estimate of the total, or the cut is too large
+		size_t cutSize = 1;
+		while (!clusters.empty() && (cutSize < maxCutSize))
+		{
+			Cluster c = clusters.front();
+			if (c.bound <= errorRatio * total)
+			{
+				break;
+			}
+
+			std::pop_heap(clusters.begin(), clusters.end(), compare);
+			clusters.pop_back();
+			total -= c.estimate;
+
+			size_t left, right;
+			tree.GetChildren(c.node, left, right);
+			addCluster(left, &c);
+			addCluster(right, &c);
+			cutSize++;
+		}
+
+		// light of all clusters in the cut
+		radiance.Fill(0.0f);
+		auto addEstimate = [&](const Cluster& c)
+		{
+			const float* estimate = &estimates[c.slot * spectrumCount];
+			for (size_t t = 0; t < spectrumCount; t++)
+			{
+				radiance[t] += estimate[t];
+			}
+		};
+
+		std::for_each(clusters.begin(), clusters.end(), addEstimate);
+		std::for_each(leaves.begin(), leaves.end(), addEstimate);
+
+		AddRadiance(ray, radiance, weight, 1.0f, color);
+	}
+
+	float InstantRadiosityTask::EvaluateLight(size_t light, const Ray& ray, const Intersection& intersection, MaterialId material, float* radiance) const
+	{
+		static const Scene& scene = *tracer_.scene_;
+		static const MaterialTable& materials = scene.materialTable();
+		static const VirtualPointLights& lights = *tracer_.virtualPointLights_;
+		static const size_t spectrumCount = tracer_.spectrum_.count;
+		static const float clampDistanceSquared = lights.clampDistance() * lights.clampDistance();
+
+		static thread_local SpectralPacket bsdf(tracer_.spectrum_.count);
+		static thread_local SpectralPacket emitted(tracer_.spectrum_.count);
+
+		std::fill(radiance, radiance + spectrumCount, 0.0f);
+
+		// direction to light
+		const VirtualPointLights::Light& l = lights.light(light);
+		Vec3 toLight = l.point - intersection.point;
+		float distanceSquared = toLight.Dot(toLight);
+		if (distanceSquared <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		float distance = std::sqrt(distanceSquared);
+		Vec3 direction = toLight / distance;
+
+		// light must be in front of the surface and surface in front of the light
+		float cosLight = -direction.Dot(l.normal);
+		if ((cosLight <= 0.0f) || (direction.Dot(intersection.normal) <= 0.0f))
+		{
+			return 0.0f;
+		}
+
+		// shadow ray
+		Ray shadowRay = ray;
+		shadowRay.origin = intersection.point;
+		shadowRay.direction = direction;
+		if (scene.Occluded(shadowRay, distance * (1.0f - ShadowRayEps)))
+		{
+			return 0.0f;
+		}
+
+		// emitted radiance towards the surface, for light on emitter
+		if (l.emitter != nullptr)
+		{
+			Intersection lightIntersection;
+			lightIntersection.point = l.point;
+			lightIntersection.normal = l.normal;
+			lightIntersection.frame = Frame(l.normal);
+			lightIntersection.distance = distance;
+			lightIntersection.primitive = l.emitter;
+			materials.GetRadiance(l.emitter->materialId(), shadowRay, lightIntersection, emitted);
+		}
+		else
+		{
+			emitted.Fill(1.0f);
+		}
+
+		// BSDF times cosine at the surface
+		materials.Evaluate(material, ray, intersection, direction, bsdf);
+
+		// geometric term is clamped near the light, which would otherwise show as a bright spot
+		float geometry = cosLight / std::max(distanceSquared, clampDistanceSquared);
+		const float* intensity = lights.intensity(light);
+		float mean = 0.0f;
+		for (size_t t = 0; t < spectrumCount; t++)
+		{
+			radiance[t] = intensity[t] * emitted[t] * bsdf[t] * geometry;
+			mean += radiance[t];
+		}
+
+		return mean / static_cast<float>(spectrumCount);
+	}
+
+	float InstantRadiosityTask::GetBound(size_t node, const Intersection& intersection, float reflectance) const
+	{
+		static const VirtualPointLights& lights = *tracer_.virtualPointLights_;
+		static const float clampDistanceSquared = lights.clampDistance() * lights.clampDistance();
+
+		// cosine at the lights, from their normal cone
+		const LightBounds& bounds = lights.tree().bounds(node);
+		float cosLight = bounds.GetMaxCosine(intersection.point);
+		if (cosLight <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		// closest distance to the box of the cluster
+		float distanceSquared = 0.0f;
+		for (size_t d = 0; d < 3; d++)
+		{
+			float p = intersection.point[d];
+			float delta = std::max(std::max(bounds.min()[d] - p, p - bounds.max()[d]), 0.0f);
+			distanceSquared += delta * delta;
+		}
+
+		// cosine at the surface, from the box in shading frame
+		Vec3 localMin(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+		Vec3 localMax = -localMin;
+		for (size_t i = 0; i < 8; i++)
+		{
+			Vec3 corner((i & 1) ? bounds.max()[0] : bounds.min()[0], (i & 2) ? bounds.max()[1] : bounds.min()[1], (i & 4) ? bounds.max()[2] : bounds.min()[2]);
+			Vec3 local = intersection.frame.ToLocal(corner - intersection.point);
+			for (size_t d = 0; d < 3; d++)
+			{
+				localMin[d] = std::min(localMin[d], local[d]);
+				localMax[d] = std::max(localMax[d], local[d]);
+			}
+		}
+
+		if (localMax[2] <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		float x = std::max(std::max(localMin[0], -localMax[0]), 0.0f);
+		float y = std::max(std::max(localMin[1], -localMax[1]), 0.0f);
+		float z = localMax[2];
+		float cosSurface = z / std::sqrt(x * x + y * y + z * z);
+
+		return bounds.power() * reflectance / Util::Pi * cosLight * cosSurface / std::max(distanceSquared, clampDistanceSquared);
+	}
+
+}
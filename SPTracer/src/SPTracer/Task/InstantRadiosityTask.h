@@ -0,0 +1,77 @@
+#ifndef SPT_INSTANT_RADIOSITY_TASK_H
+#define SPT_INSTANT_RADIOSITY_TASK_H
+
+#include "../stdafx.h"
+#include "../Color/SpectralPacket.h"
+#include "../Light/VirtualPointLights.h"
+#include "../Material/MaterialId.h"
+#include "IntegratorTask.h"
+
+namespace SPTracer
+{
+	struct Intersection;
+	struct Ray;
+	class PathStatistics;
+	class Sampler;
+	class Tracer;
+
+	// Instant radiosity with lightcuts. Light subpaths leave virtual point
+	// lights, which are clustered by the light tree. Camera paths are traced
+	// through glossy surfaces to the first diffuse vertex, where every cluster
+	// of a cut through the tree is shaded by its representative light. The cut
+	// is refined while error bound of a cluster exceeds a fraction of the
+	// estimate. Geometric term is clamped, so the image is noise free but biased.
+	class InstantRadiosityTask : public IntegratorTask
+	{
+	public:
+		enum class Phase
+		{
+			Lights,
+			Image
+		};
+
+		InstantRadiosityTask(Tracer& tracer, Phase phase);
+
+		virtual void Run() override;
+
+	private:
+		// light subpaths traced at once by a task
+		static const size_t PathBatchSize;
+
+		// cluster of the cut
+		struct Cluster
+		{
+			size_t node;
+			float bound;		// upper bound of the contribution
+			float estimate;		// mean of spectral estimate
+			size_t slot;		// spectral estimate in the buffer of the cut
+		};
+
+		Phase phase_;
+
+		// traces batches of light subpaths, and builds light tree when all subpaths are done
+		void TraceLights();
+
+		// traces image rows, and ends pass when all rows are done
+		void TraceImage();
+
+		// traces light subpath carrying scale of its power, and adds virtual point lights at its vertices
+		void TraceLightPath(Sampler& sampler, float scale, std::vector<VirtualPointLights::Light>& lights, std::vector<float>& intensities) const;
+
+		// traces camera path until diffuse vertex, adds light found on the way to color
+		void TraceCameraPath(Ray ray, Sampler& sampler, Vec3& color, PathStatistics& pathStatistics) const;
+
+		// light of virtual point lights at diffuse vertex, shaded through lightcut
+		void ShadeLightcut(const Ray& ray, const Intersection& intersection, MaterialId material,
+			const SpectralPacket& weight, Vec3& color) const;
+
+		// light of virtual point light reflected at the vertex, returns mean of wave lengths
+		float EvaluateLight(size_t light, const Ray& ray, const Intersection& intersection, MaterialId material, float* radiance) const;
+
+		// upper bound of light reflected from cluster at the vertex
+		float GetBound(size_t node, const Intersection& intersection, float reflectance) const;
+	};
+
+}
+
+#endif
@@ -0,0 +1,267 @@
+#include "../stdafx.h"
+#include "../Camera/CameraModel.h"
+#include "../Camera/CameraSample.h"
+#include "../Color/SpectralPacket.h"
+#include "../Color/Spectrum.h"
+#include "../Color/WavelengthSampler.h"
+#include "../Color/XYZTable.h"
+#include "../Light/EmitterTable.h"
+#include "../Light/LightSample.h"
+#include "../Material/MaterialTable.h"
+#include "../Material/MaterialType.h"
+#include "../Primitive/Primitive.h"
+#include "../Sampler/Sampler.h"
+#include "../Scene/Scene.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/PathStatistics.h"
+#include "../Tracer/Ray.h"
+#include "../Tracer/Tracer.h"
+#include "../Vec3.h"
+#include "IntegratorTask.h"
+
+namespace SPTracer
+{
+
+	const float IntegratorTask::ShadowRayEps = 1e-3f;
+
+	IntegratorTask::IntegratorTask(Tracer& tracer)
+		: Task(tracer)
+	{
+	}
+
+	void IntegratorTask::GenerateCameraRays(size_t row, Sampler& sampler, std::vector<Ray>& rays) const
+	{
+		static const CameraModel& camera = *tracer_.cameraModel_;
+		static const unsigned int width = tracer_.width_;
+
+		static thread_local std::vector<CameraSample> cameraSamples(width);
+
+		// sample pixels of the row
+		for (size_t j = 0; j < width; j++)
+		{
+			CameraSample& s = cameraSamples[j];
+			s.x = static_cast<float>(j) + sampler.Get1D();
+			s.y = static_cast<float>(row) + sampler.Get1D();
+			sampler.Get2D(s.lensU, s.lensV);
+		}
+
+		rays.resize(width);
+		camera.GenerateRays(cameraSamples.data(), width, rays.data());
+
+		// integrators tracing hero packets choose wave lengths per path
+		for (Ray& ray : rays)
+		{
+			ray.waveIndex = -1;
+			ray.heroIndex = 0;
+			ray.waveCount = 0;
+			ray.refracted = false;
+		}
+	}
+
+	bool IntegratorTask::TraceToDiffuse(Ray& ray, Sampler& sampler, Intersection& intersection, SpectralPacket& weight,
+		Vec3& color, PathStatistics& pathStatistics) const
+	{
+		static const Scene& scene = *tracer_.scene_;
+		static const MaterialTable& materials = scene.materialTable();
+		static const size_t maxDepth = tracer_.settings_.maxDepth;
+		static const bool russianRoulette = tracer_.settings_.russianRoulette;
+		static const size_t rouletteDepth = tracer_.settings_.rouletteDepth;
+
+		static thread_local SpectralPacket reflectance(tracer_.spectrum_.count);
+		static thread_local SpectralPacket radiance(tracer_.spectrum_.count);
+
+		weight.Fill(1.0f);
+
+		// number of bounces
+		size_t depth = 0;
+		bool found = false;
+
+		while (true)
+		{
+			// try to find intersection
+			if (!scene.Intersect(ray, intersection))
+			{
+				break;
+			}
+
+			MaterialId material = intersection.primitive->materialId();
+
+			// light is not sampled at glossy vertices, so emission is always added
+			if (materials.IsEmissive(material))
+			{
+				materials.GetRadiance(material, ray, intersection, radiance);
+				AddRadiance(ray, radiance, weight, 1.0f, color);
+			}
+
+			// check if material is reflective and path can be extended
+			if (!materials.IsReflective(material) || ((maxDepth != 0) && (depth >= maxDepth)))
+			{
+				break;
+			}
+
+			// diffuse vertex is shaded by the integrator
+			if (materials.record(material).type == MaterialType::Lambertian)
+			{
+				found = true;
+				break;
+			}
+
+			// glossy vertex is passed by sampling BSDF
+			Ray newRay;
+			newRay.refracted = ray.refracted;
+			newRay.waveIndex = ray.waveIndex;
+			newRay.heroIndex = ray.heroIndex;
+			newRay.waveCount = ray.waveCount;
+
+			if (!materials.Sample(material, ray, intersection, sampler, newRay))
+			{
+				break;
+			}
+
+			float pdf = materials.GetPdf(material, ray, intersection, newRay.direction);
+			if (pdf <= 0.0f)
+			{
+				break;
+			}
+
+			// update ray weight
+			materials.Evaluate(material, ray, intersection, newRay.direction, reflectance);
+			weight.MultiplyScaled(reflectance, 1.0f / pdf);
+			depth++;
+
+			// Russian roulette: continue with probability of the path throughput
+			if (russianRoulette && (depth >= rouletteDepth))
+			{
+				float continueProbability = std::min(weight.Max(), 1.0f);
+				if (sampler.Get1D() >= continueProbability)
+				{
+					break;
+				}
+
+				// survived ray compensates for terminated rays
+				weight.Divide(continueProbability);
+			}
+
+			std::swap(ray, newRay);
+		}
+
+		pathStatistics.Add(depth);
+		return found;
+	}
+
+	bool IntegratorTask::SampleEmitter(const Ray& ray, const Intersection& intersection, Sampler& sampler, Ray& shadowRay, SpectralPacket& radiance, float& pdf) const
+	{
+		// sample point on lights which can illuminate the surface
+		LightSample light;
+		if (!tracer_.scene_->emitters().Sample(intersection.point, intersection.normal, sampler, light))
+		{
+			return false;
+		}
+
+		// direction to light
+		Vec3 toLight = light.point - intersection.point;
+		float distanceSquared = toLight.Dot(toLight);
+		float distance = std::sqrt(distanceSquared);
+
+		shadowRay = ray;
+		shadowRay.origin = intersection.point;
+		shadowRay.direction = toLight / distance;
+
+		// light must be in front of the surface and surface in front of the light
+		float cosLight = -shadowRay.direction.Dot(light.normal);
+		if ((cosLight <= 0.0f) || (shadowRay.direction.Dot(intersection.normal) <= 0.0f))
+		{
+			return false;
+		}
+
+		if (tracer_.scene_->Occluded(shadowRay, distance * (1.0f - ShadowRayEps)))
+		{
+			return false;
+		}
+
+		// emitted radiance towards the surface
+		Intersection lightIntersection;
+		lightIntersection.point = light.point;
+		lightIntersection.normal = light.normal;
+		lightIntersection.distance = distance;
+		lightIntersection.primitive = light.primitive;
+		tracer_.scene_->materialTable().GetRadiance(light.primitive->materialId(), shadowRay, lightIntersection, radiance);
+
+		// convert area density to solid angle density
+		pdf = light.pdf * distanceSquared / cosLight;
+		return true;
+	}
+
+	void IntegratorTask::SampleLight(const Ray& ray, const Intersection& intersection, MaterialId material, Sampler& sampler,
+		const SpectralPacket& weight, Vec3& color) const
+	{
+		static thread_local SpectralPacket bsdf(tracer_.spectrum_.count);
+		static thread_local SpectralPacket radiance(tracer_.spectrum_.count);
+
+		Ray shadowRay;
+		float pdf;
+		if (!SampleEmitter(ray, intersection, sampler, shadowRay, radiance, pdf))
+		{
+			return;
+		}
+
+		// BSDF times cosine at the surface
+		tracer_.scene_->materialTable().Evaluate(material, ray, intersection, shadowRay.direction, bsdf);
+		radiance.Multiply(bsdf);
+
+		AddRadiance(ray, radiance, weight, 1.0f / pdf, color);
+	}
+
+	void IntegratorTask::AddRadiance(const Ray& ray, const SpectralPacket& radiance, float scale, Vec3& color) const
+	{
+		const Spectrum& spectrum = tracer_.spectrum_;
+		const XYZTable& xyzTable = *tracer_.xyzTable_;
+		const WavelengthSampler& wavelengthSampler = *tracer_.wavelengthSampler_;
+
+		// the mean radiance of the spectrum, reduced with vector code
+		if (ray.IsFullSpectrum())
+		{
+			color += xyzTable.Reduce(radiance, scale);
+			return;
+		}
+
+		ray.ForEachWave(spectrum.count, [&](size_t t)
+		{
+			color += (radiance[t] * scale * wavelengthSampler.GetWeight(ray, t)) * xyzTable.GetXYZ(t);
+		});
+	}
+
+	void IntegratorTask::AddRadiance(const Ray& ray, const SpectralPacket& radiance, const SpectralPacket& weight, float scale, Vec3& color) const
+	{
+		const Spectrum& spectrum = tracer_.spectrum_;
+		const XYZTable& xyzTable = *tracer_.xyzTable_;
+		const WavelengthSampler& wavelengthSampler = *tracer_.wavelengthSampler_;
+
+		// the mean radiance of the spectrum, reduced with vector code
+		if (ray.IsFullSpectrum())
+		{
+			color += xyzTable.Reduce(radiance, weight, scale);
+			return;
+		}
+
+		ray.ForEachWave(spectrum.count, [&](size_t t)
+		{
+			color += (radiance[t] * weight[t] * scale * wavelengthSampler.GetWeight(ray, t)) * xyzTable.GetXYZ(t);
+		});
+	}
+
+	float IntegratorTask::GetThroughput(const Ray& ray, const SpectralPacket& weight) const
+	{
+		// the largest weight, so that paths are not terminated
+		// while any wave length is carrying energy
+		if (ray.IsFullSpectrum())
+		{
+			return weight.Max();
+		}
+
+		float throughput = 0.0f;
+		ray.ForEachWave(tracer_.spectrum_.count, [&](size_t t) { throughput = std::max(throughput, weight[t]); });
+		return throughput;
+	}
+
+}
@@ -0,0 +1,57 @@
+#ifndef SPT_INTEGRATOR_TASK_H
+#define SPT_INTEGRATOR_TASK_H
+
+#include "../stdafx.h"
+#include "../Material/MaterialId.h"
+#include "Task.h"
+
+namespace SPTracer
+{
+	struct Intersection;
+	struct Ray;
+	class PathStatistics;
+	class Sampler;
+	class SpectralPacket;
+	class Tracer;
+	class Vec3;
+
+	// Base of tasks rendering the image. Shares generation of camera rays,
+	// next event estimation on emitters and conversion of spectral radiance
+	// to XYZ color, so that all integrators weight wave lengths the same way.
+	class IntegratorTask : public Task
+	{
+	protected:
+		// relative shortening of shadow rays, so that the light itself is not an occluder
+		static const float ShadowRayEps;
+
+		explicit IntegratorTask(Tracer& tracer);
+
+		// primary rays through random points in pixels of the image row, rays carry full spectrum
+		void GenerateCameraRays(size_t row, Sampler& sampler, std::vector<Ray>& rays) const;
+
+		// traces camera path through glossy vertices to the first diffuse vertex, and adds emission found
+		// on the way to color (lights are not sampled at glossy vertices); returns false if the path ends
+		// earlier, otherwise ray reaching the diffuse vertex, its intersection and weight of the path
+		bool TraceToDiffuse(Ray& ray, Sampler& sampler, Intersection& intersection, SpectralPacket& weight,
+			Vec3& color, PathStatistics& pathStatistics) const;
+
+		// samples point on emitters which can illuminate the surface, and connects it by unoccluded
+		// shadow ray carrying wave lengths of the ray; radiance is emitted towards the surface and
+		// pdf is the solid angle density of the shadow ray direction
+		bool SampleEmitter(const Ray& ray, const Intersection& intersection, Sampler& sampler, Ray& shadowRay, SpectralPacket& radiance, float& pdf) const;
+
+		// direct light of emitters at the vertex, when light sampling is the only strategy for it
+		void SampleLight(const Ray& ray, const Intersection& intersection, MaterialId material, Sampler& sampler,
+			const SpectralPacket& weight, Vec3& color) const;
+
+		// adds spectral radiance to XYZ color, wave lengths carried by the ray are divided by the probability to be traced
+		void AddRadiance(const Ray& ray, const SpectralPacket& radiance, float scale, Vec3& color) const;
+		void AddRadiance(const Ray& ray, const SpectralPacket& radiance, const SpectralPacket& weight, float scale, Vec3& color) const;
+
+		// largest weight of the wave lengths carried by the ray
+		float GetThroughput(const Ray& ray, const SpectralPacket& weight) const;
+	};
+
+}
+
+#endif
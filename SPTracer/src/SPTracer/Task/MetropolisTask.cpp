@@ -0,0 +1,169 @@
+#include "../stdafx.h"
+#include "../Util.h"
+#include "../Camera/CameraModel.h"
+#include "../Camera/CameraSample.h"
+#include "../Color/Spectrum.h"
+#include "../Color/WavelengthSampler.h"
+#include "../Sampler/MetropolisSampler.h"
+#include "../Sampler/RandomSampler.h"
+#include "../Scene/Scene.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/PathStatistics.h"
+#include "../Tracer/Tracer.h"
+#include "TaskScheduler.h"
+#include "MetropolisTask.h"
+
+namespace SPTracer
+{
+
+	MetropolisTask::MetropolisTask(Tracer& tracer)
+		: TraceTask(tracer)
+	{
+	}
+
+	void MetropolisTask::Run()
+	{
+		// width and height
+		static const unsigned int width = tracer_.width_;
+		static const unsigned int height = tracer_.height_;
+
+		// mutations per task, one per pixel on average
+		static const size_t mutationCount = static_cast<size_t>(width) * height;
+
+		static thread_local std::vector<Vec3> color(width * height);
+		static thread_local PathStatistics pathStatistics;
+		static thread_local Chain chain;
+
+		// sampler for acceptance of mutations
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		// reset all colors
+		std::for_each(color.begin(), color.end(), [](Vec3& c) { c.Reset(); });
+		pathStatistics.Reset();
+
+		// the first task of the worker thread starts its chain
+		if (chain.sampler == nullptr)
+		{
+			StartChain(chain);
+		}
+
+		// nothing is found when scene is not lit
+		for (size_t i = 0; (i < mutationCount) && (chain.luminance > 0.0f); i++)
+		{
+			chain.sampler->StartIteration();
+
+			Vec3 proposed(0.0f, 0.0f, 0.0f);
+			size_t proposedPixel;
+			float luminance = TracePath(*chain.sampler, proposed, proposedPixel, pathStatistics);
+			float acceptProbability = std::min(1.0f, luminance / chain.luminance);
+
+			// both paths are splatted with the probability of the chain being in them,
+			// each visit of a path represents normalization divided by its luminance
+			if (acceptProbability > 0.0f)
+			{
+				color[proposedPixel] += proposed * (acceptProbability * chain.normalization / luminance);
+			}
+
+			if (acceptProbability < 1.0f)
+			{
+				color[chain.pixel] += chain.color * ((1.0f - acceptProbability) * chain.normalization / chain.luminance);
+			}
+
+			if (sampler.Get1D() < acceptProbability)
+			{
+				chain.color = proposed;
+				chain.pixel = proposedPixel;
+				chain.luminance = luminance;
+				chain.sampler->Accept();
+			}
+			else
+			{
+				chain.sampler->Reject();
+			}
+		}
+
+		// add another task
+		tracer_.taskScheduler_->AddTask(std::make_unique<MetropolisTask>(tracer_));
+
+		// add samples
+		tracer_.AddSamples(color, pathStatistics);
+	}
+
+	void MetropolisTask::StartChain(Chain& chain) const
+	{
+		static const RenderSettings& settings = tracer_.settings_;
+		static const size_t bootstrapSamples = std::max(settings.metropolisBootstrapSamples, 1u);
+
+		// bootstrap paths are not a part of the image
+		PathStatistics pathStatistics;
+
+		// every bootstrap path has its own seed, so that the chosen one can be traced again
+		unsigned int seed = static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max()));
+		std::vector<double> luminances(bootstrapSamples);
+		for (size_t i = 0; i < bootstrapSamples; i++)
+		{
+			MetropolisSampler sampler(seed + static_cast<unsigned int>(i), settings.metropolisSigma, settings.metropolisLargeStepProbability);
+			Vec3 color(0.0f, 0.0f, 0.0f);
+			size_t pixel;
+			luminances[i] = TracePath(sampler, color, pixel, pathStatistics);
+		}
+
+		// mean luminance of the image
+		std::partial_sum(luminances.begin(), luminances.end(), luminances.begin());
+		double total = luminances.back();
+		chain.normalization = static_cast<float>(total / bootstrapSamples);
+
+		// starting path is chosen proportionally to its luminance
+		double u = Util::RandFloat(0.0f, 1.0f) * total;
+		size_t index = std::min(static_cast<size_t>(std::upper_bound(luminances.begin(), luminances.end(), u) - luminances.begin()), bootstrapSamples - 1);
+
+		chain.sampler = std::make_unique<MetropolisSampler>(seed + static_cast<unsigned int>(index), settings.metropolisSigma, settings.metropolisLargeStepProbability);
+		chain.color = Vec3(0.0f, 0.0f, 0.0f);
+		chain.luminance = total > 0.0 ? TracePath(*chain.sampler, chain.color, chain.pixel, pathStatistics) : 0.0f;
+	}
+
+	float MetropolisTask::TracePath(MetropolisSampler& sampler, Vec3& color, size_t& pixel, PathStatistics& pathStatistics) const
+	{
+		// camera
+		static const CameraModel& camera = *tracer_.cameraModel_;
+
+		// width and height
+		static const unsigned int width = tracer_.width_;
+		static const unsigned int height = tracer_.height_;
+
+		// spectrum
+		static const Spectrum& spectrum = tracer_.spectrum_;
+
+		// wave lengths per path, 0 for full spectrum
+		static const int heroWavelengths = static_cast<int>(std::min(tracer_.settings_.heroWavelengths, spectrum.count));
+
+		// path tracing kernel for the render settings
+		static const TracePathFunction tracePath = SelectKernel();
+
+		// the first sample values choose position on the image
+		CameraSample s;
+		s.x = sampler.Get1D() * width;
+		s.y = sampler.Get1D() * height;
+		sampler.Get2D(s.lensU, s.lensV);
+		pixel = std::min(static_cast<size_t>(s.y), static_cast<size_t>(height) - 1) * width +
+			std::min(static_cast<size_t>(s.x), static_cast<size_t>(width) - 1);
+
+		Ray ray;
+		camera.GenerateRays(&s, 1, &ray);
+
+		// originally ray contains all spectrum or hero packet with random first wave length,
+		// small mutations of the sample value move the hero wave length to its neighbours
+		ray.waveIndex = -1;
+		ray.heroIndex = tracer_.wavelengthSampler_->SampleMonotonic(sampler.Get1D());
+		ray.waveCount = heroWavelengths;
+		ray.refracted = false;
+
+		Intersection primary;
+		bool found = tracer_.scene_->Intersect(ray, primary);
+		(this->*tracePath)(ray, found ? &primary : nullptr, 1.0f, sampler, color, pathStatistics);
+
+		// chain visits paths proportionally to luminance
+		return color[1] > 0.0f ? color[1] : 0.0f;
+	}
+
+}
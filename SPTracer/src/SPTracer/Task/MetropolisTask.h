@@ -0,0 +1,48 @@
+#ifndef SPT_METROPOLIS_TASK_H
+#define SPT_METROPOLIS_TASK_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "TraceTask.h"
+
+namespace SPTracer
+{
+	class MetropolisSampler;
+	class PathStatistics;
+	class Tracer;
+
+	// Primary sample space Metropolis light transport. Random numbers used by
+	// the path tracing kernel are mutated by a Markov chain, which visits
+	// paths proportionally to their luminance. Every worker thread runs its
+	// own chain, started from paths chosen among bootstrap samples, which
+	// also estimate the mean luminance of the image used for normalization.
+	// A task makes as many mutations as there are pixels and splats them
+	// into its own image, so that no locks are taken until it is added.
+	class MetropolisTask : public TraceTask
+	{
+	public:
+		explicit MetropolisTask(Tracer& tracer);
+
+		virtual void Run() override;
+
+	private:
+		// state of the chain of the worker thread
+		struct Chain
+		{
+			std::unique_ptr<MetropolisSampler> sampler;
+			Vec3 color;				// radiance of the current path
+			size_t pixel;			// pixel of the current path
+			float luminance;		// target function of the current path
+			float normalization;	// mean luminance of bootstrap paths
+		};
+
+		// chooses starting path proportionally to luminance of bootstrap paths
+		void StartChain(Chain& chain) const;
+
+		// traces path for sample values and returns its luminance
+		float TracePath(MetropolisSampler& sampler, Vec3& color, size_t& pixel, PathStatistics& pathStatistics) const;
+	};
+
+}
+
+#endif
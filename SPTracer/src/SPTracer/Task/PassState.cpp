@@ -0,0 +1,33 @@
+#include "../stdafx.h"
+#include "PassState.h"
+
+namespace SPTracer
+{
+
+	PassState::PassState(size_t pixelCount, unsigned int taskCount)
+		: image_(pixelCount, Vec3(0.0f, 0.0f, 0.0f)), work_(taskCount)
+	{
+	}
+
+	std::vector<Vec3>& PassState::image()
+	{
+		return image_;
+	}
+
+	PathStatistics& PassState::pathStatistics()
+	{
+		return pathStatistics_;
+	}
+
+	void PassState::MergePathStatistics(const PathStatistics& pathStatistics)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pathStatistics_.Merge(pathStatistics);
+	}
+
+	PhaseWork& PassState::work()
+	{
+		return work_;
+	}
+
+}
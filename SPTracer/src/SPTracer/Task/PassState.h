@@ -0,0 +1,39 @@
+#ifndef SPT_PASS_STATE_H
+#define SPT_PASS_STATE_H
+
+#include "../stdafx.h"
+#include "../Vec3.h"
+#include "../Tracer/PathStatistics.h"
+#include "PhaseWork.h"
+
+namespace SPTracer
+{
+
+	// State of the current pass of integrators whose passes are split into
+	// phases. Image and path statistics of the pass are collected by the tasks
+	// of all phases and added to the tracer when the last phase completes.
+	class PassState
+	{
+	public:
+		PassState(size_t pixelCount, unsigned int taskCount);
+
+		// light found by camera paths during the pass, in XYZ
+		std::vector<Vec3>& image();
+
+		// lengths of camera paths during the pass
+		PathStatistics& pathStatistics();
+		void MergePathStatistics(const PathStatistics& pathStatistics);
+
+		// work of the current phase
+		PhaseWork& work();
+
+	private:
+		std::vector<Vec3> image_;
+		PathStatistics pathStatistics_;
+		std::mutex mutex_;
+		PhaseWork work_;
+	};
+
+}
+
+#endif
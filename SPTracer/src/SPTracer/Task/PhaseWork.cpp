@@ -0,0 +1,31 @@
+#include "../stdafx.h"
+#include "PhaseWork.h"
+
+namespace SPTracer
+{
+
+	PhaseWork::PhaseWork(unsigned int taskCount)
+		: taskCount_(taskCount), nextItem_(0), completedTasks_(0)
+	{
+	}
+
+	bool PhaseWork::GetWork(size_t count, size_t& item)
+	{
+		item = nextItem_.fetch_add(1);
+		return item < count;
+	}
+
+	bool PhaseWork::CompleteTask()
+	{
+		if (completedTasks_.fetch_add(1) + 1 < taskCount_)
+		{
+			return false;
+		}
+
+		// all tasks of the phase are done, the next phase starts from the first item
+		completedTasks_ = 0;
+		nextItem_ = 0;
+		return true;
+	}
+
+}
@@ -0,0 +1,44 @@
+#ifndef SPT_PHASE_WORK_H
+#define SPT_PHASE_WORK_H
+
+#include "../stdafx.h"
+#include "TaskScheduler.h"
+
+namespace SPTracer
+{
+
+	class Tracer;
+
+	// Work of a phase shared by a fixed number of tasks. Tasks take items
+	// until all of them are taken, and the last task to complete the phase
+	// is told so, so that it can start the next phase.
+	class PhaseWork
+	{
+	public:
+		explicit PhaseWork(unsigned int taskCount);
+
+		// takes next item of the current phase, returns false when all count items are taken
+		bool GetWork(size_t count, size_t& item);
+
+		// called by every task at the end of phase, returns true for the last one
+		bool CompleteTask();
+
+		// schedules the tasks sharing the work of the phase
+		template <class PhaseTask, class Phase>
+		void AddTasks(TaskScheduler& taskScheduler, Tracer& tracer, Phase phase) const
+		{
+			for (unsigned int i = 0; i < taskCount_; i++)
+			{
+				taskScheduler.AddTask(std::make_unique<PhaseTask>(tracer, phase));
+			}
+		}
+
+	private:
+		const unsigned int taskCount_;
+		std::atomic<size_t> nextItem_;
+		std::atomic<unsigned int> completedTasks_;
+	};
+
+}
+
+#endif
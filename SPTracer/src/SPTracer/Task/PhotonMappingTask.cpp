@@ -0,0 +1,303 @@
+#include "../stdafx.h"
+#include "../Frame.h"
+#include "../Util.h"
+#include "../Color/SpectralPacket.h"
+#include "../Color/Spectrum.h"
+#include "../Color/WavelengthSampler.h"
+#include "../Color/XYZConverter.h"
+#include "../Color/XYZTable.h"
+#include "../Light/EmitterTable.h"
+#include "../Light/LightSample.h"
+#include "../Material/MaterialTable.h"
+#include "../Photon/ProgressivePhotonMap.h"
+#include "../Scene/Scene.h"
+#include "../Primitive/Primitive.h"
+#include "../Sampler/RandomSampler.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/PathStatistics.h"
+#include "../Tracer/Ray.h"
+#include "../Tracer/Tracer.h"
+#include "PassState.h"
+#include "TaskScheduler.h"
+#include "PhotonMappingTask.h"
+
+namespace SPTracer
+{
+
+	const size_t PhotonMappingTask::PhotonBatchSize = 1024;
+
+	PhotonMappingTask::PhotonMappingTask(Tracer& tracer, Phase phase)
+		: IntegratorTask(tracer), phase_(phase)
+	{
+	}
+
+	void PhotonMappingTask::Run()
+	{
+		switch (phase_)
+		{
+		case Phase::VisiblePoints:
+			TraceVisiblePoints();
+			break;
+
+		case Phase::Photons:
+			TracePhotons();
+			break;
+		}
+	}
+
+	void PhotonMappingTask::TraceVisiblePoints()
+	{
+		// width and height
+		static const unsigned int width = tracer_.width_;
+		static const unsigned int height = tracer_.height_;
+
+		static ProgressivePhotonMap& photonMap = *tracer_.photonMap_;
+		static PassState& pass = *tracer_.passState_;
+		static thread_local PathStatistics pathStatistics;
+
+		// primary rays of one image row
+		static thread_local std::vector<Ray> cameraRays(width);
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		pathStatistics.Reset();
+
+		size_t i;
+		while (pass.work().GetWork(height, i))
+		{
+			// generate primary rays for the row
+			GenerateCameraRays(i, sampler, cameraRays);
+
+			for (size_t j = 0; j < width; j++)
+			{
+				// visible points are weighted by all wave lengths,
+				// so that photons can carry any of them
+				Ray ray = cameraRays[j];
+
+				size_t pixel = i * width + j;
+				Vec3& color = pass.image()[pixel];
+				color.Reset();
+
+				TraceCameraPath(ray, sampler, photonMap.visiblePoint(pixel), color, pathStatistics);
+			}
+		}
+
+		pass.MergePathStatistics(pathStatistics);
+		if (!pass.work().CompleteTask())
+		{
+			return;
+		}
+
+		// all visible points are found
+		photonMap.BuildGrid();
+		pass.work().AddTasks<PhotonMappingTask>(*tracer_.taskScheduler_, tracer_, Phase::Photons);
+	}
+
+	void PhotonMappingTask::TracePhotons()
+	{
+		static ProgressivePhotonMap& photonMap = *tracer_.photonMap_;
+		static PassState& pass = *tracer_.passState_;
+		static const size_t photonCount = photonMap.photonsPerIteration();
+		static const size_t batchCount = (photonCount + PhotonBatchSize - 1) / PhotonBatchSize;
+		static const bool emitters = !tracer_.scene_->emitters().empty();
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		size_t batch;
+		while (pass.work().GetWork(batchCount, batch))
+		{
+			size_t count = std::min(PhotonBatchSize, photonCount - batch * PhotonBatchSize);
+			for (size_t i = 0; emitters && (i < count); i++)
+			{
+				TracePhoton(sampler);
+			}
+		}
+
+		if (!pass.work().CompleteTask())
+		{
+			return;
+		}
+
+		// image must not be updated while radii are reduced
+		{
+			std::lock_guard<std::mutex> lock(tracer_.mutex_);
+			photonMap.Update();
+		}
+
+		// direct light of the iteration is one pass of the image
+		tracer_.AddSamples(pass.image(), pass.pathStatistics());
+		pass.pathStatistics().Reset();
+
+		// next iteration
+		pass.work().AddTasks<PhotonMappingTask>(*tracer_.taskScheduler_, tracer_, Phase::VisiblePoints);
+	}
+
+	void PhotonMappingTask::TraceCameraPath(Ray ray, Sampler& sampler, ProgressivePhotonMap::VisiblePoint& visiblePoint,
+		Vec3& color, PathStatistics& pathStatistics) const
+	{
+		static const MaterialTable& materials = tracer_.scene_->materialTable();
+		static const size_t spectrumCount = tracer_.spectrum_.count;
+
+		static thread_local SpectralPacket weight(tracer_.spectrum_.count);
+
+		visiblePoint.valid = false;
+
+		Intersection intersection;
+		if (!TraceToDiffuse(ray, sampler, intersection, weight, color, pathStatistics))
+		{
+			return;
+		}
+
+		// diffuse vertex gets direct light by light sampling and indirect light from photons
+		MaterialId material = intersection.primitive->materialId();
+		SampleLight(ray, intersection, material, sampler, weight, color);
+
+		const MaterialRecord& m = materials.record(material);
+		visiblePoint.point = intersection.point;
+		visiblePoint.normal = intersection.normal;
+		for (size_t t = 0; t < spectrumCount; t++)
+		{
+			visiblePoint.weight[t] = weight[t] * m.diffuseReflectance[t] / Util::Pi;
+		}
+		visiblePoint.valid = true;
+	}
+
+	void PhotonMappingTask::TracePhoton(Sampler& sampler) const
+	{
+		static const Scene& scene = *tracer_.scene_;
+		static const MaterialTable& materials = scene.materialTable();
+		static const EmitterTable& emitters = scene.emitters();
+		static const Spectrum& spectrum = tracer_.spectrum_;
+		static const XYZTable& xyzTable = *tracer_.xyzTable_;
+		static const WavelengthSampler& wavelengthSampler = *tracer_.wavelengthSampler_;
+		static const int heroWavelengths = static_cast<int>(std::min(tracer_.settings_.heroWavelengths, spectrum.count));
+		static const size_t maxDepth = tracer_.settings_.maxDepth;
+		static const bool russianRoulette = tracer_.settings_.russianRoulette;
+		static const size_t rouletteDepth = tracer_.settings_.rouletteDepth;
+		static ProgressivePhotonMap& photonMap = *tracer_.photonMap_;
+
+		static thread_local SpectralPacket reflectance(tracer_.spectrum_.count);
+		static thread_local SpectralPacket power(tracer_.spectrum_.count);
+
+		// point on lights
+		LightSample light;
+		emitters.SampleEmission(sampler, light);
+
+		Intersection lightIntersection;
+		lightIntersection.point = light.point;
+		lightIntersection.normal = light.normal;
+		lightIntersection.frame = Frame(light.normal);
+		lightIntersection.distance = 0.0f;
+		lightIntersection.primitive = light.primitive;
+		MaterialId lightMaterial = light.primitive->materialId();
+
+		// photon carries hero packet with random first wave length, or all spectrum
+		Ray ray;
+		ray.origin = light.point;
+		ray.direction = materials.SampleEmission(lightMaterial, lightIntersection, sampler);
+		ray.waveIndex = -1;
+		ray.heroIndex = tracer_.wavelengthSampler_->Sample(sampler.Get1D());
+		ray.waveCount = heroWavelengths;
+		ray.refracted = false;
+
+		float pdf = materials.GetEmissionPdf(lightMaterial, lightIntersection, ray.direction);
+		float cosTheta = light.normal.Dot(ray.direction);
+		if ((pdf <= 0.0f) || (cosTheta <= 0.0f))
+		{
+			return;
+		}
+
+		// emitted radiance times cosine, divided by densities of point and direction
+		Ray toLight = ray;
+		toLight.direction = -ray.direction;
+		materials.GetRadiance(lightMaterial, toLight, lightIntersection, power);
+		float scale = cosTheta / (light.pdf * pdf);
+		ray.ForEachWave(spectrum.count, [&](size_t t) { power[t] *= scale; });
+
+		// Russian roulette uses throughput relative to the emitted power
+		float throughput = GetThroughput(ray, power);
+		float throughputScale = throughput > 0.0f ? 1.0f / throughput : 0.0f;
+
+		// number of bounces
+		size_t depth = 0;
+
+		while (true)
+		{
+			// try to find intersection
+			Intersection intersection;
+			if (!scene.Intersect(ray, intersection))
+			{
+				break;
+			}
+
+			MaterialId material = intersection.primitive->materialId();
+
+			// direct light is found by light sampling at visible points
+			if ((depth > 0) && (materials.record(material).type == MaterialType::Lambertian))
+			{
+				photonMap.ForEachVisiblePoint(intersection.point, [&](size_t pixel, const ProgressivePhotonMap::VisiblePoint& v)
+				{
+					// photon must arrive to the front side of the visible point
+					if (v.normal.Dot(ray.direction) >= 0.0f)
+					{
+						return;
+					}
+
+					Vec3 flux(0.0f, 0.0f, 0.0f);
+					ray.ForEachWave(spectrum.count, [&](size_t t)
+					{
+						flux += (power[t] * v.weight[t] * wavelengthSampler.GetWeight(ray, t)) * xyzTable.GetXYZ(t);
+					});
+					photonMap.AddFlux(pixel, flux);
+				});
+			}
+
+			// check if material is reflective and path can be extended
+			if (!materials.IsReflective(material) || ((maxDepth != 0) && (depth >= maxDepth)))
+			{
+				break;
+			}
+
+			// preserve wave lengths of the photon
+			Ray newRay;
+			newRay.refracted = ray.refracted;
+			newRay.waveIndex = ray.waveIndex;
+			newRay.heroIndex = ray.heroIndex;
+			newRay.waveCount = ray.waveCount;
+
+			if (!materials.Sample(material, ray, intersection, sampler, newRay))
+			{
+				break;
+			}
+
+			pdf = materials.GetPdf(material, ray, intersection, newRay.direction);
+			if (pdf <= 0.0f)
+			{
+				break;
+			}
+
+			// scattered power is adjoint BSDF times cosine of the new direction
+			materials.EvaluateAdjoint(material, ray, intersection, newRay.direction, reflectance);
+			ray.ForEachWave(spectrum.count, [&](size_t t) { power[t] *= reflectance[t] / pdf; });
+			depth++;
+
+			// Russian roulette: continue with probability of the photon throughput
+			if (russianRoulette && (depth >= rouletteDepth))
+			{
+				float continueProbability = std::min(GetThroughput(ray, power) * throughputScale, 1.0f);
+				if (sampler.Get1D() >= continueProbability)
+				{
+					break;
+				}
+
+				// survived photon compensates for terminated photons
+				ray.ForEachWave(spectrum.count, [&](size_t t) { power[t] /= continueProbability; });
+			}
+
+			std::swap(ray, newRay);
+		}
+	}
+
+}
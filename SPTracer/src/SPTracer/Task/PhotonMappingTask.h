@@ -0,0 +1,58 @@
+#ifndef SPT_PHOTON_MAPPING_TASK_H
+#define SPT_PHOTON_MAPPING_TASK_H
+
+#include "../stdafx.h"
+#include "../Color/SpectralPacket.h"
+#include "../Material/MaterialId.h"
+#include "../Photon/ProgressivePhotonMap.h"
+#include "IntegratorTask.h"
+
+namespace SPTracer
+{
+	struct Intersection;
+	struct Ray;
+	class PathStatistics;
+	class Sampler;
+	class Tracer;
+
+	// Stochastic progressive photon mapping. Camera paths are traced through
+	// glossy surfaces to the first diffuse vertex, where direct light is sampled
+	// and visible point of the pixel is stored. Photons shot from lights add
+	// indirect light to visible points they hit. Tasks of a phase share its work,
+	// the last task to finish starts tasks of the next phase.
+	class PhotonMappingTask : public IntegratorTask
+	{
+	public:
+		enum class Phase
+		{
+			VisiblePoints,
+			Photons
+		};
+
+		PhotonMappingTask(Tracer& tracer, Phase phase);
+
+		virtual void Run() override;
+
+	private:
+		// photons traced at once by a task
+		static const size_t PhotonBatchSize;
+
+		Phase phase_;
+
+		// traces camera paths of image rows, and starts photon phase when all rows are done
+		void TraceVisiblePoints();
+
+		// traces batches of photons, and ends iteration when all photons are done
+		void TracePhotons();
+
+		// traces camera path until visible point, adds light found on the way to color
+		void TraceCameraPath(Ray ray, Sampler& sampler, ProgressivePhotonMap::VisiblePoint& visiblePoint,
+			Vec3& color, PathStatistics& pathStatistics) const;
+
+		// traces photon from lights, and adds its flux to visible points around every diffuse hit
+		void TracePhoton(Sampler& sampler) const;
+	};
+
+}
+
+#endif
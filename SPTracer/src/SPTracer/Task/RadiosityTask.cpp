@@ -0,0 +1,218 @@
+#include "../stdafx.h"
+#include "../Frame.h"
+#include "../Log.h"
+#include "../Util.h"
+#include "../Color/SpectralPacket.h"
+#include "../Color/Spectrum.h"
+#include "../Color/XYZConverter.h"
+#include "../Light/EmitterTable.h"
+#include "../Material/MaterialTable.h"
+#include "../Radiosity/RadiositySolver.h"
+#include "../Scene/Scene.h"
+#include "../Primitive/Primitive.h"
+#include "../Sampler/RandomSampler.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/PathStatistics.h"
+#include "../Tracer/Ray.h"
+#include "../Tracer/Tracer.h"
+#include "TaskScheduler.h"
+#include "RadiosityTask.h"
+
+namespace SPTracer
+{
+
+	const size_t RadiosityTask::PatchBatchSize = 64;
+
+	RadiosityTask::RadiosityTask(Tracer& tracer, Phase phase)
+		: IntegratorTask(tracer), phase_(phase)
+	{
+	}
+
+	void RadiosityTask::Run()
+	{
+		switch (phase_)
+		{
+		case Phase::FormFactors:
+			ComputeFormFactors();
+			break;
+
+		case Phase::Iterations:
+			Iterate();
+			break;
+
+		case Phase::Image:
+			TraceImage();
+			break;
+		}
+	}
+
+	void RadiosityTask::ComputeFormFactors()
+	{
+		static RadiositySolver& solver = *tracer_.radiositySolver_;
+		static const size_t batchCount = (solver.patchCount() + PatchBatchSize - 1) / PatchBatchSize;
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		size_t batch;
+		while (solver.work().GetWork(batchCount, batch))
+		{
+			size_t last = std::min((batch + 1) * PatchBatchSize, solver.patchCount());
+			for (size_t i = batch * PatchBatchSize; i < last; i++)
+			{
+				solver.ComputeFormFactors(i, sampler);
+			}
+		}
+
+		if (!solver.work().CompleteTask())
+		{
+			return;
+		}
+
+		Phase next = solver.iterationCount() > 0 ? Phase::Iterations : Phase::Image;
+		solver.work().AddTasks<RadiosityTask>(*tracer_.taskScheduler_, tracer_, next);
+	}
+
+	void RadiosityTask::Iterate()
+	{
+		static RadiositySolver& solver = *tracer_.radiositySolver_;
+		static const size_t batchCount = (solver.patchCount() + PatchBatchSize - 1) / PatchBatchSize;
+
+		size_t batch;
+		while (solver.work().GetWork(batchCount, batch))
+		{
+			size_t last = std::min((batch + 1) * PatchBatchSize, solver.patchCount());
+			for (size_t i = batch * PatchBatchSize; i < last; i++)
+			{
+				solver.Iterate(i);
+			}
+		}
+
+		if (!solver.work().CompleteTask())
+		{
+			return;
+		}
+
+		// radiosity of all patches is computed
+		solver.CompleteIteration();
+		if (solver.iteration() < solver.iterationCount())
+		{
+			solver.work().AddTasks<RadiosityTask>(*tracer_.taskScheduler_, tracer_, Phase::Iterations);
+			return;
+		}
+
+		Log::Info("RadiosityTask: Radiosity of " + std::to_string(solver.patchCount()) + " patches solved in " +
+			std::to_string(solver.iteration()) + " iterations");
+		solver.work().AddTasks<RadiosityTask>(*tracer_.taskScheduler_, tracer_, Phase::Image);
+	}
+
+	void RadiosityTask::TraceImage()
+	{
+		// width and height
+		static const unsigned int width = tracer_.width_;
+		static const unsigned int height = tracer_.height_;
+
+		static thread_local std::vector<Vec3> color(width * height);
+		static thread_local PathStatistics pathStatistics;
+
+		// primary rays of one image row
+		static thread_local std::vector<Ray> cameraRays(width);
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		// reset all colors
+		std::for_each(color.begin(), color.end(), [](Vec3& c) { c.Reset(); });
+		pathStatistics.Reset();
+
+		for (size_t i = 0; i < height; i++)
+		{
+			// generate primary rays for the row
+			GenerateCameraRays(i, sampler, cameraRays);
+
+			for (size_t j = 0; j < width; j++)
+			{
+				// radiosity is solved for all wave lengths, so paths carry full spectrum
+				Ray ray = cameraRays[j];
+
+				TraceCameraPath(ray, sampler, color[i * width + j], pathStatistics);
+			}
+		}
+
+		// add another task
+		tracer_.taskScheduler_->AddTask(std::make_unique<RadiosityTask>(tracer_, Phase::Image));
+
+		// add samples
+		tracer_.AddSamples(color, pathStatistics);
+	}
+
+	void RadiosityTask::TraceCameraPath(Ray ray, Sampler& sampler, Vec3& color, PathStatistics& pathStatistics) const
+	{
+		static const RadiositySolver& solver = *tracer_.radiositySolver_;
+		static const bool finalGather = tracer_.settings_.radiosityFinalGather;
+
+		static thread_local SpectralPacket radiance(tracer_.spectrum_.count);
+		static thread_local SpectralPacket weight(tracer_.spectrum_.count);
+
+		Intersection intersection;
+		if (!TraceToDiffuse(ray, sampler, intersection, weight, color, pathStatistics))
+		{
+			return;
+		}
+
+		// diffuse vertex shows radiosity of its patch, or gathers it
+		size_t patch = finalGather ? RadiositySolver::NoPatch : solver.FindPatch(ray, intersection);
+		if (patch != RadiositySolver::NoPatch)
+		{
+			solver.GetRadiance(patch, radiance);
+			AddRadiance(ray, radiance, weight, 1.0f, color);
+		}
+		else
+		{
+			MaterialId material = intersection.primitive->materialId();
+			SampleLight(ray, intersection, material, sampler, weight, color);
+			GatherRadiance(ray, intersection, material, sampler, weight, color);
+		}
+	}
+
+	void RadiosityTask::GatherRadiance(const Ray& ray, const Intersection& intersection, MaterialId material, Sampler& sampler,
+		const SpectralPacket& weight, Vec3& color) const
+	{
+		const Scene& scene = *tracer_.scene_;
+		const RadiositySolver& solver = *tracer_.radiositySolver_;
+
+		static thread_local SpectralPacket radiance(tracer_.spectrum_.count);
+		static thread_local SpectralPacket gatherWeight(tracer_.spectrum_.count);
+
+		// cosine distributed direction, BSDF times cosine divided by density is reflectance
+		float phi = 2.0f * Util::Pi * sampler.Get1D();
+		float cosTheta = std::sqrt(sampler.Get1D());
+
+		Ray gatherRay = ray;
+		gatherRay.origin = intersection.point;
+		gatherRay.direction = Frame(intersection.normal).ToWorld(Vec3::FromPhiTheta(phi, cosTheta));
+
+		// light reflected by patches, direct light is already sampled
+		Intersection gatherIntersection;
+		if (!scene.Intersect(gatherRay, gatherIntersection))
+		{
+			return;
+		}
+
+		size_t patch = solver.FindPatch(gatherRay, gatherIntersection);
+		if (patch == RadiositySolver::NoPatch)
+		{
+			return;
+		}
+
+		const SpectralPacket& diffuseReflectance = scene.materialTable().record(material).diffuseReflectance;
+		for (size_t t = 0; t < gatherWeight.size(); t++)
+		{
+			gatherWeight[t] = weight[t] * diffuseReflectance[t];
+		}
+
+		solver.GetRadiance(patch, radiance);
+		AddRadiance(ray, radiance, gatherWeight, 1.0f, color);
+	}
+
+}
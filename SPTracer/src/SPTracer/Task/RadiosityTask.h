@@ -0,0 +1,61 @@
+#ifndef SPT_RADIOSITY_TASK_H
+#define SPT_RADIOSITY_TASK_H
+
+#include "../stdafx.h"
+#include "../Color/SpectralPacket.h"
+#include "../Material/MaterialId.h"
+#include "IntegratorTask.h"
+
+namespace SPTracer
+{
+	struct Intersection;
+	struct Ray;
+	class PathStatistics;
+	class Sampler;
+	class Tracer;
+
+	// Rendering with precomputed radiosity. Form factors and radiosity of
+	// patches are computed first, by tasks sharing the work of the phase.
+	// Then camera paths are traced through glossy surfaces to the first
+	// diffuse vertex, which shows radiance of its patch, or gathers it with
+	// one diffuse bounce after direct light is sampled.
+	class RadiosityTask : public IntegratorTask
+	{
+	public:
+		enum class Phase
+		{
+			FormFactors,
+			Iterations,
+			Image
+		};
+
+		RadiosityTask(Tracer& tracer, Phase phase);
+
+		virtual void Run() override;
+
+	private:
+		// patches processed at once by a task
+		static const size_t PatchBatchSize;
+
+		Phase phase_;
+
+		// estimates form factors of patch batches, and starts iterations when all patches are done
+		void ComputeFormFactors();
+
+		// iterates radiosity of patch batches, and starts the next iteration or the image
+		void Iterate();
+
+		// traces pass of the image
+		void TraceImage();
+
+		// traces camera path until diffuse vertex, adds light found on the way to color
+		void TraceCameraPath(Ray ray, Sampler& sampler, Vec3& color, PathStatistics& pathStatistics) const;
+
+		// reflected radiance at diffuse vertex, gathered from patches seen by cosine distributed ray
+		void GatherRadiance(const Ray& ray, const Intersection& intersection, MaterialId material, Sampler& sampler,
+			const SpectralPacket& weight, Vec3& color) const;
+	};
+
+}
+
+#endif
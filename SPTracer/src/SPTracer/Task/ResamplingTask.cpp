@@ -0,0 +1,397 @@
+#include "../stdafx.h"
+#include "../Frame.h"
+#include "../Util.h"
+#include "../Color/SpectralPacket.h"
+#include "../Color/Spectrum.h"
+#include "../Color/XYZConverter.h"
+#include "../Light/EmitterTable.h"
+#include "../Light/LightSample.h"
+#include "../Material/MaterialTable.h"
+#include "../Scene/Scene.h"
+#include "../Primitive/Primitive.h"
+#include "../Sampler/RandomSampler.h"
+#include "../Tracer/Intersection.h"
+#include "../Tracer/PathStatistics.h"
+#include "../Tracer/Ray.h"
+#include "../Tracer/Tracer.h"
+#include "PassState.h"
+#include "TaskScheduler.h"
+#include "ResamplingTask.h"
+
+namespace SPTracer
+{
+
+	const float ResamplingTask::NormalThreshold = 0.9f;
+	const float ResamplingTask::DistanceThreshold = 0.1f;
+	const float ResamplingTask::TemporalCountLimit = 20.0f;
+
+	ResamplingTask::ResamplingTask(Tracer& tracer, Phase phase)
+		: IntegratorTask(tracer), phase_(phase)
+	{
+	}
+
+	void ResamplingTask::Run()
+	{
+		switch (phase_)
+		{
+		case Phase::Candidates:
+			TraceCandidates();
+			break;
+
+		case Phase::Reuse:
+			TraceReuse();
+			break;
+		}
+	}
+
+	void ResamplingTask::TraceCandidates()
+	{
+		// width and height
+		static const unsigned int width = tracer_.width_;
+		static const unsigned int height = tracer_.height_;
+
+		static PixelReservoirs& reservoirs = *tracer_.pixelReservoirs_;
+		static PassState& pass = *tracer_.passState_;
+		static const bool temporalReuse = tracer_.settings_.restirTemporalReuse;
+		static const float countLimit = TemporalCountLimit * std::max(tracer_.settings_.restirCandidates, 1u);
+		static thread_local PathStatistics pathStatistics;
+
+		// primary rays of one image row
+		static thread_local std::vector<Ray> cameraRays(width);
+
+		// current and previous reservoirs of the pixel
+		static thread_local std::vector<const PixelReservoirs::Pixel*> pixels;
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		pathStatistics.Reset();
+
+		size_t i;
+		while (pass.work().GetWork(height, i))
+		{
+			// generate primary rays for the row
+			GenerateCameraRays(i, sampler, cameraRays);
+
+			for (size_t j = 0; j < width; j++)
+			{
+				// samples are reused by pixels with other wave lengths, so rays carry full spectrum
+				Ray ray = cameraRays[j];
+
+				size_t index = i * width + j;
+				PixelReservoirs::Pixel& pixel = reservoirs.initial(index);
+				Vec3& color = pass.image()[index];
+				color.Reset();
+
+				TraceSurface(ray, pixel, color);
+				pathStatistics.Add(0);
+				if (!pixel.valid)
+				{
+					continue;
+				}
+
+				SampleCandidates(pixel, sampler);
+
+				// reservoir of the previous pass, when the pixel sees the same surface
+				PixelReservoirs::Pixel& previous = reservoirs.shaded(index);
+				if (temporalReuse && previous.valid && IsSimilar(pixel, previous))
+				{
+					previous.reservoir.count = std::min(previous.reservoir.count, countLimit);
+
+					pixels.clear();
+					pixels.push_back(&pixel);
+					pixels.push_back(&previous);
+
+					Reservoir reservoir;
+					Merge(pixels, sampler, reservoir);
+					pixel.reservoir = reservoir;
+				}
+			}
+		}
+
+		pass.MergePathStatistics(pathStatistics);
+		if (!pass.work().CompleteTask())
+		{
+			return;
+		}
+
+		// all surfaces have candidates
+		pass.work().AddTasks<ResamplingTask>(*tracer_.taskScheduler_, tracer_, Phase::Reuse);
+	}
+
+	void ResamplingTask::TraceReuse()
+	{
+		// width and height
+		static const int width = static_cast<int>(tracer_.width_);
+		static const int height = static_cast<int>(tracer_.height_);
+
+		static PixelReservoirs& reservoirs = *tracer_.pixelReservoirs_;
+		static PassState& pass = *tracer_.passState_;
+		static const unsigned int neighbourCount = tracer_.settings_.restirSpatialNeighbors;
+		static const float radius = tracer_.settings_.restirSpatialRadius;
+
+		// the pixel and its neighbours
+		static thread_local std::vector<const PixelReservoirs::Pixel*> pixels;
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
+
+		size_t i;
+		while (pass.work().GetWork(height, i))
+		{
+			for (int j = 0; j < width; j++)
+			{
+				size_t index = i * width + static_cast<size_t>(j);
+				const PixelReservoirs::Pixel& pixel = reservoirs.initial(index);
+				PixelReservoirs::Pixel& shaded = reservoirs.shaded(index);
+				shaded.valid = pixel.valid;
+				if (!pixel.valid)
+				{
+					continue;
+				}
+
+				pixels.clear();
+				pixels.push_back(&pixel);
+
+				// random neighbours in disk around the pixel
+				for (unsigned int k = 0; k < neighbourCount; k++)
+				{
+					float r = radius * std::sqrt(sampler.Get1D());
+					float phi = 2.0f * Util::Pi * sampler.Get1D();
+					int x = j + static_cast<int>(std::round(r * std::cos(phi)));
+					int y = static_cast<int>(i) + static_cast<int>(std::round(r * std::sin(phi)));
+					if ((x < 0) || (x >= width) || (y < 0) || (y >= height) || ((x == j) && (y == static_cast<int>(i))))
+					{
+						continue;
+					}
+
+					const PixelReservoirs::Pixel& neighbour = reservoirs.initial(static_cast<size_t>(y * width + x));
+					if (neighbour.valid && IsSimilar(pixel, neighbour))
+					{
+						pixels.push_back(&neighbour);
+					}
+				}
+
+				shaded.ray = pixel.ray;
+				shaded.intersection = pixel.intersection;
+				shaded.material = pixel.material;
+				Merge(pixels, sampler, shaded.reservoir);
+
+				Shade(shaded, pass.image()[index]);
+			}
+		}
+
+		if (!pass.work().CompleteTask())
+		{
+			return;
+		}
+
+		// image of the pass is complete
+		tracer_.AddSamples(pass.image(), pass.pathStatistics());
+		pass.pathStatistics().Reset();
+
+		// next pass
+		pass.work().AddTasks<ResamplingTask>(*tracer_.taskScheduler_, tracer_, Phase::Candidates);
+	}
+
+	void ResamplingTask::TraceSurface(Ray ray, PixelReservoirs::Pixel& pixel, Vec3& color) const
+	{
+		static const Scene& scene = *tracer_.scene_;
+		static const MaterialTable& materials = scene.materialTable();
+
+		static thread_local SpectralPacket radiance(tracer_.spectrum_.count);
+
+		pixel.valid = false;
+		pixel.reservoir.Reset();
+
+		Intersection intersection;
+		if (!scene.Intersect(ray, intersection))
+		{
+			return;
+		}
+
+		// light seen directly
+		MaterialId material = intersection.primitive->materialId();
+		if (materials.IsEmissive(material))
+		{
+			materials.GetRadiance(material, ray, intersection, radiance);
+			AddRadiance(ray, radiance, 1.0f, color);
+		}
+
+		// only reflective surfaces get light samples
+		if (!materials.IsReflective(material))
+		{
+			return;
+		}
+
+		pixel.ray = ray;
+		pixel.intersection = intersection;
+		pixel.material = material;
+		pixel.valid = true;
+	}
+
+	void ResamplingTask::SampleCandidates(PixelReservoirs::Pixel& pixel, Sampler& sampler) const
+	{
+		static const EmitterTable& emitters = tracer_.scene_->emitters();
+		static const unsigned int candidateCount = std::max(tracer_.settings_.restirCandidates, 1u);
+
+		static thread_local SpectralPacket contribution(tracer_.spectrum_.count);
+
+		// candidates are resampled by unshadowed contribution
+		Reservoir& reservoir = pixel.reservoir;
+		for (unsigned int i = 0; i < candidateCount; i++)
+		{
+			LightSample sample;
+			if (!emitters.Sample(pixel.intersection.point, pixel.intersection.normal, sampler, sample))
+			{
+				continue;
+			}
+
+			float target = GetTarget(pixel, sample, contribution);
+			if (sample.pdf > 0.0f)
+			{
+				reservoir.Update(sample, target, target / sample.pdf, sampler.Get1D());
+			}
+		}
+
+		reservoir.count = static_cast<float>(candidateCount);
+		reservoir.Finalize(reservoir.count);
+	}
+
+	void ResamplingTask::Merge(const std::vector<const PixelReservoirs::Pixel*>& pixels, Sampler& sampler, Reservoir& reservoir) const
+	{
+		static const bool unbiased = tracer_.settings_.restirUnbiased;
+
+		static thread_local SpectralPacket contribution(tracer_.spectrum_.count);
+
+		// samples are resampled by target function of the first surface,
+		// times their contribution weights and numbers of candidates
+		const PixelReservoirs::Pixel& pixel = *pixels[0];
+		Reservoir result;
+		result.Reset();
+		for (const PixelReservoirs::Pixel* p : pixels)
+		{
+			const Reservoir& r = p->reservoir;
+			if (r.weight > 0.0f)
+			{
+				float target = GetTarget(pixel, r.sample, contribution);
+				result.Update(r.sample, target, target * r.weight * r.count, sampler.Get1D());
+			}
+
+			result.count += r.count;
+		}
+
+		// unbiased normalization counts only candidates of surfaces,
+		// where the selected sample has nonzero target function
+		float normalization = result.count;
+		if (unbiased && (result.target > 0.0f))
+		{
+			normalization = pixel.reservoir.count;
+			for (size_t i = 1; i < pixels.size(); i++)
+			{
+				if (GetTarget(*pixels[i], result.sample, contribution) > 0.0f)
+				{
+					normalization += pixels[i]->reservoir.count;
+				}
+			}
+		}
+
+		result.Finalize(normalization);
+		reservoir = result;
+	}
+
+	bool ResamplingTask::IsSimilar(const PixelReservoirs::Pixel& a, const PixelReservoirs::Pixel& b) const
+	{
+		return (a.intersection.normal.Dot(b.intersection.normal) >= NormalThreshold) &&
+			(std::abs(a.intersection.distance - b.intersection.distance) <= DistanceThreshold * a.intersection.distance);
+	}
+
+	float ResamplingTask::GetTarget(const PixelReservoirs::Pixel& pixel, const LightSample& sample, SpectralPacket& contribution) const
+	{
+		static const MaterialTable& materials = tracer_.scene_->materialTable();
+		static const size_t spectrumCount = tracer_.spectrum_.count;
+
+		static thread_local SpectralPacket bsdf(tracer_.spectrum_.count);
+
+		// direction to light
+		const Intersection& intersection = pixel.intersection;
+		Vec3 toLight = sample.point - intersection.point;
+		float distanceSquared = toLight.Dot(toLight);
+		if (distanceSquared <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		float distance = std::sqrt(distanceSquared);
+		Vec3 direction = toLight / distance;
+
+		// light must be in front of the surface and surface in front of the light
+		float cosLight = -direction.Dot(sample.normal);
+		if ((cosLight <= 0.0f) || (direction.Dot(intersection.normal) <= 0.0f))
+		{
+			return 0.0f;
+		}
+
+		// emitted radiance towards the surface
+		Ray toSurface = pixel.ray;
+		toSurface.origin = intersection.point;
+		toSurface.direction = direction;
+
+		Intersection lightIntersection;
+		lightIntersection.point = sample.point;
+		lightIntersection.normal = sample.normal;
+		lightIntersection.distance = distance;
+		lightIntersection.primitive = sample.primitive;
+		materials.GetRadiance(sample.primitive->materialId(), toSurface, lightIntersection, contribution);
+
+		// BSDF times cosine at the surface, area of light is converted to solid angle
+		materials.Evaluate(pixel.material, pixel.ray, intersection, direction, bsdf);
+		contribution.MultiplyScaled(bsdf, cosLight / distanceSquared);
+
+		float target = 0.0f;
+		for (size_t t = 0; t < spectrumCount; t++)
+		{
+			target += contribution[t];
+		}
+
+		return target / static_cast<float>(spectrumCount);
+	}
+
+	void ResamplingTask::Shade(PixelReservoirs::Pixel& pixel, Vec3& color) const
+	{
+		static const bool unbiased = tracer_.settings_.restirUnbiased;
+
+		static thread_local SpectralPacket contribution(tracer_.spectrum_.count);
+
+		Reservoir& reservoir = pixel.reservoir;
+		if (reservoir.weight <= 0.0f)
+		{
+			return;
+		}
+
+		if (GetTarget(pixel, reservoir.sample, contribution) <= 0.0f)
+		{
+			return;
+		}
+
+		// the only shadow ray of the pixel
+		Vec3 toLight = reservoir.sample.point - pixel.intersection.point;
+		float distance = toLight.Length();
+
+		Ray shadowRay = pixel.ray;
+		shadowRay.origin = pixel.intersection.point;
+		shadowRay.direction = toLight / distance;
+		if (tracer_.scene_->Occluded(shadowRay, distance * (1.0f - ShadowRayEps)))
+		{
+			// biased reuse does not pass occluded samples to the next pass
+			if (!unbiased)
+			{
+				reservoir.weight = 0.0f;
+			}
+			return;
+		}
+
+		AddRadiance(pixel.ray, contribution, reservoir.weight, color);
+	}
+
+}
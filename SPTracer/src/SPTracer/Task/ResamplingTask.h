@@ -0,0 +1,73 @@
+#ifndef SPT_RESAMPLING_TASK_H
+#define SPT_RESAMPLING_TASK_H
+
+#include "../stdafx.h"
+#include "../Color/SpectralPacket.h"
+#include "../Resampling/PixelReservoirs.h"
+#include "IntegratorTask.h"
+
+namespace SPTracer
+{
+	struct LightSample;
+	class PathStatistics;
+	class Sampler;
+	class Tracer;
+
+	// Direct light by spatiotemporal reservoir resampling. Light sample
+	// candidates of the first visible surface are resampled by unshadowed
+	// contribution, and merged with the reservoir of the pixel from the
+	// previous pass and with reservoirs of neighbouring pixels. Only the
+	// selected sample is traced by shadow ray. Biased merging normalizes by
+	// all merged candidates and drops occluded samples, unbiased merging
+	// normalizes only by candidates of surfaces which could produce the sample.
+	class ResamplingTask : public IntegratorTask
+	{
+	public:
+		enum class Phase
+		{
+			Candidates,
+			Reuse
+		};
+
+		ResamplingTask(Tracer& tracer, Phase phase);
+
+		virtual void Run() override;
+
+	private:
+		// neighbouring surfaces with normals and distances differing more do not share reservoirs
+		static const float NormalThreshold;
+		static const float DistanceThreshold;
+
+		// candidates of previous pass reservoir are limited relative to the candidates of the pass
+		static const float TemporalCountLimit;
+
+		Phase phase_;
+
+		// finds surfaces and candidates of image rows, and starts reuse when all rows are done
+		void TraceCandidates();
+
+		// merges reservoirs of neighbours in image rows and shades them, and ends pass when all rows are done
+		void TraceReuse();
+
+		// traces camera ray to the first surface, adds its emission to color
+		void TraceSurface(Ray ray, PixelReservoirs::Pixel& pixel, Vec3& color) const;
+
+		// resamples light sample candidates for the surface
+		void SampleCandidates(PixelReservoirs::Pixel& pixel, Sampler& sampler) const;
+
+		// merges reservoirs of pixels into reservoir for surface of the first pixel
+		void Merge(const std::vector<const PixelReservoirs::Pixel*>& pixels, Sampler& sampler, Reservoir& reservoir) const;
+
+		// surfaces close enough to share reservoirs
+		bool IsSimilar(const PixelReservoirs::Pixel& a, const PixelReservoirs::Pixel& b) const;
+
+		// unshadowed contribution of light sample to the surface, returns its mean as target function
+		float GetTarget(const PixelReservoirs::Pixel& pixel, const LightSample& sample, SpectralPacket& contribution) const;
+
+		// traces shadow ray to the selected sample and adds its contribution to color
+		void Shade(PixelReservoirs::Pixel& pixel, Vec3& color) const;
+	};
+
+}
+
+#endif
@@ -1,11 +1,21 @@
 #include "../stdafx.h"
 #include "../Util.h"
+#include "../Color/SpectralPacket.h"
 #include "../Color/Spectrum.h"
+#include "../Color/WavelengthSampler.h"
 #include "../Color/XYZConverter.h"
-#include "../Scene/Camera.h"
+#include "../Cache/RadianceCache.h"
+#include "../Guiding/DTree.h"
+#include "../Guiding/PathGuide.h"
+#include "../Light/EmitterTable.h"
+#include "../Light/EnvironmentLight.h"
+#include "../Material/MaterialTable.h"
 #include "../Scene/Scene.h"
 #include "../Primitive/Primitive.h"
+#include "../Sampler/RandomSampler.h"
 #include "../Tracer/Intersection.h"
+#include "../Tracer/PathStatistics.h"
+#include "../Tracer/SplitStatistics.h"
 #include "../Tracer/Tracer.h"
 #include "TaskScheduler.h"
 #include "TraceTask.h"
@@ -13,218 +23,590 @@
 namespace SPTracer
 {
 
+	// Chooses kernel instantiation for run-time flags. Flags are
+	// consumed one at a time, until all template arguments are known.
+	template <bool... Chosen>
+	struct TraceTask::KernelSelector
+	{
+		static TracePathFunction Select(const bool* flags)
+		{
+			return flags[0]
+				? KernelSelector<Chosen..., true>::Select(flags + 1)
+				: KernelSelector<Chosen..., false>::Select(flags + 1);
+		}
+	};
+
+	template <bool FullSpectrum, bool NextEventEstimation, bool MultipleImportanceSampling, bool RussianRoulette, bool PathGuiding, bool RadianceCaching>
+	struct TraceTask::KernelSelector<FullSpectrum, NextEventEstimation, MultipleImportanceSampling, RussianRoulette, PathGuiding, RadianceCaching>
+	{
+		static TracePathFunction Select(const bool*)
+		{
+			return &TraceTask::TracePath<FullSpectrum, NextEventEstimation, MultipleImportanceSampling, RussianRoulette, PathGuiding, RadianceCaching>;
+		}
+	};
+
 	TraceTask::TraceTask(Tracer& tracer)
-		: Task(tracer)
+		: IntegratorTask(tracer)
 	{
 	}
 
 	void TraceTask::Run()
 	{
-		// model
-		static const Scene& model = *tracer_.scene_;
-
-		// color converter
-		static const XYZConverter& xyzConverter = *tracer_.xyzConverter_;
-		
-		// camera
-		static const Camera& camera = tracer_.camera_;
-		static const Vec3& origin = camera.p;
-		
-		// y-axis
-		static const Vec3 yAxis(0.0f, 1.0f, 0.0f);
-
-		// z-axis
-		static const Vec3 zAxisReversed(0.0f, 0.0f, -1.0f);
-
 		// width and height
 		static const unsigned int width = tracer_.width_;
 		static const unsigned int height = tracer_.height_;
-		static const float pixelWidth = camera.iw / width;
-		static const float pixelHeight = camera.ih / height;
-		static const float left = camera.icx - camera.iw / 2.0f;
-		static const float top = camera.icy + camera.ih / 2.0f;
 
 		// spectrum
 		static const Spectrum& spectrum = tracer_.spectrum_;
 
-		static thread_local std::vector<float> reflectance(spectrum.count);
-		static thread_local std::vector<float> radiance(spectrum.count);
-		static thread_local std::vector<float> weight(spectrum.count);
+		// wave lengths per path, 0 for full spectrum
+		static const int heroWavelengths = static_cast<int>(std::min(tracer_.settings_.heroWavelengths, spectrum.count));
+
+		// path tracing kernel for the render settings
+		static const TracePathFunction tracePath = SelectKernel();
+
+		// model
+		static const Scene& model = *tracer_.scene_;
+
 		static thread_local std::vector<Vec3> color(width * height);
+		static thread_local PathStatistics pathStatistics;
+
+		// primary rays of one image row and their hits
+		static thread_local std::vector<Ray> cameraRays(width);
+		static thread_local std::vector<Intersection> primaryHits(width);
+		static thread_local std::vector<char> primaryFound(width);
+
+		// paths continuing from every primary hit, automatic splitting
+		// chooses their number by costs and variances measured by all tasks
+		static SplitStatistics* splitStatistics = tracer_.splitStatistics_.get();
+		static thread_local unsigned int splits = splitStatistics != nullptr ? splitStatistics->UpdateSplitCount() : tracer_.settings_.primarySplits;
+		static thread_local std::vector<SplitStatistics::CameraRay> splitRays(splitStatistics != nullptr ? width : 0);
+
+		// sampler
+		static thread_local RandomSampler sampler(static_cast<unsigned int>(Util::RandInt(0, std::numeric_limits<int>::max())));
 
 		// reset all colors
 		std::for_each(color.begin(), color.end(), [](Vec3& c) { c.Reset(); });
+		pathStatistics.Reset();
+
+		// guiding distributions must not change during the pass
+		std::shared_lock<std::shared_timed_mutex> guideLock;
+		if (tracer_.pathGuide_ != nullptr)
+		{
+			guideLock = tracer_.pathGuide_->Lock();
+		}
 
 		for (size_t i = 0; i < height; i++)
 		{
+			auto rowStart = std::chrono::high_resolution_clock::now();
+
+			// generate primary rays for the row and find their hits
+			GenerateCameraRays(i, sampler, cameraRays);
 			for (size_t j = 0; j < width; j++)
 			{
-				// sample pixel
-				float u = left + (static_cast<float>(j) + Util::RandFloat(0.0f, 1.0f)) * pixelWidth;
-				float v = top - (static_cast<float>(i) + Util::RandFloat(0.0f, 1.0f)) * pixelHeight;
+				primaryFound[j] = model.Intersect(cameraRays[j], primaryHits[j]);
+			}
+
+			auto primaryEnd = std::chrono::high_resolution_clock::now();
 
-				// direction
-				Vec3 direction = Vec3(
-					u,			// x
-					v,			// y
-					-camera.f	// z
-				).Normalize();
+			for (size_t j = 0; j < width; j++)
+			{
+				Vec3& pixelColor = color[i * width + j];
 
-				// rotate direction according ti view direction around up axis
-				direction = direction.RotateFromTo(zAxisReversed, camera.n, camera.up);
+				// hit is shared by continuations, which carry equal parts of its radiance,
+				// ray leaving the scene sees the same radiance for all of them
+				unsigned int n = primaryFound[j] ? splits : 1;
+				float splitWeight = 1.0f / static_cast<float>(n);
+				float sum = 0.0f;
+				float sumSquared = 0.0f;
 
-				// rotate direction according to up direction around view direction
-				direction = direction.RotateFromTo(yAxis, camera.up, camera.n);
+				for (unsigned int k = 0; k < n; k++)
+				{
+					// spawn new ray
+					Ray ray = cameraRays[j];
 
-				// spawn new ray
-				Ray ray;
-				ray.origin = origin;
-				ray.direction = direction;
+					// originally ray contains all spectrum or hero packet with random first wave length
+					ray.heroIndex = tracer_.wavelengthSampler_->Sample(sampler.Get1D());
+					ray.waveCount = heroWavelengths;
 
-				// originally ray contains all spectrum
-				ray.waveIndex = -1;
+					// trace path
+					float luminance = pixelColor[1];
+					(this->*tracePath)(ray, primaryFound[j] ? &primaryHits[j] : nullptr, splitWeight, sampler, pixelColor, pathStatistics);
 
-				// set weight to 1
-				std::fill(weight.begin(), weight.end(), 1.0f);
+					// estimate of the continuation as if it was the only one
+					luminance = (pixelColor[1] - luminance) * n;
+					sum += luminance;
+					sumSquared += luminance * luminance;
+				}
 
-				// trace ray
-				while (true)
+				if (splitStatistics != nullptr)
 				{
-					// try to find intersection
-					Intersection intersection;
-					if (!model.Intersect(ray, intersection))
-					{
-						// no intersection foubd
-						break;
-					}
+					splitRays[j] = { sum, sumSquared, n };
+				}
+			}
 
-					// material
-					const auto& material = intersection.primitive->material();
+			if (splitStatistics != nullptr)
+			{
+				auto rowEnd = std::chrono::high_resolution_clock::now();
+				splitStatistics->AddRow(i * width, splitRays, std::chrono::duration<double>(primaryEnd - rowStart).count(),
+					std::chrono::duration<double>(rowEnd - primaryEnd).count());
+			}
+		}
 
-					// reflected (refracted) ray weight correction
-					float reflectionProbability = 1.0f;
+		// the next pass uses the best number of continuations found so far
+		if (splitStatistics != nullptr)
+		{
+			splits = splitStatistics->UpdateSplitCount();
+		}
 
-					// check if light should be emitted
-					if (material.IsEmissive())
-					{
-						// check if material is reflective
-						bool reflective = material.IsReflective();
-
-						// emission probability for emissive material
-						float emissionProbability = reflective ? 0.9f : 1.0f;
-
-						if (!reflective || (Util::RandFloat(0.0f, 1.0f) < emissionProbability))
-						{
-							// color
-							Vec3& c = color[i * width + j];
-
-							// radiance
-							material.GetRadiance(ray, intersection, radiance);
-
-							if (ray.waveIndex == -1)
-							{
-								// full spectrum
-								for (size_t t = 0; t < spectrum.count; t++)
-								{
-									// radiance with applied weight and emission probability
-									float r = radiance[t] * weight[t] / emissionProbability;
-
-									// store the mean radiance from all wave length
-									c += r * xyzConverter.GetXYZ(spectrum.values[t]) / static_cast<float>(spectrum.count);
-								}
-							}
-							else
-							{
-								// only one radiance with applied weight and emission probability
-								float r = radiance[ray.waveIndex] * weight[ray.waveIndex] / emissionProbability;
-
-								// store radiance devided by the number of wave length in spectrum
-								c += r * xyzConverter.GetXYZ(spectrum.values[ray.waveIndex]);
-							}
-
-							// done with this ray
-							break;
-						}
-						else
-						{
-							// set reflection probability
-							reflectionProbability = 1.0f - emissionProbability;
-						}
-					}
+		// the last pass of training iteration refines the guide, when samples are added
+		if (guideLock.owns_lock())
+		{
+			guideLock.unlock();
+		}
 
-					// preserve monochromaticity, refracted state and the wave index for the ray
-					// origin and direction should be set in the GetNewRay method
-					Ray newRay;
-					newRay.refracted = ray.refracted;
-					newRay.waveIndex = ray.waveIndex;
-
-					float diffuseReflectionProbability = material.GetDiffuseReflectionProbability(ray.waveIndex);
-					float specularReflectionProbability = material.GetSpecularReflectionProbability(ray.waveIndex);
-
-					/////////////////////////////////////////////////////////////////////////////////////
-					// 
-					// TODO: take into account refraction. In case of refraction, refracted should be
-					//       set to true and waveIndex should be assigned a random index from the range
-					//       0 <= waveIndex < spectrum.count.
-					//
-					// newRay.refracted = true;
-					// newRay.waveIndex = Util::RandInt(0, spectrum.count - 1);
-					//
-					/////////////////////////////////////////////////////////////////////////////////////
-
-					// decide what happens with the ray next
-					float next = Util::RandFloat(0.0f, 1.0f);
-					if (next < diffuseReflectionProbability)
-					{
-						// diffuse reflection
-						material.GetNewRayDiffuse(ray, intersection, newRay, reflectance);
+		// add another task
+		tracer_.taskScheduler_->AddTask(std::make_unique<TraceTask>(tracer_));
 
-						// ray was not absorped, increase its weight by decreasing reflection probability
-						reflectionProbability *= diffuseReflectionProbability;
-					}
-					else if (next < (diffuseReflectionProbability + specularReflectionProbability))
-					{
-						// specular reflection
-						if (!material.GetNewRaySpecular(ray, intersection, newRay, reflectance))
-						{
-							// specular ray points inside the material,
-							// stop tracing this path
-							break;
-						}
-						
-						// ray was not absorped, increase its weight by decreasing reflection probability
-						reflectionProbability *= specularReflectionProbability;
-					}
-					else
+		// add samples
+		tracer_.AddSamples(color, pathStatistics);
+	}
+
+	TraceTask::TracePathFunction TraceTask::SelectKernel() const
+	{
+		const RenderSettings& settings = tracer_.settings_;
+
+		// light sampling needs lights
+		bool nextEventEstimation = settings.nextEventEstimation && (GetEnvironmentProbability() > 0.0f || !tracer_.scene_->emitters().empty());
+
+		const bool flags[] =
+		{
+			settings.heroWavelengths == 0,
+			nextEventEstimation,
+			nextEventEstimation && settings.multipleImportanceSampling,
+			settings.russianRoulette,
+			tracer_.pathGuide_ != nullptr,
+			tracer_.radianceCache_ != nullptr
+		};
+
+		return KernelSelector<>::Select(flags);
+	}
+
+	template <bool FullSpectrum, bool NextEventEstimation, bool MultipleImportanceSampling, bool RussianRoulette, bool PathGuiding, bool RadianceCaching>
+	void TraceTask::TracePath(Ray ray, const Intersection* primary, float splitWeight, Sampler& sampler, Vec3& color, PathStatistics& pathStatistics) const
+	{
+		// model
+		static const Scene& model = *tracer_.scene_;
+
+		// spectrum
+		static const Spectrum& spectrum = tracer_.spectrum_;
+
+		// flattened materials
+		static const MaterialTable& materials = model.materialTable();
+
+		// light arriving along rays leaving the scene
+		static const EnvironmentLight* environment = model.environment();
+
+		// path depth
+		static const size_t minDepth = tracer_.settings_.minDepth;
+		static const size_t maxDepth = tracer_.settings_.maxDepth;
+		static const size_t rouletteDepth = tracer_.settings_.rouletteDepth;
+
+		// learned incident radiance
+		static PathGuide* pathGuide = tracer_.pathGuide_.get();
+		static thread_local std::vector<GuidingVertex> guidingVertices;
+		bool recordGuiding = PathGuiding && pathGuide->training();
+		guidingVertices.clear();
+
+		// reflected radiance shared by paths, a fraction of paths is traced in full to update it
+		static RadianceCache* radianceCache = tracer_.radianceCache_.get();
+		static const size_t cacheDepth = tracer_.settings_.radianceCacheDepth;
+		static const float cacheUpdateRate = tracer_.settings_.radianceCacheUpdateRate;
+		static thread_local std::vector<CacheVertex> cacheVertices;
+		static thread_local SpectralPacket pathRadiance(spectrum.count);
+		bool recordCache = RadianceCaching && (sampler.Get1D() < cacheUpdateRate);
+		SpectralPacket* spectralColor = recordCache ? &pathRadiance : nullptr;
+		size_t cacheVertexCount = 0;
+
+		static thread_local SpectralPacket reflectance(spectrum.count);
+		static thread_local SpectralPacket radiance(spectrum.count);
+		static thread_local SpectralPacket weight(spectrum.count);
+
+		// set weight to the part of the camera ray carried by the path
+		if (FullSpectrum)
+		{
+			weight.Fill(splitWeight);
+		}
+		else
+		{
+			ray.ForEachWave(spectrum.count, [&](size_t t) { weight[t] = splitWeight; });
+		}
+
+		if (recordCache)
+		{
+			ray.ForEachWave(spectrum.count, [&](size_t t) { pathRadiance[t] = 0.0f; });
+		}
+
+		// solid angle density of the BSDF sample that generated the ray,
+		// zero for camera rays, which can not be generated by light sampling
+		float bsdfPdf = 0.0f;
+
+		// vertex the ray starts from, light selection depends on it
+		Vec3 previousPoint;
+		Vec3 previousNormal;
+
+		// number of bounces
+		size_t depth = 0;
+
+		// trace ray
+		while (true)
+		{
+			// try to find intersection, the hit of camera ray is already known
+			Intersection intersection;
+			bool found = (depth == 0) ? (primary != nullptr) : model.Intersect(ray, intersection);
+			if (!found)
+			{
+				// no intersection found, ray leaves the scene
+				if ((environment != nullptr) && (depth >= minDepth))
+				{
+					float misWeight = EnvironmentWeight<NextEventEstimation, MultipleImportanceSampling>(ray, bsdfPdf);
+					if (misWeight > 0.0f)
 					{
-						// ray absorped
-						break;
+						environment->GetRadiance(ray, radiance);
+						AddRadiance(ray, radiance, weight, misWeight, color, spectralColor);
 					}
+				}
+				break;
+			}
+
+			if (depth == 0)
+			{
+				intersection = *primary;
+			}
+
+			// material
+			MaterialId material = intersection.primitive->materialId();
+
+			// add emitted light
+			if (materials.IsEmissive(material) && (depth >= minDepth))
+			{
+				float misWeight = EmissionWeight<NextEventEstimation, MultipleImportanceSampling>(ray, intersection, bsdfPdf, previousPoint, previousNormal);
+				if (misWeight > 0.0f)
+				{
+					materials.GetRadiance(material, ray, intersection, radiance);
+					AddRadiance(ray, radiance, weight, misWeight, color, spectralColor);
+				}
+			}
+
+			// check if material is reflective and path can be extended
+			if (!materials.IsReflective(material) || ((maxDepth != 0) && (depth >= maxDepth)))
+			{
+				// done with this ray
+				break;
+			}
 
-					// update ray weight
-					if (ray.waveIndex == -1)
+			// diffuse vertices share reflected radiance through the cache
+			if (RadianceCaching && (materials.record(material).type == MaterialType::Lambertian))
+			{
+				if (recordCache)
+				{
+					// radiance found after the vertex is recorded when the path is complete
+					while (cacheVertices.size() <= cacheVertexCount)
 					{
-						for (size_t t = 0; t < spectrum.count; t++)
-						{
-							weight[t] *= reflectance[t] / reflectionProbability;
-						}
+						cacheVertices.emplace_back(spectrum.count);
 					}
-					else
+
+					CacheVertex& v = cacheVertices[cacheVertexCount++];
+					v.point = intersection.point;
+					v.normal = intersection.normal;
+					ray.ForEachWave(spectrum.count, [&](size_t t)
 					{
-						weight[ray.waveIndex] *= reflectance[ray.waveIndex] / reflectionProbability;
-					}
+						v.weight[t] = weight[t];
+						v.radiance[t] = pathRadiance[t];
+					});
+				}
+				else if ((depth >= cacheDepth) && radianceCache->Lookup(intersection.point, intersection.normal, ray, radiance))
+				{
+					// the rest of the path is replaced by cached radiance
+					AddRadiance(ray, radiance, weight, 1.0f, color, nullptr);
+					break;
+				}
+			}
+
+			// guiding distribution at diffuse vertices, nullptr until it is learned
+			bool guided = PathGuiding && (materials.record(material).type == MaterialType::Lambertian);
+			const DTree* guide = guided ? pathGuide->GetSamplingTree(intersection.point) : nullptr;
+
+			// sample lights directly
+			if (NextEventEstimation && (depth + 1 >= minDepth))
+			{
+				SampleLight<FullSpectrum, MultipleImportanceSampling>(ray, intersection, material, guide, sampler, weight, color, spectralColor);
+			}
+
+			// preserve monochromaticity, refracted state and the wave index for the ray
+			// origin and direction are set by the material
+			Ray newRay;
+			newRay.refracted = ray.refracted;
+			newRay.waveIndex = ray.waveIndex;
+			newRay.heroIndex = ray.heroIndex;
+			newRay.waveCount = ray.waveCount;
+
+			/////////////////////////////////////////////////////////////////////////////////////
+			//
+			// TODO: take into account refraction. In case of refraction, refracted should be
+			//       set to true and waveIndex should be assigned a random index from the range
+			//       0 <= waveIndex < spectrum.count.
+			//
+			// newRay.refracted = true;
+			// newRay.waveIndex = Util::RandInt(0, spectrum.count - 1);
+			//
+			/////////////////////////////////////////////////////////////////////////////////////
+
+			// ray is terminated by Russian roulette, so reflection
+			// lobe is chosen proportionally to its probability
+			if ((guide != nullptr) && (sampler.Get1D() >= pathGuide->bsdfSamplingFraction()))
+			{
+				// direction from learned incident radiance
+				newRay.origin = intersection.point;
+				newRay.direction = guide->Sample(sampler);
+				if (newRay.direction.Dot(intersection.normal) <= 0.0f)
+				{
+					// surface is not lit from below
+					break;
+				}
+			}
+			else if (!materials.Sample(material, ray, intersection, sampler, newRay))
+			{
+				// ray points inside the material,
+				// stop tracing this path
+				break;
+			}
+
+			// the ray could be generated by any lobe or by the guide, so the weight
+			// is the whole BSDF divided by the combined density of all of them
+			bsdfPdf = GetScatteringPdf(material, ray, intersection, newRay.direction, guide);
+			if (bsdfPdf <= 0.0f)
+			{
+				break;
+			}
 
-					// change current ray to reflected (refracted) ray
-					std::swap(ray, newRay);
+			materials.Evaluate(material, ray, intersection, newRay.direction, reflectance);
+
+			// update ray weight
+			if (FullSpectrum)
+			{
+				weight.MultiplyScaled(reflectance, 1.0f / bsdfPdf);
+			}
+			else
+			{
+				ray.ForEachWave(spectrum.count, [&](size_t t) { weight[t] *= reflectance[t] / bsdfPdf; });
+			}
+
+			previousPoint = intersection.point;
+			previousNormal = intersection.normal;
+			depth++;
+
+			// Russian roulette: continue with probability of the path throughput,
+			// relative to the camera ray, so that split paths are not terminated more often
+			if (RussianRoulette && (depth >= rouletteDepth))
+			{
+				float continueProbability = std::min(GetThroughput(ray, weight) / splitWeight, 1.0f);
+				if (sampler.Get1D() >= continueProbability)
+				{
+					// ray absorped
+					break;
+				}
+
+				// survived ray compensates for terminated rays
+				if (FullSpectrum)
+				{
+					weight.Divide(continueProbability);
 				}
+				else
+				{
+					ray.ForEachWave(spectrum.count, [&](size_t t) { weight[t] /= continueProbability; });
+				}
+			}
+
+			// radiance added to the path from now on arrives along the new ray
+			if (recordGuiding && guided)
+			{
+				guidingVertices.push_back({ intersection.point, newRay.direction, bsdfPdf, GetThroughput(ray, weight), color[1] });
 			}
+
+			// change current ray to reflected (refracted) ray
+			std::swap(ray, newRay);
 		}
 
-		// add another task
-		tracer_.taskScheduler_->AddTask(std::make_unique<TraceTask>(tracer_));
-		
-		// add samples
-		tracer_.AddSamples(color);
+		// incident radiance at recorded vertices (luminance, approximately, since
+		// throughput is not spectral), the guide records it divided by the density
+		for (const GuidingVertex& v : guidingVertices)
+		{
+			float radiance = v.throughput > 0.0f ? (color[1] - v.luminance) / v.throughput : 0.0f;
+			pathGuide->Record(v.point, v.direction, radiance / v.pdf);
+		}
+
+		// reflected radiance at recorded vertices, radiance found after the vertex divided by its weight
+		for (size_t i = 0; i < cacheVertexCount; i++)
+		{
+			CacheVertex& v = cacheVertices[i];
+			ray.ForEachWave(spectrum.count, [&](size_t t)
+			{
+				v.radiance[t] = v.weight[t] > 0.0f ? (pathRadiance[t] - v.radiance[t]) / v.weight[t] : 0.0f;
+			});
+			radianceCache->Record(v.point, v.normal, ray, v.radiance);
+		}
+
+		pathStatistics.Add(depth);
+	}
+
+	void TraceTask::AddRadiance(const Ray& ray, const SpectralPacket& radiance, const SpectralPacket& weight, float scale, Vec3& color, SpectralPacket* spectralColor) const
+	{
+		IntegratorTask::AddRadiance(ray, radiance, weight, scale, color);
+
+		if (spectralColor != nullptr)
+		{
+			ray.ForEachWave(tracer_.spectrum_.count, [&](size_t t) { (*spectralColor)[t] += radiance[t] * weight[t] * scale; });
+		}
+	}
+
+	template <bool NextEventEstimation, bool MultipleImportanceSampling>
+	float TraceTask::EmissionWeight(const Ray& ray, const Intersection& intersection, float bsdfPdf, const Vec3& previousPoint, const Vec3& previousNormal) const
+	{
+		const EmitterTable& emitters = tracer_.scene_->emitters();
+
+		// camera rays, disabled light sampling and emitters which are never sampled directly
+		if (!NextEventEstimation || (bsdfPdf == 0.0f) || !emitters.Contains(intersection.primitive))
+		{
+			return 1.0f;
+		}
+
+		// without MIS direct light is counted by light sampling only
+		if (!MultipleImportanceSampling)
+		{
+			return 0.0f;
+		}
+
+		// density of sampling the same point by light sampling, in solid angle measure
+		float cosLight = -ray.direction.Dot(intersection.normal);
+		if (cosLight <= 0.0f)
+		{
+			return 1.0f;
+		}
+
+		static const float emitterProbability = 1.0f - GetEnvironmentProbability();
+		float lightPdf = emitterProbability * emitters.GetPdf(intersection.primitive, previousPoint, previousNormal) * intersection.distance * intersection.distance / cosLight;
+		return Util::PowerHeuristic(bsdfPdf, lightPdf);
+	}
+
+	template <bool NextEventEstimation, bool MultipleImportanceSampling>
+	float TraceTask::EnvironmentWeight(const Ray& ray, float bsdfPdf) const
+	{
+		static const float environmentProbability = GetEnvironmentProbability();
+
+		// camera rays, disabled light sampling and black environment, which is never sampled
+		if (!NextEventEstimation || (bsdfPdf == 0.0f) || (environmentProbability == 0.0f))
+		{
+			return 1.0f;
+		}
+
+		// without MIS direct light is counted by light sampling only
+		if (!MultipleImportanceSampling)
+		{
+			return 0.0f;
+		}
+
+		float lightPdf = environmentProbability * tracer_.scene_->environment()->GetPdf(ray.direction);
+		return Util::PowerHeuristic(bsdfPdf, lightPdf);
+	}
+
+	float TraceTask::GetEnvironmentProbability() const
+	{
+		const EnvironmentLight* environment = tracer_.scene_->environment();
+		if ((environment == nullptr) || environment->empty())
+		{
+			return 0.0f;
+		}
+
+		// environment and emitters are sampled equally often
+		return tracer_.scene_->emitters().empty() ? 1.0f : 0.5f;
+	}
+
+	template <bool FullSpectrum, bool MultipleImportanceSampling>
+	void TraceTask::SampleLight(const Ray& ray, const Intersection& intersection, MaterialId material, const DTree* guide, Sampler& sampler, const SpectralPacket& weight, Vec3& color, SpectralPacket* spectralColor) const
+	{
+		const MaterialTable& materials = tracer_.scene_->materialTable();
+
+		static thread_local SpectralPacket bsdf(tracer_.spectrum_.count);
+		static thread_local SpectralPacket radiance(tracer_.spectrum_.count);
+
+		static const float environmentProbability = GetEnvironmentProbability();
+
+		// shadow ray carries wave lengths of the path, direction is set by the chosen light
+		Ray shadowRay = ray;
+		shadowRay.origin = intersection.point;
+
+		// solid angle density of the direction
+		float lightPdf;
+
+		if ((environmentProbability > 0.0f) && ((environmentProbability == 1.0f) || (sampler.Get1D() < environmentProbability)))
+		{
+			// direction towards environment, unoccluded rays leave the scene
+			if (!tracer_.scene_->environment()->Sample(sampler, shadowRay.direction, lightPdf) ||
+				(shadowRay.direction.Dot(intersection.normal) <= 0.0f) ||
+				tracer_.scene_->Occluded(shadowRay, std::numeric_limits<float>::max()))
+			{
+				return;
+			}
+
+			tracer_.scene_->environment()->GetRadiance(shadowRay, radiance);
+			lightPdf *= environmentProbability;
+		}
+		else
+		{
+			if (!SampleEmitter(ray, intersection, sampler, shadowRay, radiance, lightPdf))
+			{
+				return;
+			}
+
+			lightPdf *= 1.0f - environmentProbability;
+		}
+
+		const Vec3& direction = shadowRay.direction;
+
+		// BSDF times cosine at the surface
+		materials.Evaluate(material, ray, intersection, direction, bsdf);
+
+		if (FullSpectrum)
+		{
+			radiance.Multiply(bsdf);
+		}
+		else
+		{
+			ray.ForEachWave(tracer_.spectrum_.count, [&](size_t t) { radiance[t] *= bsdf[t]; });
+		}
+
+		// weight against the chance of hitting the light by BSDF sampling
+		float misWeight = 1.0f;
+		if (MultipleImportanceSampling)
+		{
+			misWeight = Util::PowerHeuristic(lightPdf, GetScatteringPdf(material, ray, intersection, direction, guide));
+		}
+
+		AddRadiance(ray, radiance, weight, misWeight / lightPdf, color, spectralColor);
+	}
+
+	float TraceTask::GetScatteringPdf(MaterialId material, const Ray& ray, const Intersection& intersection, const Vec3& direction, const DTree* guide) const
+	{
+		float pdf = tracer_.scene_->materialTable().GetPdf(material, ray, intersection, direction);
+		if (guide == nullptr)
+		{
+			return pdf;
+		}
+
+		// mixture of BSDF and guiding distributions
+		float bsdfSamplingFraction = tracer_.pathGuide_->bsdfSamplingFraction();
+		return bsdfSamplingFraction * pdf + (1.0f - bsdfSamplingFraction) * guide->GetPdf(direction);
 	}
 
 }
@@ -2,21 +2,87 @@
 #define TRACE_TASK_H
 
 #include "../stdafx.h"
+#include "../Color/SpectralPacket.h"
+#include "../Material/MaterialId.h"
 #include "../Tracer/Ray.h"
-#include "Task.h"
+#include "../Vec3.h"
+#include "IntegratorTask.h"
 
 namespace SPTracer
 {
+	struct Intersection;
+	class DTree;
+	class PathStatistics;
+	class Sampler;
 	class XYZConverter;
 	class Scene;
 	class Tracer;
 
-	class TraceTask : public Task
+	class TraceTask : public IntegratorTask
 	{
 	public:
 		explicit TraceTask(Tracer& tracer);
 
 		virtual void Run() override;
+
+	protected:
+		// path tracing kernel specialized for the render settings, primary is the hit
+		// of the camera ray found by the caller (nullptr if the ray leaves the scene),
+		// radiance of the path is scaled by splitWeight
+		using TracePathFunction = void (TraceTask::*)(Ray ray, const Intersection* primary, float splitWeight, Sampler& sampler, Vec3& color, PathStatistics& pathStatistics) const;
+
+		// chooses kernel instantiation once per render
+		TracePathFunction SelectKernel() const;
+
+	private:
+		// vertex of path where incident radiance is recorded for path guiding
+		struct GuidingVertex
+		{
+			Vec3 point;
+			Vec3 direction;		// sampled direction
+			float pdf;			// density of sampled direction
+			float throughput;	// path weight after the vertex
+			float luminance;	// luminance of the path before the vertex
+		};
+
+		// diffuse vertex of path where reflected radiance is recorded to radiance cache
+		struct CacheVertex
+		{
+			Vec3 point;
+			Vec3 normal;
+			SpectralPacket weight;		// path weight at the vertex
+			SpectralPacket radiance;	// spectral radiance of the path before the vertex
+
+			explicit CacheVertex(size_t spectrumCount) : weight(spectrumCount), radiance(spectrumCount) { }
+		};
+
+		template <bool... Chosen>
+		struct KernelSelector;
+
+		// traces one camera path and adds its radiance to color
+		template <bool FullSpectrum, bool NextEventEstimation, bool MultipleImportanceSampling, bool RussianRoulette, bool PathGuiding, bool RadianceCaching>
+		void TracePath(Ray ray, const Intersection* primary, float splitWeight, Sampler& sampler, Vec3& color, PathStatistics& pathStatistics) const;
+
+		// adds weighted spectral radiance to XYZ color, and to spectral color if it is not nullptr
+		void AddRadiance(const Ray& ray, const SpectralPacket& radiance, const SpectralPacket& weight, float scale, Vec3& color, SpectralPacket* spectralColor) const;
+
+		// weight of emission found by BSDF sampling from previous vertex, bsdfPdf is zero for camera rays
+		template <bool NextEventEstimation, bool MultipleImportanceSampling>
+		float EmissionWeight(const Ray& ray, const Intersection& intersection, float bsdfPdf, const Vec3& previousPoint, const Vec3& previousNormal) const;
+
+		// weight of environment found by BSDF sampling, bsdfPdf is zero for camera rays
+		template <bool NextEventEstimation, bool MultipleImportanceSampling>
+		float EnvironmentWeight(const Ray& ray, float bsdfPdf) const;
+
+		// probability to sample environment instead of emitters by next event estimation
+		float GetEnvironmentProbability() const;
+
+		// next event estimation: adds direct light from a point sampled on lights or from environment
+		template <bool FullSpectrum, bool MultipleImportanceSampling>
+		void SampleLight(const Ray& ray, const Intersection& intersection, MaterialId material, const DTree* guide, Sampler& sampler, const SpectralPacket& weight, Vec3& color, SpectralPacket* spectralColor) const;
+
+		// density of sampling direction at vertex, the mixture with guiding distribution if guide is not nullptr
+		float GetScatteringPdf(MaterialId material, const Ray& ray, const Intersection& intersection, const Vec3& direction, const DTree* guide) const;
 	};
 
 }
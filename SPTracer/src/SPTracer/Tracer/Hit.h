@@ -0,0 +1,23 @@
+#ifndef SPT_HIT_H
+#define SPT_HIT_H
+
+#include "../stdafx.h"
+
+namespace SPTracer
+{
+	class Primitive;
+
+	// result of the cheap ray-primitive test, surface attributes
+	// are fetched with Primitive::GetIntersection only for the closest hit
+	struct Hit
+	{
+		float distance;
+		float u;							// barycentric coordinates
+		float v;
+		const Primitive* primitive;			// primitive that was hit
+		const Primitive* subPrimitive;		// primitive inside of instanced mesh
+	};
+
+}
+
+#endif
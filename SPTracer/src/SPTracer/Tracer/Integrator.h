@@ -0,0 +1,21 @@
+#ifndef SPT_INTEGRATOR_H
+#define SPT_INTEGRATOR_H
+
+namespace SPTracer
+{
+
+	// light transport algorithm, every pass is traced by tasks of the integrator
+	enum class Integrator
+	{
+		PathTracing,
+		Bidirectional,
+		PhotonMapping,
+		Metropolis,
+		Radiosity,
+		InstantRadiosity,
+		ReservoirResampling
+	};
+
+}
+
+#endif
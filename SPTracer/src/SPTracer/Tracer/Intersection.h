@@ -2,6 +2,7 @@
 #define SPT_INTERSECTION_H
 
 #include "../stdafx.h"
+#include "../Frame.h"
 #include "../Vec3.h"
 
 namespace SPTracer
@@ -12,8 +13,9 @@ namespace SPTracer
 	{
 		Vec3 point;
 		Vec3 normal;
+		Frame frame;
 		float distance;
-		Primitive* primitive;
+		const Primitive* primitive;
 	};
 
 }
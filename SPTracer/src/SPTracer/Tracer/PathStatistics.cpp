@@ -0,0 +1,74 @@
+#include "../stdafx.h"
+#include "PathStatistics.h"
+
+namespace SPTracer
+{
+
+	const size_t PathStatistics::MaxLength;
+
+	PathStatistics::PathStatistics()
+	{
+		Reset();
+	}
+
+	void PathStatistics::Add(size_t length)
+	{
+		histogram_[std::min(length, MaxLength)]++;
+		totalLength_ += length;
+	}
+
+	void PathStatistics::Merge(const PathStatistics& other)
+	{
+		for (size_t i = 0; i < histogram_.size(); i++)
+		{
+			histogram_[i] += other.histogram_[i];
+		}
+
+		totalLength_ += other.totalLength_;
+	}
+
+	void PathStatistics::Reset()
+	{
+		histogram_.fill(0);
+		totalLength_ = 0;
+	}
+
+	unsigned long long PathStatistics::count() const
+	{
+		return std::accumulate(histogram_.begin(), histogram_.end(), 0ULL);
+	}
+
+	float PathStatistics::meanLength() const
+	{
+		unsigned long long n = count();
+		return n != 0 ? static_cast<float>(static_cast<double>(totalLength_) / n) : 0.0f;
+	}
+
+	std::string PathStatistics::ToString() const
+	{
+		unsigned long long n = count();
+		if (n == 0)
+		{
+			return "no paths";
+		}
+
+		// skip empty buckets at the end
+		size_t last = histogram_.size() - 1;
+		while ((last > 0) && (histogram_[last] == 0))
+		{
+			last--;
+		}
+
+		std::ostringstream oss;
+		oss << std::setprecision(2) << std::fixed;
+		oss << "mean length " << meanLength() << ", lengths:";
+		for (size_t i = 0; i <= last; i++)
+		{
+			oss << " " << i << ((i == MaxLength) ? "+" : "") << ": "
+				<< 100.0 * histogram_[i] / n << "%";
+		}
+
+		return oss.str();
+	}
+
+}
@@ -0,0 +1,35 @@
+#ifndef SPT_PATH_STATISTICS_H
+#define SPT_PATH_STATISTICS_H
+
+#include "../stdafx.h"
+
+namespace SPTracer
+{
+
+	// Histogram of path lengths (number of bounces). Paths longer
+	// than the histogram are counted in the last bucket.
+	class PathStatistics
+	{
+	public:
+		static const size_t MaxLength = 32;
+
+		PathStatistics();
+
+		void Add(size_t length);
+		void Merge(const PathStatistics& other);
+		void Reset();
+
+		unsigned long long count() const;
+		float meanLength() const;
+
+		// formats histogram as relative frequency of every path length
+		std::string ToString() const;
+
+	private:
+		std::array<unsigned long long, MaxLength + 1> histogram_;
+		unsigned long long totalLength_;
+	};
+
+}
+
+#endif
@@ -12,8 +12,48 @@ namespace SPTracer
 	{
 		Vec3 origin;
 		Vec3 direction;
-		int waveIndex;
+		int waveIndex;			// single wave length, -1 for full spectrum or hero packet
+		int heroIndex = 0;		// first wave length of hero packet
+		int waveCount = 0;		// wave lengths in hero packet, 0 for full spectrum
 		bool refracted = false;
+
+		// calls function with every wave index carried by the ray,
+		// hero packet wave lengths are evenly spaced over the spectrum
+		template <typename Function>
+		void ForEachWave(size_t spectrumCount, Function function) const
+		{
+			if (waveIndex != -1)
+			{
+				function(static_cast<size_t>(waveIndex));
+			}
+			else if (waveCount == 0)
+			{
+				for (size_t i = 0; i < spectrumCount; i++)
+				{
+					function(i);
+				}
+			}
+			else
+			{
+				size_t stride = spectrumCount / waveCount;
+				for (size_t k = 0; k < static_cast<size_t>(waveCount); k++)
+				{
+					function((heroIndex + k * stride) % spectrumCount);
+				}
+			}
+		}
+
+		// ray carries all wave lengths of the spectrum
+		bool IsFullSpectrum() const
+		{
+			return (waveIndex == -1) && (waveCount == 0);
+		}
+
+		// number of wave lengths carried by the ray
+		size_t GetWaveCount(size_t spectrumCount) const
+		{
+			return waveIndex != -1 ? 1 : (waveCount == 0 ? spectrumCount : waveCount);
+		}
 	};
 
 }
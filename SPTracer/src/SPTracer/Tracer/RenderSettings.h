@@ -0,0 +1,51 @@
+#ifndef SPT_RENDER_SETTINGS_H
+#define SPT_RENDER_SETTINGS_H
+
+#include "Integrator.h"
+
+namespace SPTracer
+{
+
+	struct RenderSettings
+	{
+		Integrator integrator = Integrator::PathTracing;	// light transport algorithm
+		bool nextEventEstimation = true;	// sample lights directly at reflective vertices
+		bool multipleImportanceSampling = true;	// combine light and BSDF sampling with the power heuristic
+		unsigned int heroWavelengths = 0;	// wave lengths traced per path, 0 for full spectrum
+		bool wavelengthImportanceSampling = true;	// choose hero wave lengths proportionally to the observer response
+		unsigned int minDepth = 0;	// paths with fewer bounces do not contribute
+		unsigned int maxDepth = 0;	// maximum number of bounces, 0 for unlimited
+		bool russianRoulette = true;	// terminate paths by throughput, requires maxDepth when disabled
+		unsigned int rouletteDepth = 3;	// number of bounces before Russian roulette starts
+		unsigned int primarySplits = 1;	// paths continuing from the primary hit of every camera ray, 0 for automatic
+		bool pathGuiding = false;	// sample directions at diffuse vertices from learned incident radiance
+		unsigned int guidingIterations = 6;	// training iterations, each has twice as many passes as the previous one
+		float guidingBsdfFraction = 0.5f;	// probability to sample BSDF at guided vertex, must be positive
+		bool radianceCache = false;	// terminate paths at diffuse vertices by cached reflected radiance, not used with depth limits
+		unsigned int radianceCacheDepth = 2;	// bounces before paths are terminated by the cache
+		float radianceCacheUpdateRate = 0.1f;	// fraction of paths traced in full to update the cache
+		unsigned int radianceCacheMinSamples = 16;	// records in cache cell before it is used, more records reduce bias
+		float radianceCacheCellSize = 0.0f;	// size of cache cell, 0 for 2% of the scene size
+		unsigned long photonsPerIteration = 0;	// photons traced by photon mapping per iteration, 0 for number of pixels
+		float photonRadius = 0.0f;	// initial photon gathering radius, 0 for 1% of the scene size
+		unsigned int metropolisBootstrapSamples = 100000;	// paths choosing start of Metropolis chain and estimating image brightness
+		float metropolisLargeStepProbability = 0.3f;	// probability to replace all sample values instead of perturbing them
+		float metropolisSigma = 0.01f;	// standard deviation of perturbation of sample values
+		float radiosityPatchSize = 0.0f;	// largest edge of radiosity patch, 0 for 5% of the scene size
+		unsigned int radiosityRays = 256;	// rays per patch estimating its form factors
+		unsigned int radiosityIterations = 32;	// iterations of radiosity solution
+		bool radiosityFinalGather = true;	// gather radiosity by one diffuse bounce instead of showing patches
+		unsigned long vplPathsPerPass = 1024;	// light subpaths leaving virtual point lights per pass of instant radiosity
+		float vplClampDistance = 0.0f;	// distance clamping geometric term of virtual point lights, 0 for 5% of the scene size
+		float lightcutsError = 0.02f;	// largest error bound of lightcut cluster relative to the estimate
+		unsigned int lightcutsMaxSize = 64;	// largest number of clusters in lightcut
+		unsigned int restirCandidates = 32;	// light sample candidates resampled per pixel and pass
+		bool restirTemporalReuse = true;	// merge reservoir of pixel with its reservoir from the previous pass
+		unsigned int restirSpatialNeighbors = 5;	// reservoirs of neighbouring pixels merged per pixel
+		float restirSpatialRadius = 30.0f;	// radius of neighbourhood in pixels
+		bool restirUnbiased = false;	// normalize merged reservoirs by candidates able to produce the sample
+	};
+
+}
+
+#endif
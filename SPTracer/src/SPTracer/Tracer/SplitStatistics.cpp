@@ -0,0 +1,83 @@
+#include "../stdafx.h"
+#include "../Log.h"
+#include "SplitStatistics.h"
+
+namespace SPTracer
+{
+
+	const unsigned int SplitStatistics::MaxSplits = 16;
+
+	SplitStatistics::SplitStatistics(size_t pixelCount)
+		: previous_(pixelCount, PixelEstimate{ 0.0f, 0 })
+	{
+	}
+
+	void SplitStatistics::AddRow(size_t pixel, const std::vector<CameraRay>& cameraRays, double cameraTime, double splitTime)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		cameraTime_ += cameraTime;
+		cameraRays_ += cameraRays.size();
+		splitTime_ += splitTime;
+
+		for (const CameraRay& cameraRay : cameraRays)
+		{
+			double n = static_cast<double>(cameraRay.splits);
+			double mean = cameraRay.sum / n;
+			splits_ += cameraRay.splits;
+
+			// unbiased variance among continuations
+			if (cameraRay.splits > 1)
+			{
+				withinVariance_ += std::max(0.0, (cameraRay.sumSquared - cameraRay.sum * mean) / (n - 1.0));
+				withinCount_++;
+			}
+
+			// estimates of two passes are independent, variance of
+			// their difference is 2 * V0 + V1 / n1 + V1 / n2
+			PixelEstimate& previous = previous_[pixel++];
+			if (previous.splits != 0)
+			{
+				double difference = mean - previous.mean;
+				differenceSquares_ += difference * difference;
+				differenceSplits_ += 1.0 / n + 1.0 / previous.splits;
+				differenceCount_++;
+			}
+
+			previous.mean = static_cast<float>(mean);
+			previous.splits = cameraRay.splits;
+		}
+	}
+
+	unsigned int SplitStatistics::UpdateSplitCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if ((withinCount_ == 0) || (differenceCount_ == 0) || (cameraRays_ == 0) || (splits_ == 0))
+		{
+			return splitCount_;
+		}
+
+		double cameraCost = cameraTime_ / cameraRays_;
+		double splitCost = splitTime_ / splits_;
+		double splitVariance = withinVariance_ / withinCount_;
+		double cameraVariance = (differenceSquares_ - splitVariance * differenceSplits_) / (2.0 * differenceCount_);
+
+		// variance comes only from continuations, more of them are always better
+		unsigned int splitCount = MaxSplits;
+		if ((cameraVariance > 0.0) && (splitCost > 0.0))
+		{
+			double splits = std::sqrt(cameraCost * splitVariance / (splitCost * cameraVariance));
+			splitCount = static_cast<unsigned int>(std::max(1.0, std::min(std::floor(splits + 0.5), static_cast<double>(MaxSplits))));
+		}
+
+		if (splitCount != splitCount_)
+		{
+			Log::Info("SplitStatistics: Automatic splitting traces " + std::to_string(splitCount) + " paths from every primary hit");
+			splitCount_ = splitCount;
+		}
+
+		return splitCount_;
+	}
+
+}
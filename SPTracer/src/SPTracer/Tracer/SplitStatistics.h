@@ -0,0 +1,65 @@
+#ifndef SPT_SPLIT_STATISTICS_H
+#define SPT_SPLIT_STATISTICS_H
+
+#include "../stdafx.h"
+
+namespace SPTracer
+{
+
+	// Costs and variances of the two stages of paths split at the primary hit:
+	// the camera ray and the paths continuing from its hit. Variance times cost
+	// of the pixel estimate is the smallest for sqrt(C0 * V1 / (C1 * V0))
+	// continuations, where C0 is the cost of camera ray and V0 the variance of
+	// the radiance it sees, C1 is the cost of continuation and V1 the variance
+	// among continuations of the same camera ray. V0 is found from the
+	// difference of pixel estimates in consecutive passes. Statistics are
+	// shared by all tasks, which add them row by row.
+	class SplitStatistics
+	{
+	public:
+		// luminance estimates made by all continuations of the camera ray,
+		// every estimate as if it was the only one
+		struct CameraRay
+		{
+			float sum;
+			float sumSquared;
+			unsigned int splits;
+		};
+
+		// largest number of continuations of camera ray
+		static const unsigned int MaxSplits;
+
+		explicit SplitStatistics(size_t pixelCount);
+
+		// adds camera rays of image row starting at pixel, and seconds spent
+		// on camera rays (including primary hits) and on their continuations
+		void AddRow(size_t pixel, const std::vector<CameraRay>& cameraRays, double cameraTime, double splitTime);
+
+		// number of continuations in 1..MaxSplits with the best efficiency,
+		// 2 while the variances are not known
+		unsigned int UpdateSplitCount();
+
+	private:
+		struct PixelEstimate
+		{
+			float mean;				// mean of continuations of the last camera ray
+			unsigned int splits;	// its number of continuations, 0 if pixel has no estimate yet
+		};
+
+		std::mutex mutex_;
+		unsigned int splitCount_ = 2;
+		std::vector<PixelEstimate> previous_;
+		double cameraTime_ = 0.0;
+		double splitTime_ = 0.0;
+		unsigned long long cameraRays_ = 0;
+		unsigned long long splits_ = 0;
+		double withinVariance_ = 0.0;		// sum of variances among continuations
+		unsigned long long withinCount_ = 0;
+		double differenceSquares_ = 0.0;	// sum of squared differences between passes
+		double differenceSplits_ = 0.0;		// sum of 1 / splits of both estimates in difference
+		unsigned long long differenceCount_ = 0;
+	};
+
+}
+
+#endif
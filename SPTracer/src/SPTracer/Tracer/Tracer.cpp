@@ -1,21 +1,40 @@
 #include "../stdafx.h"
+#include "../Log.h"
+#include "../Cache/RadianceCache.h"
+#include "../Guiding/PathGuide.h"
+#include "../Light/VirtualPointLights.h"
+#include "../Photon/ProgressivePhotonMap.h"
+#include "../Radiosity/RadiositySolver.h"
+#include "../Resampling/PixelReservoirs.h"
+#include "../Primitive/Box.h"
 #include "../Scene/Scene.h"
 #include "../Color/CIE1931.h"
 #include "../Color/SRGB.h"
-#include "../Scene/Camera.h"
+#include "../Color/WavelengthSampler.h"
+#include "../Color/XYZTable.h"
+#include "../Camera/Camera.h"
+#include "../Camera/CameraModel.h"
+#include "../Task/BidirectionalTask.h"
+#include "../Task/InstantRadiosityTask.h"
+#include "../Task/MetropolisTask.h"
+#include "../Task/PassState.h"
+#include "../Task/PhotonMappingTask.h"
+#include "../Task/RadiosityTask.h"
+#include "../Task/ResamplingTask.h"
 #include "../Task/TaskScheduler.h"
 #include "../Task/TraceTask.h"
 #include "../ImageUpdater.h"
+#include "SplitStatistics.h"
 #include "Tracer.h"
 
 namespace SPTracer {
 
 	Tracer::Tracer(std::unique_ptr<Scene> scene, Camera camera,
 		unsigned int width, unsigned int height, unsigned int numThreads,
-		Spectrum spectrum)
+		Spectrum spectrum, RenderSettings settings)
 		: scene_(std::move(scene)), camera_(std::move(camera)),
 		  width_(width), height_(height), numThreads_(numThreads),
-		  spectrum_(std::move(spectrum))
+		  spectrum_(std::move(spectrum)), settings_(std::move(settings))
 	{
 		// total pixels count
 		pixelsCount_ = static_cast<unsigned long>(width_) * height_;
@@ -29,19 +48,138 @@ namespace SPTracer {
 		// xyz color converter
 		xyzConverter_ = std::make_unique<CIE1931>();
 
+		// color matching functions on the wave lengths of the spectrum
+		xyzTable_ = std::make_unique<XYZTable>(spectrum_, *xyzConverter_);
+
 		// rgb color system
 		rgbConverter_ = std::make_unique<SRGB>();
 
+		// first wave lengths of hero packets
+		wavelengthSampler_ = std::make_unique<WavelengthSampler>(spectrum_, *xyzConverter_,
+			std::min(settings_.heroWavelengths, spectrum_.count), settings_.wavelengthImportanceSampling);
+
 		// normalize camera directions
 		camera_.n = camera_.n.Normalize();
 		camera_.up = camera_.up.Normalize();
 
+		// camera model with precomputed camera basis
+		cameraModel_ = CameraModel::Create(camera_, width_, height_);
+
 		// build kd-Tree
 		scene_->BuildKdTree();
+
+		// light subpaths are connected to the camera by projecting vertices to the image
+		if ((settings_.integrator == Integrator::Bidirectional) && (camera_.type != CameraType::Pinhole))
+		{
+			Log::Warning("Tracer: Bidirectional path tracing requires pinhole camera, path tracing is used instead");
+			settings_.integrator = Integrator::PathTracing;
+		}
+
+		// paths without Russian roulette must be limited by maximum depth
+		if (!settings_.russianRoulette && (settings_.maxDepth == 0))
+		{
+			Log::Warning("Tracer: Russian roulette can not be disabled without maximum depth");
+			settings_.russianRoulette = true;
+		}
+
+		// photons, patches, virtual point lights and reservoirs light diffuse vertices by their own estimate
+		if ((settings_.minDepth != 0) && (settings_.integrator != Integrator::PathTracing) &&
+			(settings_.integrator != Integrator::Bidirectional) && (settings_.integrator != Integrator::Metropolis))
+		{
+			Log::Warning("Tracer: Minimum depth is supported only by path tracing, bidirectional path tracing and Metropolis light transport");
+		}
+
+		// and they sample lights directly at diffuse vertices
+		if (!settings_.nextEventEstimation && (settings_.integrator != Integrator::PathTracing) && (settings_.integrator != Integrator::Metropolis))
+		{
+			Log::Warning("Tracer: Disabling next event estimation is supported only by path tracing and Metropolis light transport");
+		}
+
+		// distributions for path guiding cover the whole scene
+		if (settings_.pathGuiding && (settings_.integrator != Integrator::PathTracing))
+		{
+			Log::Warning("Tracer: Path guiding is supported only by path tracing");
+		}
+		else if (settings_.pathGuiding)
+		{
+			pathGuide_ = std::make_unique<PathGuide>(scene_->box(), settings_.guidingIterations, settings_.guidingBsdfFraction);
+		}
+
+		// reflected radiance is cached in cells of world space grid
+		if (settings_.radianceCache && (settings_.integrator != Integrator::PathTracing))
+		{
+			Log::Warning("Tracer: Radiance cache is supported only by path tracing");
+		}
+		else if (settings_.radianceCache && ((settings_.minDepth != 0) || (settings_.maxDepth != 0)))
+		{
+			// cached radiance includes all further bounces, which paths limited by depth would not trace
+			Log::Warning("Tracer: Radiance cache is not used with minimum or maximum path depth");
+		}
+		else if (settings_.radianceCache)
+		{
+			const Box& box = scene_->box();
+			float cellSize = settings_.radianceCacheCellSize > 0.0f ? settings_.radianceCacheCellSize : 0.02f * (box.max() - box.min()).Length();
+			radianceCache_ = std::make_unique<RadianceCache>(spectrum_.count, cellSize, settings_.radianceCacheMinSamples);
+		}
+
+		// number of paths split at primary hits is chosen by statistics of all tasks
+		if ((settings_.primarySplits == 0) && (settings_.integrator == Integrator::PathTracing))
+		{
+			splitStatistics_ = std::make_unique<SplitStatistics>(pixelsCount_);
+		}
+
+		// rays leaving the scene are followed only by the path tracing kernel
+		if ((scene_->environment() != nullptr) && (settings_.integrator != Integrator::PathTracing) && (settings_.integrator != Integrator::Metropolis))
+		{
+			Log::Warning("Tracer: Environment light is supported only by path tracing and Metropolis light transport");
+		}
+
+		// passes split into phases collect their image until the last phase completes
+		if ((settings_.integrator == Integrator::PhotonMapping) || (settings_.integrator == Integrator::InstantRadiosity) ||
+			(settings_.integrator == Integrator::ReservoirResampling))
+		{
+			passState_ = std::make_unique<PassState>(pixelsCount_, numThreads_);
+		}
+
+		// photons are gathered into visible points of all pixels
+		if (settings_.integrator == Integrator::PhotonMapping)
+		{
+			const Box& box = scene_->box();
+			float radius = settings_.photonRadius > 0.0f ? settings_.photonRadius : 0.01f * (box.max() - box.min()).Length();
+			unsigned long photons = settings_.photonsPerIteration > 0 ? settings_.photonsPerIteration : pixelsCount_;
+			photonMap_ = std::make_unique<ProgressivePhotonMap>(pixelsCount_, spectrum_.count, radius, photons);
+		}
+
+		// patches of planar meshes are solved before the image is traced
+		if (settings_.integrator == Integrator::Radiosity)
+		{
+			const Box& box = scene_->box();
+			float patchSize = settings_.radiosityPatchSize > 0.0f ? settings_.radiosityPatchSize : 0.05f * (box.max() - box.min()).Length();
+			radiositySolver_ = std::make_unique<RadiositySolver>(*scene_, spectrum_.count, numThreads_,
+				patchSize, settings_.radiosityRays, settings_.radiosityIterations);
+		}
+
+		// virtual point lights are found again for every pass
+		if (settings_.integrator == Integrator::InstantRadiosity)
+		{
+			const Box& box = scene_->box();
+			float clampDistance = settings_.vplClampDistance > 0.0f ? settings_.vplClampDistance : 0.05f * (box.max() - box.min()).Length();
+			unsigned long paths = std::max(settings_.vplPathsPerPass, 1ul);
+			virtualPointLights_ = std::make_unique<VirtualPointLights>(spectrum_.count, paths, clampDistance);
+		}
+
+		// reservoirs of all pixels are kept between passes
+		if (settings_.integrator == Integrator::ReservoirResampling)
+		{
+			pixelReservoirs_ = std::make_unique<PixelReservoirs>(pixelsCount_);
+		}
 	}
 
 	Tracer::~Tracer()
 	{
+		// path length distribution of the whole render
+		std::lock_guard<std::mutex> lock(mutex_);
+		Log::Info("Tracer: Path " + pathStatistics_.ToString());
 	}
 
 	void Tracer::Run()
@@ -52,11 +190,32 @@ namespace SPTracer {
 		// add tasks to start sampling
 		for (size_t i = 0; i < numThreads_; i++)
 		{
-			taskScheduler_->AddTask(std::make_unique<TraceTask>(*this));
+			taskScheduler_->AddTask(CreateTask());
 		}
 	}
 
-	void Tracer::AddSamples(std::vector<Vec3>& color)
+	std::unique_ptr<Task> Tracer::CreateTask()
+	{
+		switch (settings_.integrator)
+		{
+		case Integrator::Bidirectional:
+			return std::make_unique<BidirectionalTask>(*this);
+		case Integrator::Metropolis:
+			return std::make_unique<MetropolisTask>(*this);
+		case Integrator::PhotonMapping:
+			return std::make_unique<PhotonMappingTask>(*this, PhotonMappingTask::Phase::VisiblePoints);
+		case Integrator::Radiosity:
+			return std::make_unique<RadiosityTask>(*this, RadiosityTask::Phase::FormFactors);
+		case Integrator::InstantRadiosity:
+			return std::make_unique<InstantRadiosityTask>(*this, InstantRadiosityTask::Phase::Lights);
+		case Integrator::ReservoirResampling:
+			return std::make_unique<ResamplingTask>(*this, ResamplingTask::Phase::Candidates);
+		default:
+			return std::make_unique<TraceTask>(*this);
+		}
+	}
+
+	void Tracer::AddSamples(std::vector<Vec3>& color, const PathStatistics& pathStatistics)
 	{
 		// lock
 		std::lock_guard<std::mutex> lock(mutex_);
@@ -73,9 +232,18 @@ namespace SPTracer {
 			pd.samples++;
 		}
 
+		// path lengths
+		pathStatistics_.Merge(pathStatistics);
+
 		// increase count of completed samples
 		completedPasses_++;
 
+		// learn from completed pass
+		if (pathGuide_ != nullptr)
+		{
+			pathGuide_->CompletePass();
+		}
+
 		// update image approximately every 10 seconds
 		static const auto updateInterval = std::chrono::seconds(10);
 		static auto nextUpdate = std::chrono::steady_clock::now() + updateInterval;
@@ -165,6 +333,15 @@ namespace SPTracer {
 			));
 		}
 
+		// indirect light gathered from photons
+		if (photonMap_ != nullptr)
+		{
+			for (size_t i = 0; i < pixels_.size(); i++)
+			{
+				xyzColor[i] += photonMap_->GetRadiance(i);
+			}
+		}
+
 		// tonemap XYZ to RGB
 		std::vector<Vec3> rgbColor = Tonemap(xyzColor);
 
@@ -178,7 +355,15 @@ namespace SPTracer {
 		float rps = static_cast<float>(static_cast<double>(completedPasses_) * pixelsCount_ / duration.count() * 1000.0);
 		
 		std::ostringstream oss;
-		oss << "SPP: " << FormatNumber(spp) << "  RPS: " << FormatNumber(rps);
+		oss << "SPP: " << FormatNumber(spp) << "  RPS: " << FormatNumber(rps)
+			<< "  Path: " << std::setprecision(2) << std::fixed << pathStatistics_.meanLength();
+
+		// photons per second
+		if (photonMap_ != nullptr)
+		{
+			float pps = static_cast<float>(static_cast<double>(photonMap_->photonCount()) / duration.count() * 1000.0);
+			oss << "  PPS: " << FormatNumber(pps);
+		}
 
 		// call image updater
 		imageUpdater_->UpdateImage(rgbColor, oss.str());
@@ -2,32 +2,53 @@
 #define SPT_TRACER_H
 
 #include "../stdafx.h"
+#include "../Camera/Camera.h"
 #include "../Color/Spectrum.h"
-#include "../Scene/Camera.h"
+#include "PathStatistics.h"
 #include "PixelData.h"
+#include "RenderSettings.h"
 
 namespace SPTracer
 {
 	struct Ray;
 	class Vec3;
+	class CameraModel;
+	class WavelengthSampler;
 	class XYZConverter;
+	class XYZTable;
 	class RGBConverter;
 	class ImageUpdater;
+	class PassState;
+	class PathGuide;
+	class PixelReservoirs;
+	class RadianceCache;
+	class ProgressivePhotonMap;
+	class RadiositySolver;
 	class Scene;
+	class SplitStatistics;
+	class Task;
 	class TaskScheduler;
+	class VirtualPointLights;
 	
 	class Tracer
 	{
+		friend class BidirectionalTask;
+		friend class InstantRadiosityTask;
+		friend class IntegratorTask;
+		friend class MetropolisTask;
+		friend class PhotonMappingTask;
+		friend class RadiosityTask;
+		friend class ResamplingTask;
 		friend class TraceTask;
 
 	public:
 		Tracer(std::unique_ptr<Scene> scene, Camera camera,
 			unsigned int width, unsigned int height, unsigned int numThreads,
-			Spectrum spectrum);
+			Spectrum spectrum, RenderSettings settings);
 		virtual ~Tracer();
 
 		void Run();
-		void AddSamples(std::vector<Vec3>& color);
+		void AddSamples(std::vector<Vec3>& color, const PathStatistics& pathStatistics);
 		void SetImageUpdater(std::shared_ptr<ImageUpdater> imageUpdater);
 		void UpdateImage();
 
@@ -37,21 +58,37 @@ namespace SPTracer
 		unsigned long completedPasses_ = 0;
 		std::unique_ptr<Scene> scene_;
 		Camera camera_;
+		std::unique_ptr<CameraModel> cameraModel_;
 		unsigned int width_;
 		unsigned int height_;
 		unsigned int numThreads_;
 		Spectrum spectrum_;
+		RenderSettings settings_;
 		std::unique_ptr<TaskScheduler> taskScheduler_;
 		std::unique_ptr<XYZConverter> xyzConverter_;
+		std::unique_ptr<XYZTable> xyzTable_;
 		std::unique_ptr<RGBConverter> rgbConverter_;
+		std::unique_ptr<WavelengthSampler> wavelengthSampler_;
+		std::unique_ptr<PathGuide> pathGuide_;
+		std::unique_ptr<RadianceCache> radianceCache_;
+		std::unique_ptr<SplitStatistics> splitStatistics_;
+		std::unique_ptr<PassState> passState_;
+		std::unique_ptr<ProgressivePhotonMap> photonMap_;
+		std::unique_ptr<RadiositySolver> radiositySolver_;
+		std::unique_ptr<VirtualPointLights> virtualPointLights_;
+		std::unique_ptr<PixelReservoirs> pixelReservoirs_;
 		std::shared_ptr<ImageUpdater> imageUpdater_;
 		std::chrono::high_resolution_clock::time_point start_;
 		std::vector<PixelData> pixels_;
+		PathStatistics pathStatistics_;
 
 		float FindExposure(const std::vector<Vec3>& xyzColor) const;
 		float Clamp(float c) const;
 		std::vector<Vec3> Tonemap(const std::vector<Vec3>& xyzColor) const;
 		std::string FormatNumber(float n) const;
+
+		// task tracing passes with the integrator of render settings
+		std::unique_ptr<Task> CreateTask();
 	};
 
 }
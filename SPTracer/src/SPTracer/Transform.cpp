@@ -0,0 +1,162 @@
+#include "stdafx.h"
+#include "Exception.h"
+#include "Log.h"
+#include "Util.h"
+#include "Transform.h"
+
+namespace SPTracer
+{
+
+	Transform::Transform()
+		: Transform(
+			{ 1.0f, 0.0f, 0.0f, 0.0f,
+			  0.0f, 1.0f, 0.0f, 0.0f,
+			  0.0f, 0.0f, 1.0f, 0.0f },
+			{ 1.0f, 0.0f, 0.0f, 0.0f,
+			  0.0f, 1.0f, 0.0f, 0.0f,
+			  0.0f, 0.0f, 1.0f, 0.0f })
+	{
+	}
+
+	Transform::Transform(const std::array<float, 12>& m)
+		: Transform(m, Invert(m))
+	{
+	}
+
+	Transform::Transform(const std::array<float, 12>& m, const std::array<float, 12>& inv)
+		: m_(m), inv_(inv)
+	{
+	}
+
+	Transform Transform::Translation(const Vec3& t)
+	{
+		return Transform({
+			1.0f, 0.0f, 0.0f, t[0],
+			0.0f, 1.0f, 0.0f, t[1],
+			0.0f, 0.0f, 1.0f, t[2] });
+	}
+
+	Transform Transform::Scaling(const Vec3& s)
+	{
+		return Transform({
+			s[0], 0.0f, 0.0f, 0.0f,
+			0.0f, s[1], 0.0f, 0.0f,
+			0.0f, 0.0f, s[2], 0.0f });
+	}
+
+	Transform Transform::Rotation(const Vec3& axis, float angle)
+	{
+		// Rodrigues' rotation formula in matrix form
+		Vec3 a = axis.Normalize();
+		float c = std::cos(angle);
+		float s = std::sin(angle);
+		float t = 1.0f - c;
+
+		return Transform({
+			t * a[0] * a[0] + c,		t * a[0] * a[1] - s * a[2],	t * a[0] * a[2] + s * a[1],	0.0f,
+			t * a[0] * a[1] + s * a[2],	t * a[1] * a[1] + c,		t * a[1] * a[2] - s * a[0],	0.0f,
+			t * a[0] * a[2] - s * a[1],	t * a[1] * a[2] + s * a[0],	t * a[2] * a[2] + c,		0.0f });
+	}
+
+	Transform Transform::operator*(const Transform& b) const
+	{
+		// (A * B)^-1 = B^-1 * A^-1
+		return Transform(Multiply(m_, b.m_), Multiply(b.inv_, inv_));
+	}
+
+	Transform Transform::Inverse() const
+	{
+		return Transform(inv_, m_);
+	}
+
+	float Transform::Determinant() const
+	{
+		return m_[0] * (m_[5] * m_[10] - m_[6] * m_[9])
+			- m_[1] * (m_[4] * m_[10] - m_[6] * m_[8])
+			+ m_[2] * (m_[4] * m_[9] - m_[5] * m_[8]);
+	}
+
+	Vec3 Transform::TransformPoint(const Vec3& p) const
+	{
+		return Vec3(
+			m_[0] * p[0] + m_[1] * p[1] + m_[2] * p[2] + m_[3],
+			m_[4] * p[0] + m_[5] * p[1] + m_[6] * p[2] + m_[7],
+			m_[8] * p[0] + m_[9] * p[1] + m_[10] * p[2] + m_[11]
+			);
+	}
+
+	Vec3 Transform::TransformVector(const Vec3& v) const
+	{
+		return Vec3(
+			m_[0] * v[0] + m_[1] * v[1] + m_[2] * v[2],
+			m_[4] * v[0] + m_[5] * v[1] + m_[6] * v[2],
+			m_[8] * v[0] + m_[9] * v[1] + m_[10] * v[2]
+			);
+	}
+
+	Vec3 Transform::TransformNormal(const Vec3& n) const
+	{
+		// normals are transformed with the inverse transpose matrix
+		return Vec3(
+			inv_[0] * n[0] + inv_[4] * n[1] + inv_[8] * n[2],
+			inv_[1] * n[0] + inv_[5] * n[1] + inv_[9] * n[2],
+			inv_[2] * n[0] + inv_[6] * n[1] + inv_[10] * n[2]
+			);
+	}
+
+	std::array<float, 12> Transform::Invert(const std::array<float, 12>& m)
+	{
+		// cofactors of the linear part
+		float c00 = m[5] * m[10] - m[6] * m[9];
+		float c01 = m[6] * m[8] - m[4] * m[10];
+		float c02 = m[4] * m[9] - m[5] * m[8];
+
+		float det = m[0] * c00 + m[1] * c01 + m[2] * c02;
+		if (std::abs(det) < Util::Eps * Util::Eps)
+		{
+			std::string s = "Transform: Matrix is not invertible";
+			Log::Error(s);
+			throw Exception(s);
+		}
+
+		float invDet = 1.0f / det;
+
+		// inverse of the linear part
+		std::array<float, 12> r;
+		r[0] = c00 * invDet;
+		r[1] = (m[2] * m[9] - m[1] * m[10]) * invDet;
+		r[2] = (m[1] * m[6] - m[2] * m[5]) * invDet;
+		r[4] = c01 * invDet;
+		r[5] = (m[0] * m[10] - m[2] * m[8]) * invDet;
+		r[6] = (m[2] * m[4] - m[0] * m[6]) * invDet;
+		r[8] = c02 * invDet;
+		r[9] = (m[1] * m[8] - m[0] * m[9]) * invDet;
+		r[10] = (m[0] * m[5] - m[1] * m[4]) * invDet;
+
+		// inverse translation
+		r[3] = -(r[0] * m[3] + r[1] * m[7] + r[2] * m[11]);
+		r[7] = -(r[4] * m[3] + r[5] * m[7] + r[6] * m[11]);
+		r[11] = -(r[8] * m[3] + r[9] * m[7] + r[10] * m[11]);
+
+		return r;
+	}
+
+	std::array<float, 12> Transform::Multiply(const std::array<float, 12>& a, const std::array<float, 12>& b)
+	{
+		std::array<float, 12> r;
+		for (size_t i = 0; i < 3; i++)
+		{
+			for (size_t j = 0; j < 4; j++)
+			{
+				r[i * 4 + j] =
+					a[i * 4 + 0] * b[0 * 4 + j] +
+					a[i * 4 + 1] * b[1 * 4 + j] +
+					a[i * 4 + 2] * b[2 * 4 + j] +
+					(j == 3 ? a[i * 4 + 3] : 0.0f);
+			}
+		}
+
+		return r;
+	}
+
+}
@@ -0,0 +1,50 @@
+#ifndef SPT_TRANSFORM_H
+#define SPT_TRANSFORM_H
+
+#include "stdafx.h"
+#include "Vec3.h"
+
+namespace SPTracer
+{
+
+	class Transform
+	{
+	public:
+		// identity transform
+		Transform();
+
+		// affine transform from 3x4 row-major matrix (last row is 0 0 0 1)
+		explicit Transform(const std::array<float, 12>& m);
+
+		// basic transforms
+		static Transform Translation(const Vec3& t);
+		static Transform Scaling(const Vec3& s);
+		static Transform Rotation(const Vec3& axis, float angle);
+
+		// composition (b is applied first)
+		Transform operator*(const Transform& b) const;
+
+		// inverse transform
+		Transform Inverse() const;
+
+		// determinant of the linear part
+		float Determinant() const;
+
+		// apply transform
+		Vec3 TransformPoint(const Vec3& p) const;
+		Vec3 TransformVector(const Vec3& v) const;
+		Vec3 TransformNormal(const Vec3& n) const;
+
+	private:
+		std::array<float, 12> m_;		// object to world
+		std::array<float, 12> inv_;		// world to object
+
+		Transform(const std::array<float, 12>& m, const std::array<float, 12>& inv);
+
+		static std::array<float, 12> Invert(const std::array<float, 12>& m);
+		static std::array<float, 12> Multiply(const std::array<float, 12>& a, const std::array<float, 12>& b);
+	};
+
+}
+
+#endif
@@ -15,6 +15,13 @@ namespace SPTracer
 		return distribution(generator);
 	}
 
+	float Util::PowerHeuristic(float pdfA, float pdfB)
+	{
+		float a = pdfA * pdfA;
+		float b = pdfB * pdfB;
+		return a > 0.0f ? a / (a + b) : 0.0f;
+	}
+
 	float Util::RandFloat(float min, float max)
 	{
 		static unsigned int count = 0;
@@ -16,6 +16,9 @@ namespace SPTracer
 
 		static int RandInt(int min, int max);
 		static float RandFloat(float min, float max);
+
+		// multiple importance sampling weight of strategy A
+		static float PowerHeuristic(float pdfA, float pdfB);
 	};
 
 }